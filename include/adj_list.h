@@ -2,6 +2,7 @@
 #define ADJ_LIST_H
 
 #include <stdio.h>
+#include <stdint.h>
 
 // Structure representing an edge (transition) to a target vertex
 //(It is a node in a singly linked list)
@@ -23,6 +24,16 @@ typedef struct {
     EdgeList *L;
 } AdjList;
 
+// Binary graph file: the magic string, int32 n, then records until EOF
+// (1-based vertices, native byte order); adjReadFile recognizes it
+#define ADJ_BINARY_MAGIC "MKV1"
+
+typedef struct {
+    int32_t u;
+    int32_t v;
+    float p;
+} BinaryEdge;
+
 /* ---- Prototypes functions ---- */
 
 // Create an empty adjacency list
@@ -34,9 +45,58 @@ void adjFree(AdjList *adj);
 // Add a directed edge u,v with probability p
 void adjAdd(AdjList *adj, int u, int v, float p);
 
-// Read a graph from another file and create an adjacency list
+// Read a graph from another file (text or binary) and create an adjacency list
 AdjList *adjReadFile(const char *filename);
 
+// Same, also returning the outgoing probability sum of each vertex (n doubles, to free)
+AdjList *adjReadFileSums(const char *filename, double **row_sum);
+
+// What to do with several "u v p" lines for the same pair (u, v)
+typedef enum {
+    DUP_SUM = 0,      // merge them into one edge carrying the summed probability
+    DUP_REJECT = 1    // refuse the file (NULL is returned)
+} DuplicatePolicy;
+
+// Compact form of a graph (CSR): the edges of vertex u are entries row_ptr[u] .. row_ptr[u + 1] - 1
+// of v and p, in list order. 8 bytes per edge, against one malloc'd EdgeCell for the lists.
+typedef struct {
+    int n;
+    int nnz;
+    int *row_ptr;   // n + 1 offsets
+    int *v;         // 0-based target of each edge
+    float *p;       // probability of each edge
+} AdjCsr;
+
+// Load a graph in compact form, merging repeated (u, v) lines by policy: each row holds at
+// most one edge per target, placed where its first line would be; row_sum and duplicates
+// (repeated lines, counted even when the file is refused) are optional.
+// 0 on success, 1 unreadable file, 2 allocation failure, 3 refused by DUP_REJECT
+int adjReadFileCsr(const char *filename, DuplicatePolicy policy, AdjCsr *g,
+                   double **row_sum, int *duplicates);
+
+// Same, returning adjacency lists built from the compact form (NULL on any failure)
+AdjList *adjReadFileMerged(const char *filename, DuplicatePolicy policy,
+                           double **row_sum, int *duplicates);
+
+// Lists from a compact graph, and back; the edges keep their order
+AdjList *adjFromCsr(const AdjCsr *g);
+int adjToCsr(const AdjList *adj, AdjCsr *g);
+
+// Free the arrays of a compact graph
+void adjCsrFree(AdjCsr *g);
+
+// Bytes held by a compact graph
+long adjCsrBytes(const AdjCsr *g);
+
+// Write the graph in the input format (1-based "u v p" lines) in one streaming pass
+int adjWriteFile(const AdjList *adj, const char *filename);
+
+// Same in the binary format
+int adjWriteBinaryFile(const AdjList *adj, const char *filename);
+
+// Bytes held by the lists (one EdgeList per vertex, one EdgeCell per edge)
+long adjBytes(const AdjList *adj);
+
 // Display the adjacency list
 void adjPrint(AdjList *adj);
 
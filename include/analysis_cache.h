@@ -0,0 +1,66 @@
+#ifndef ANALYSIS_CACHE_H
+#define ANALYSIS_CACHE_H
+
+#include <stdint.h>
+#include "adj_list.h"
+#include "partition.h"
+#include "hasse.h"
+#include "text_buffer.h"
+
+/* Cache file: magic, version, graph hash, n, then tagged sections
+   (unknown tags are skipped, so programs can add their own), closed by an
+   empty end section: a file cut anywhere is refused */
+#define ANALYSIS_CACHE_MAGIC "MKA1"
+#define ANALYSIS_CACHE_VERSION 2
+
+/* Results of the analyses of one graph. Every section is optional; a program
+   that takes a section over sets its flag to 0 so that the cache no longer frees it. */
+typedef struct {
+    uint64_t hash;            // analysisGraphHash of the graph
+    int n;
+
+    int has_partition;
+    Partition part;           // classes in Tarjan order
+
+    int has_links;
+    t_link_array links;       // class links after removeTransitiveLinks
+
+    int *period;              // period of each class (part.count values), NULL if absent
+    double *stationary;       // n values: probability inside the class, 0 where no limit was found; NULL if absent
+
+    int text_count;
+    t_text_buffer *texts;     // report blocks of the program that saved them, NULL if absent
+
+    uint64_t settings;        // analysisSettingsHash the texts and stationary vectors were made
+                              // with, 0 if unknown: a program only reuses them when it matches
+} t_analysis_cache;
+
+/* 64-bit hash of the lists in memory order (targets and probability bits) */
+uint64_t analysisGraphHash(const AdjList *adj);
+
+/* Same hash from the compact form: equal to analysisGraphHash of adjFromCsr(g) */
+uint64_t analysisGraphHashCsr(const AdjCsr *g);
+
+/* 64-bit hash of a description of the report format and solver settings */
+uint64_t analysisSettingsHash(const char *description);
+
+/* Empty cache for this graph */
+void analysisCacheInit(t_analysis_cache *cache, const AdjList *adj);
+void analysisCacheInitCsr(t_analysis_cache *cache, const AdjCsr *g);
+
+/* Read path into an initialized cache: 0 if it matches the graph, 1 if it is
+   missing, stale or damaged (cache stays empty), 2 on allocation failure */
+int analysisCacheLoad(const char *path, t_analysis_cache *cache);
+
+/* Write every present section (to a mkstemp file beside path, then renamed); 0 on success */
+int analysisCacheSave(const char *path, const t_analysis_cache *cache);
+
+void analysisCacheFree(t_analysis_cache *cache);
+
+/* 1 unless MARKOV_NO_CACHE is set (to anything but "0") */
+int analysisCacheEnabled(void);
+
+/* "<dir>/<input base name without extension>_analysis.bin" (fileStemPath) */
+void analysisCachePath(char *out, size_t cap, const char *dir, const char *input);
+
+#endif // ANALYSIS_CACHE_H
@@ -3,6 +3,7 @@
 
 #include  <stddef.h>
 #include "adj_list.h"
+#include "partition.h"
 
 /* ---------- Constants (Mermaid boilerplate) ---------- */
 
@@ -18,6 +19,9 @@
 
 #define NODE_ID_MAX 8
 
+// Above this many vertices the full graph cannot be rendered by Mermaid
+#define MMD_RENDER_MAX 500
+
 /* ---------- Return codes ---------- */
 typedef enum {
     MMD_OK = 0,
@@ -30,7 +34,52 @@ typedef enum {
 //generates a text id for mermaid from an integer index
 size_t nodeId(int idx1, char *out, size_t out_cap);
 
-//exports the graph to a .mmd file
+//exports the graph to a .mmd file (buffered, one write() per MB)
 int writeMermaid(const AdjList *adj, const char *filepath);
 
+/* --------- Reduced views (renderable output for big graphs) ---------- */
+
+//one node per class and one edge per pair of linked classes
+int writeMermaidCondensed(const AdjList *adj, const Partition *part, const char *filepath);
+
+//every vertex with only its k heaviest outgoing edges
+int writeMermaidTopK(const AdjList *adj, int k, const char *filepath);
+
+//states within depth steps of the seeds (1-based), at most max_nodes (<= 0: no cap)
+int writeMermaidNeighbourhood(const AdjList *adj, const int *seeds, int seed_count,
+                              int depth, int max_nodes, const char *filepath);
+
+/* --------- View selection (graph_part1 and markov_batch "-view") ---------- */
+
+typedef enum {
+    MMD_VIEW_AUTO = 0,        // full graph up to MMD_RENDER_MAX vertices, neighbourhood above
+    MMD_VIEW_FULL,
+    MMD_VIEW_CONDENSED,
+    MMD_VIEW_TOPK,
+    MMD_VIEW_NEIGHBOURHOOD
+} MermaidView;
+
+#define MMD_TOPK_DEFAULT 2
+#define MMD_SEEDS_MAX 64
+
+typedef struct {
+    MermaidView view;
+    int k;                      // edges kept per state (TOPK)
+    int seeds[MMD_SEEDS_MAX];   // 1-based seeds (NEIGHBOURHOOD and AUTO)
+    int seed_count;
+} MermaidViewOptions;
+
+//AUTO view, k = MMD_TOPK_DEFAULT, seed state 1
+MermaidViewOptions mermaidDefaultView(void);
+
+//"auto", "full", "condensed", "topk[:k]" or "neighbourhood[:s1,s2,...]"; 0 ok, 1 bad text
+int mermaidParseView(const char *text, MermaidViewOptions *opt);
+
+//1 if the view is drawn from the classes (the caller passes a partition)
+int mermaidViewNeedsPartition(const MermaidViewOptions *opt);
+
+//exports adj with the selected view (part is only read by CONDENSED)
+int writeMermaidView(const AdjList *adj, const Partition *part,
+                     const MermaidViewOptions *opt, const char *filepath);
+
 #endif //EXPORT_MERMAID_H
@@ -0,0 +1,14 @@
+#ifndef FILE_NAME_H
+#define FILE_NAME_H
+
+#include <stddef.h>
+
+/* Base name of path without its directory ('/' or '\') nor its extension:
+   *stem points into path and the length is returned. A leading dot is not an
+   extension (".graph" stays ".graph"), and "shm:/name" gives "name". */
+size_t fileStem(const char *path, const char **stem);
+
+/* "<dir>/<stem of input><suffix>" into out; 0 on success, 1 if it does not fit in cap */
+int fileStemPath(char *out, size_t cap, const char *dir, const char *input, const char *suffix);
+
+#endif // FILE_NAME_H
@@ -0,0 +1,32 @@
+#ifndef FORECAST_H
+#define FORECAST_H
+
+#include "matrix.h"
+
+/* Distributions of k start vectors at several horizons, computed together:
+   the block X_t (k x N) is advanced by X_(t+1) = X_t * M up to the largest
+   horizon, every product reading M once for all k rows. */
+typedef struct {
+    int k;              // start distributions
+    int n;              // states
+    int count;          // horizons requested
+    int *horizons;      // the horizons, in the order given
+    double *data;       // count blocks of k x n: start s at horizon h is data + (h * k + s) * n
+} t_forecast;
+
+/* starts: k x n, row by row (rows need not sum to 1). Horizons >= 0 in any
+   order, repeats allowed. The results are those of repeated x * M products.
+   0 on success, 1 bad arguments, 2 allocation failure */
+int forecastRun(t_matrix_ref M, const double *starts, int k,
+                const int *horizons, int count, t_forecast *out);
+
+/* Same from k states (0-based), each one a unit start vector */
+int forecastFromStates(t_matrix_ref M, const int *states, int k,
+                       const int *horizons, int count, t_forecast *out);
+
+/* Distribution of start s at the h-th requested horizon (n values) */
+const double *forecastRow(const t_forecast *f, int h, int s);
+
+void forecastFree(t_forecast *f);
+
+#endif // FORECAST_H
@@ -0,0 +1,56 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+
+#include <stdio.h>
+
+/* Out-degree distribution of the generated states */
+typedef enum {
+    DEGREE_FIXED = 0,       // every state has the mean degree
+    DEGREE_UNIFORM = 1,     // uniform in [1, 2 * degree - 1]
+    DEGREE_GEOMETRIC = 2    // geometric with the given mean (heavy tail of hubs)
+} t_degree_law;
+
+/* Sizes of the strongly connected classes */
+typedef enum {
+    SIZES_EQUAL = 0,        // states split evenly between the classes
+    SIZES_GEOMETRIC = 1,    // class c gets a share proportional to size_ratio^c
+    SIZES_LIST = 2          // size_list[c] states each (must add up to states - absorbing)
+} t_size_law;
+
+typedef enum {
+    GEN_TEXT = 0,           // "n" then "u v p" lines, as read by adjReadFile
+    GEN_BINARY = 1          // ADJ_BINARY_MAGIC, int32 n, then BinaryEdge records
+} t_gen_format;
+
+/* Shape of the generated chain. States are laid out as: absorbing states,
+   closed classes (the first ones periodic), then transient classes whose
+   states leak towards earlier states. Every class has at least one state;
+   a periodic class is trimmed to a multiple of its period. */
+typedef struct {
+    int states;                 // total number of states
+    int degree;                 // mean out-degree (capped at GEN_MAX_DEGREE)
+    t_degree_law law;
+    int classes;                // strongly connected classes, absorbing states excluded
+    int recurrent;              // how many of these classes are closed
+    int periodic;               // closed classes made periodic
+    int period;                 // their period
+    int absorbing;              // absorbing states (self-loop 1)
+    double leak;                // probability a transient state leaves its class
+    unsigned long long seed;
+    t_gen_format format;
+    t_size_law sizes;
+    double size_ratio;          // SIZES_GEOMETRIC: ratio between consecutive classes
+    const int *size_list;       // SIZES_LIST: one size per class (classes entries)
+} t_gen_options;
+
+/* Largest out-degree drawn */
+#define GEN_MAX_DEGREE 1000
+
+/* 1000 states, degree 4 (uniform), 10 equal classes, 2 closed, 1 absorbing, text */
+t_gen_options generatorDefaultOptions(void);
+
+/* Stream the chain to out in O(classes + degree) memory; edges (optional)
+   receives the number of edges written. Returns 1 on bad options, 2 on I/O error. */
+int generateChain(const t_gen_options *opt, FILE *out, long long *edges);
+
+#endif // GENERATOR_H
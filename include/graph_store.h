@@ -0,0 +1,93 @@
+#ifndef GRAPH_STORE_H
+#define GRAPH_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "adj_list.h"
+#include "partition.h"
+#include "matrix.h"
+
+/* Graph published once and attached read-only by every tool.
+   The store lives in POSIX shared memory ("shm:/name") or in a regular file
+   that is mapped (any other name). Its contents are position independent:
+   a header, then arrays found through byte offsets from the start. */
+#define GRAPH_STORE_MAGIC "MKS1"
+#define GRAPH_STORE_VERSION 2
+#define GRAPH_STORE_SHM_PREFIX "shm:"
+
+/* Layout at offset 0 of the mapping (every array is 8-byte aligned) */
+typedef struct {
+    char magic[4];            // written last, so a store being published is never attached
+    uint32_t version;
+    uint64_t size;            // bytes of the whole store
+    int32_t n;                // number of states
+    int32_t nnz;              // number of transitions
+    int32_t class_count;      // -1 when no partition was published
+    int32_t reserved;
+    uint64_t row_ptr;         // int32[n + 1]
+    uint64_t col_idx;         // int32[nnz], increasing within a row
+    uint64_t values;          // double[nnz]
+    uint64_t adj_v;           // int32[nnz]: targets in list order, row by row (rows as row_ptr)
+    uint64_t adj_p;           // float[nnz]: their probabilities
+    uint64_t v2c;             // int32[n + 1], Partition convention (1-based, v2c[0] = -1)
+    uint64_t class_start;     // int32[class_count + 1] offsets into members
+    uint64_t members;         // int32[n]: 1-based vertices, class by class, Tarjan order
+} t_graph_store_header;
+
+/* An attached store: pointers into the read-only mapping */
+typedef struct {
+    void *base;               // NULL when nothing is attached
+    size_t size;
+    int n;
+    int nnz;
+    const int *row_ptr;
+    const int *col_idx;
+    const double *values;
+    const int *adj_v;
+    const float *adj_p;
+    int class_count;          // -1 without partition
+    const int *v2c;
+    const int *class_start;
+    const int *members;
+} t_graph_store;
+
+/* 1 if name designates a store: "shm:" prefix, or a file starting with the magic */
+int graphStoreIsName(const char *name);
+
+/* Publish the graph (and part, which may be NULL) under name, replacing any
+   previous store; processes still attached keep the old one.
+   0 on success, 1 bad arguments, 2 allocation, 3 system error (errno set) */
+int graphStorePublish(const char *name, const AdjList *adj, const Partition *part);
+
+/* Remove a published store; 0 on success */
+int graphStoreUnlink(const char *name);
+
+/* Map a store read-only and check its layout: 0 on success, 1 if missing or invalid */
+int graphStoreAttach(const char *name, t_graph_store *gs);
+void graphStoreDetach(t_graph_store *gs);
+
+/* Transition matrix aliasing the store: never freed, pruned or written */
+t_sparse_matrix graphStoreMatrix(const t_graph_store *gs);
+
+/* Partition whose vertices and v2c alias the store (only the class array is
+   allocated): release it with graphStorePartitionRelease, never partitionFree.
+   0 on success, 1 if the store has no partition, 2 on allocation failure */
+int graphStorePartition(const t_graph_store *gs, Partition *part);
+void graphStorePartitionRelease(Partition *part);
+
+/* Compact graph aliasing the store, rows in list order: never freed or written */
+AdjCsr graphStoreCsr(const t_graph_store *gs);
+
+/* Adjacency lists rebuilt from the store, in the order adjReadFile gives them */
+AdjList *graphStoreToAdj(const t_graph_store *gs);
+
+/* Read a graph file, or attach a store and rebuild its lists; gs->base is NULL
+   in the first case. Detach gs once the lists and views are no longer used. */
+AdjList *graphOpen(const char *name, t_graph_store *gs);
+
+/* Same for tools that only need the compact form: a store is used in place
+   (g aliases it, do not adjCsrFree it), a file is read with repeated lines summed.
+   0 on success, 1 if unreadable, 2 on allocation failure */
+int graphOpenCsr(const char *name, t_graph_store *gs, AdjCsr *g);
+
+#endif // GRAPH_STORE_H
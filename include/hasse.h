@@ -29,9 +29,27 @@ void addLink(t_link_array *p_array, int from_class, int to_class);
 //analyzes the graph and partition to find which classes communicate
 void buildLinksBetweenClasses(const AdjList *adj, const Partition *p, t_link_array *p_links);
 
+//same on the compact form, e.g. a graph store view
+void buildLinksBetweenClassesCsr(const AdjCsr *g, const Partition *p, t_link_array *p_links);
+
 //exports the class diagram in mermaid format to a file
 void printHasseMermaidToFile(const Partition *p, const t_link_array *links, const char *filepath);
 
+//how classes are labelled by writeHasseMermaid
+typedef struct {
+    int max_members;          // members listed in a label (< 0: all of them)
+    int show_size;            // add the number of states
+    int show_kind;            // add recurrent / transient
+    const char *index_path;   // if not NULL, full member lists are written there
+} t_hasse_options;
+
+//every member inline, nothing else: the printHasseMermaidToFile layout
+t_hasse_options hasseDefaultOptions(void);
+
+//buffered export with summarized labels; 0 on success
+int writeHasseMermaid(const Partition *p, const t_link_array *links,
+                      const t_hasse_options *opt, const char *filepath);
+
 //simplifies the diagram (remove transitive links)
 void removeTransitiveLinks(t_link_array *p_link_array);
 
@@ -0,0 +1,52 @@
+#ifndef HITTING_H
+#define HITTING_H
+
+#include "adj_list.h"
+#include "partition.h"
+
+/* Sparse LU factors (no pivoting, symmetric reordering) of a nonsingular
+   M-matrix such as I - Q: all pivots are positive, elimination is stable */
+typedef struct {
+    int size;
+    int *perm;              // perm[new] = old index
+    int *inv;               // inv[old] = new index
+    int *l_ptr, *l_col;     // strictly lower part, unit diagonal implied
+    double *l_val;
+    int *u_ptr, *u_col;     // upper part, diagonal first in each row
+    double *u_val;
+} t_sparse_lu;
+
+/* Solves A x = b in place */
+int sparseLuSolve(const t_sparse_lu *lu, double *b);
+
+/* Solves A^T x = b in place */
+int sparseLuSolveTranspose(const t_sparse_lu *lu, double *b);
+
+void sparseLuFree(t_sparse_lu *lu);
+
+/* Expected number of steps to reach the target set from every vertex.
+   is_target[v] (0-based) marks the targets; h[v] = 0 on targets and
+   INFINITY where the target set is missed with positive probability. */
+int hittingTimes(const AdjList *adj, const int *is_target, double *h);
+
+/* Mean first passage times inside one closed (recurrent) class.
+   B = I - P + e_r e_r^T is factorized once; each target then costs one solve. */
+typedef struct {
+    int size;
+    int *vertices;          // class members (1-based, same order as the class)
+    int *local;             // 0-based graph vertex -> local index, -1 outside the class
+    t_sparse_lu lu;
+    double *pi;             // stationary distribution of the class
+    double *a;              // B^-1 * 1
+} t_passage_solver;
+
+/* Factorize the class block; returns 3 if the class is not closed */
+int passageSolverCreate(const AdjList *adj, const Class *cls, t_passage_solver *s);
+
+/* m[i] = expected steps from local state i to local state target;
+   m[target] is the mean return time 1 / pi[target] */
+int passageTimesTo(const t_passage_solver *s, int target, double *m);
+
+void passageSolverFree(t_passage_solver *s);
+
+#endif // HITTING_H
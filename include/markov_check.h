@@ -9,10 +9,56 @@ typedef struct {
     int bad_count;
 } MarkovResult;
 
+// Row sums of every vertex, computed in one pass and shared by the check and the report
+typedef struct {
+    int n;
+    double *sum;      // outgoing probability sum of each vertex (0-based)
+    float lo, hi;     // tolerance the sums were checked against
+    int bad_count;    // vertices whose sum is outside [lo, hi]
+    int duplicates;   // repeated (u, v) lines found by the loader (0 for lists already built)
+} MarkovReport;
+
 // Check if each vertex has an outgoing probability sum within [lo, hi]
 MarkovResult markovIsValid (const AdjList * adj, float lo, float hi);
 
 // Display a detailed report showing the sum of probabilities for each vertex
 void markovReport(const AdjList * adj, float lo, float hi);
 
+// Compute every row sum once (parallel, compensated) into rep; rep->sum is allocated here
+int markovCompute(const AdjList *adj, float lo, float hi, MarkovReport *rep);
+
+// Load a graph and validate it while reading: no extra traversal of the lists.
+// Repeated (u, v) lines follow policy; NULL with rep->duplicates > 0 if DUP_REJECT refused them.
+AdjList *markovReadFile(const char *filename, float lo, float hi, DuplicatePolicy policy,
+                        MarkovReport *rep);
+
+// Boolean view of a computed report
+MarkovResult markovResultOf(const MarkovReport *rep);
+
+// Print a computed report (same layout as markovReport)
+void markovReportPrint(const MarkovReport *rep);
+
+void markovReportFree(MarkovReport *rep);
+
+// How markovRepair fixes a row whose sum is outside [lo, hi]
+typedef enum {
+    MARKOV_REPAIR_SCALE = 0,      // divide the row by its sum (empty rows are left as they are)
+    MARKOV_REPAIR_SELF_LOOP = 1,  // put the missing mass 1 - sum on a self-loop (rows above hi are scaled)
+    MARKOV_REPAIR_DROP_ZERO = 2   // remove vertices without outgoing mass, renumber, scale what is left
+} MarkovRepairPolicy;
+
+// What markovRepair changed
+typedef struct {
+    int rows_scaled;    // rows divided by their sum
+    int loops_added;    // rows completed by a self-loop
+    int rows_dropped;   // vertices removed (DROP_ZERO only)
+    int rows_left;      // rows still outside [lo, hi] (empty rows under SCALE)
+} MarkovRepairStats;
+
+// Repair every row outside [lo, hi] in place, in parallel.
+// With DROP_ZERO the remaining vertices keep their relative order but are renumbered
+// and adj->n shrinks; returns 3 (graph untouched) if no vertex would remain.
+int markovRepair(AdjList *adj, float lo, float hi, MarkovRepairPolicy policy,
+                 MarkovRepairStats *stats);
+
 #endif //MARKOV_CHECK_H
@@ -3,6 +3,7 @@
 
 #include "adj_list.h"
 #include "partition.h"
+#include "text_buffer.h"
 
 /* Square matrix of size N x N */
 typedef struct s_matrix {
@@ -10,12 +11,23 @@ typedef struct s_matrix {
     double **data;   // 2D array: data[i][j]
 } t_matrix;
 
+/* Sparse matrix in compressed sparse row (CSR) format */
+typedef struct s_sparse_matrix {
+    int rows;
+    int cols;
+    int nnz;         // number of stored entries
+    int *row_ptr;    // rows + 1 offsets into col_idx / values
+    int *col_idx;    // column of each entry, increasing within a row
+    double *values;
+} t_sparse_matrix;
+
 /* Creation / destruction */
 t_matrix matrixCreate(int n);
 void matrixFree(t_matrix *mat);
 
-/* Display */
+/* Display (to stdout, or appended to a buffer) */
 void matrixPrint(t_matrix mat);
+void matrixFormat(t_text_buffer *out, t_matrix mat);
 
 /* Build transition matrix from adjacency list */
 t_matrix adjToMatrix(const AdjList *adj);
@@ -25,10 +37,130 @@ void matrixCopy(t_matrix dest, t_matrix src);
 void matrixMultiply(t_matrix A, t_matrix B, t_matrix result);
 double matrixDiff(t_matrix A, t_matrix B);
 
+/* Row vector times matrix: y = x * M (x and y hold M.size entries) */
+void vectorMatrixMultiply(const double *x, t_matrix M, double *y);
+
+/* Matrix times column vector: y = M * x */
+void matrixVectorMultiply(t_matrix M, const double *x, double *y);
+
 /* Part 3 – Step 2: submatrix for one class (component) */
 t_matrix subMatrix(t_matrix matrix, Partition part, int compo_index);
 
 /* Bonus: period of a class */
 int getPeriod(t_matrix sub_matrix);
 
+/* ---------- Sparse (CSR) matrices ---------- */
+
+/* Creation / destruction (row_ptr zeroed, room for nnz entries) */
+t_sparse_matrix sparseCreate(int rows, int cols, int nnz);
+void sparseFree(t_sparse_matrix *mat);
+
+/* Build the transition matrix from the adjacency list without any N x N storage
+   (duplicate edges add up, as in adjToMatrix) */
+t_sparse_matrix adjToSparse(const AdjList *adj);
+
+/* Same from the compact form of the graph */
+t_sparse_matrix csrToSparse(const AdjCsr *g);
+
+/* 1 if a graph with n vertices and nnz edges should be handled in sparse form */
+int matrixPreferSparse(int n, long nnz);
+
+/* Dense copy (small matrices only) */
+t_matrix sparseToDense(t_sparse_matrix S);
+
+/* Display, same layout as matrixPrint */
+void sparsePrint(t_sparse_matrix mat);
+void sparseFormat(t_text_buffer *out, t_sparse_matrix mat);
+
+/* y = x * M (x: M.rows entries, y: M.cols entries) */
+void sparseVectorMultiply(const double *x, t_sparse_matrix M, double *y);
+
+/* y = M * x (x: M.cols entries, y: M.rows entries) */
+void sparseMatrixVectorMultiply(t_sparse_matrix M, const double *x, double *y);
+
+/* Transpose (rows and columns swapped, still sorted by column) */
+t_sparse_matrix sparseTranspose(t_sparse_matrix M);
+
+/* sums[i] = sum of row i */
+void sparseRowSums(t_sparse_matrix M, double *sums);
+
+/* Period of a class from its sparse block (BFS levels, O(nnz)) */
+int sparsePeriod(t_sparse_matrix sub_matrix);
+
+/* ---------- Sparse products (multi-step transitions) ---------- */
+
+/* Outcome of a chain of sparse products */
+typedef struct {
+    int products;          // number of SpGEMM calls
+    double drop_tol;       // tolerance applied to every product
+    int row_cap;           // smallest per-row limit applied to honour the budget (0: none)
+    long capped_rows;      // rows cut down to row_cap, summed over all products
+    double dropped_mass;   // total probability pruned, summed over all rows and products
+    long peak_bytes;       // largest operand + product pair of CSR matrices alive at once
+} t_sparse_power_info;
+
+/* Bytes held by a CSR matrix */
+long sparseBytes(t_sparse_matrix M);
+
+/* result = A * B (parallel over rows). Entries below drop_tol are pruned and
+   their sum is added to *dropped (may be NULL). drop_tol = 0 keeps everything. */
+t_sparse_matrix sparseMultiply(t_sparse_matrix A, t_sparse_matrix B, double drop_tol, double *dropped);
+
+/* Same, keeping at most row_cap entries per row (the largest ones; 0: no limit).
+   The result is sized before it is filled, so no more than its final size is
+   allocated. Rows that were cut are added to *capped (may be NULL). */
+t_sparse_matrix sparseMultiplyCapped(t_sparse_matrix A, t_sparse_matrix B, double drop_tol,
+                                     int row_cap, double *dropped, long *capped);
+
+/* Remove entries below drop_tol in place, return the pruned mass */
+double sparsePrune(t_sparse_matrix *M, double drop_tol);
+
+/* start * M^steps, pruning below drop_tol after each product. When max_bytes > 0
+   the operand and the product of every step fit in max_bytes together: each row
+   of the product keeps at most its share of what the operand leaves (its largest
+   entries, at least one). A budget below the size of start cannot be honoured. */
+t_sparse_matrix sparseAdvance(t_sparse_matrix start, t_sparse_matrix M, int steps,
+                              double drop_tol, long max_bytes, t_sparse_power_info *info);
+
+/* ---------- All class blocks in one pass ---------- */
+
+/* States renumbered class by class ("block order"): class c occupies
+   positions [class_start[c], class_start[c + 1]) and local index i stands
+   for part.classes[c].vertices[i], as in subMatrix.
+   blocks[c] are read-only views into diag: their row_ptr holds absolute
+   offsets (row_ptr[0] may be > 0) and they must not be freed or pruned. */
+typedef struct {
+    int count;                 // number of classes
+    int n;                     // number of states
+    int *perm;                 // perm[new] = old (0-based)
+    int *inv;                  // inv[old] = new
+    int *class_start;          // count + 1 offsets in block order
+    t_sparse_matrix diag;      // intra-class entries, block order rows, local columns
+    t_sparse_matrix offdiag;   // inter-class entries, block order rows and columns
+    t_sparse_matrix *blocks;   // blocks[c]: class c as a square matrix (view)
+} t_class_blocks;
+
+/* Permute M into block order and cut every class block: O(N + E), no N x N storage */
+int classBlocksBuild(const AdjList *adj, const Partition *part, t_class_blocks *cb);
+
+/* Same from a matrix with one entry per (row, column), e.g. a graph store view;
+   S is only read */
+int classBlocksBuildSparse(t_sparse_matrix S, const Partition *part, t_class_blocks *cb);
+void classBlocksFree(t_class_blocks *cb);
+
+/* Read-only handle on a transition matrix in either storage
+   (exactly one of dense / sparse is set), for solvers that only need products */
+typedef struct {
+    const t_matrix *dense;
+    const t_sparse_matrix *sparse;
+} t_matrix_ref;
+
+int matrixRefSize(t_matrix_ref M);
+
+/* y = x * M */
+void matrixRefVectorMultiply(const double *x, t_matrix_ref M, double *y);
+
+/* y = M * x */
+void matrixRefMatrixVectorMultiply(t_matrix_ref M, const double *x, double *y);
+
 #endif // MATRIX_H
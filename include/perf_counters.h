@@ -0,0 +1,47 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+/* Hardware counters read through Linux perf_event_open (user space only).
+   Each counter is optional: in containers or on other systems some or all
+   of them fail to open and are reported as unavailable (-1). */
+
+typedef enum {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,       // last-level cache misses
+    PERF_BRANCH_MISSES,
+    PERF_COUNTER_COUNT
+} t_perf_counter;
+
+typedef struct {
+    int fd[PERF_COUNTER_COUNT];   // -1 when the counter could not be opened
+    int opened;                   // number of counters available
+    int error;                    // errno of the first failed open, 0 if none failed
+} t_perf_counters;
+
+/* Raw counter totals at one instant, or their difference over a region.
+   A multiplexed counter only counts while running: the region's count is
+   estimated from the differences, value * enabled / running. */
+typedef struct {
+    long long value[PERF_COUNTER_COUNT];     // -1 if unavailable (after a diff: scaled count)
+    long long enabled[PERF_COUNTER_COUNT];   // ns the counter was enabled
+    long long running[PERF_COUNTER_COUNT];   // ns it was actually counting
+} t_perf_sample;
+
+/* Open the counters for this process and the threads it creates afterwards
+   (open them before the first parallel region). Returns the number opened. */
+int perfCountersOpen(t_perf_counters *pc);
+
+/* Current raw totals with their enabled and running times (not scaled) */
+void perfCountersRead(const t_perf_counters *pc, t_perf_sample *s);
+
+/* Counts over [start, end]: the value, enabled and running differences,
+   then value scaled by enabled / running if the counter was multiplexed.
+   -1 stays -1, as does a counter that never ran in the region. */
+void perfSampleDiff(const t_perf_sample *end, const t_perf_sample *start, t_perf_sample *out);
+
+void perfCountersClose(t_perf_counters *pc);
+
+extern const char *PERF_COUNTER_NAMES[PERF_COUNTER_COUNT];
+
+#endif // PERF_COUNTERS_H
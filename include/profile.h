@@ -0,0 +1,48 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/* Stage profiler of the executables. Off unless MARKOV_PROFILE is set
+   ("1" or "stderr": table on stderr, anything else: JSON file of that name)
+   or --profile[=file.json] is passed; when off every call returns at once. */
+
+#define PROFILE_MAX_STAGES 64
+#define PROFILE_MAX_DEPTH 16
+
+/* Totals of one named stage (same name under the same parent) */
+typedef struct {
+    const char *name;
+    int parent;            // index of the enclosing stage, -1 at top level
+    int depth;
+    long long calls;
+    double seconds;        // monotonic wall time, summed over calls
+    long long est_bytes;   // size of the stage's structures, computed by the caller
+                           // from their dimensions (an estimate, not counted at malloc)
+    long long iterations;  // products, edges, states... (reported by the code)
+    long peak_rss_kb;      // process high-water mark when the stage last ended
+} t_profile_stage;
+
+// 1 when profiling; lets callers skip computing a counter that nobody reads
+extern int profile_active;
+
+/* Read MARKOV_PROFILE and the command line; the report is written at exit */
+void profileInit(int argc, char **argv, const char *program);
+
+/* Open a stage nested in the current one (main thread only);
+   returns the id to pass to profileEnd, -1 when profiling is off */
+int profileBegin(const char *name);
+void profileEnd(int id);
+
+/* Counters charged to the innermost open stage (safe from parallel loops);
+   bytes are what the caller computes for its structures (adjBytes, sparseBytes...) */
+void profileEstimatedBytes(long long bytes);
+void profileIterations(long long count);
+
+/* Write the report now (also done automatically at exit) */
+void profileReport(void);
+
+/* Clock and memory readings of the report, also used by markov_bench and markov_batch
+   (they work whether profiling is on or off) */
+double profileNow(void);          // monotonic wall clock, seconds
+long profilePeakRssKb(void);      // process high-water mark, kB (-1 if unknown)
+
+#endif // PROFILE_H
@@ -0,0 +1,53 @@
+#ifndef REACH_H
+#define REACH_H
+
+#include "adj_list.h"
+#include "partition.h"
+
+/* Condensations with at most this many classes use a bitset closure */
+#define REACH_BITSET_MAX 16384
+
+typedef enum {
+    REACH_BITSET = 0,     // one bit row per class: O(1) query, count^2 / 8 bytes
+    REACH_INTERVAL = 1    // sorted postorder intervals per class: O(log k) query
+} t_reach_mode;
+
+/* Reachability index over the condensation DAG of a partition.
+   Two states of the same class always reach each other (a state reaches itself). */
+typedef struct {
+    t_reach_mode mode;
+    int n;                        // vertices
+    int count;                    // classes
+    int *v2c;                     // copy of the partition mapping (1-based vertices)
+
+    /* REACH_BITSET */
+    int words;                    // 64-bit words per row
+    unsigned long long *bits;     // bits[c * words + d / 64] has bit d % 64 if c reaches d
+
+    /* REACH_INTERVAL */
+    int *post;                    // postorder number of each class in a spanning forest
+    int *iv_start, *iv_count;     // intervals of class c: iv_count[c] entries from iv_start[c]
+    int *iv_lo, *iv_hi;           // inclusive postorder ranges, sorted and disjoint
+    int iv_total;                 // intervals stored over all classes
+} t_reach_index;
+
+/* Build the index in O(N + E) plus the closure itself; mode is chosen from the
+   number of classes unless force_mode >= 0. Returns 2 on allocation failure. */
+int reachIndexBuild(const AdjList *adj, const Partition *part, int force_mode, t_reach_index *idx);
+
+/* Same on the compact form, e.g. a graph store view: no list is needed */
+int reachIndexBuildCsr(const AdjCsr *g, const Partition *part, int force_mode, t_reach_index *idx);
+
+/* 1 if state u can reach state v (1-based), 0 if not, -1 on bad arguments */
+int reachQuery(const t_reach_index *idx, int u, int v);
+
+/* out[i] = reachQuery(idx, from[i], to[i]), answered in parallel */
+void reachQueryBatch(const t_reach_index *idx, const int *from, const int *to,
+                     int count, signed char *out);
+
+/* Bytes used by the labels (bitset rows, or intervals and postorder numbers) */
+long reachIndexSize(const t_reach_index *idx);
+
+void reachIndexFree(t_reach_index *idx);
+
+#endif // REACH_H
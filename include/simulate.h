@@ -0,0 +1,46 @@
+#ifndef SIMULATE_H
+#define SIMULATE_H
+
+#include "adj_list.h"
+
+/* Vose alias tables of every state, in CSR form: sampling a transition
+   costs one random number and one comparison whatever the out-degree */
+typedef struct {
+    int n;
+    int *row_ptr;     // entries of state u: row_ptr[u] .. row_ptr[u + 1]
+    int *target;      // 0-based destination of each entry
+    int *alias;       // destination taken when the entry is not accepted
+    double *prob;     // acceptance probability of the entry
+} t_alias_chain;
+
+/* Build the tables in O(N + E); rows are normalized by their sum.
+   A state without outgoing edges keeps its walkers (implicit self-loop). */
+int aliasChainBuild(const AdjList *adj, t_alias_chain *ch);
+
+void aliasChainFree(t_alias_chain *ch);
+
+/* Simulation settings */
+typedef struct {
+    long walks;                 // number of independent walks
+    int steps;                  // transitions per walk
+    int burn_in;                // first steps not counted in visits
+    int start;                  // 1-based start state, 0: uniform random start
+    unsigned long long seed;    // same seed, same result, whatever the thread count
+} t_simulation_options;
+
+/* Aggregated counts over all walks */
+typedef struct {
+    int n;
+    unsigned long long *visits;   // visits[v]: steps spent in v after burn-in
+    unsigned long long *final;    // final[v]: walks ending in v (estimate of start row of M^steps)
+    unsigned long long total;     // sum of visits
+} t_simulation_result;
+
+/* Run the walks in parallel. Walk w draws its numbers from a counter-based
+   generator keyed by (seed, w), so no state is shared between threads. */
+int simulateWalks(const t_alias_chain *ch, const t_simulation_options *opt,
+                  t_simulation_result *res);
+
+void simulationResultFree(t_simulation_result *res);
+
+#endif // SIMULATE_H
@@ -0,0 +1,26 @@
+#ifndef SPECTRAL_H
+#define SPECTRAL_H
+
+#include "matrix.h"
+
+/* Spectral estimate of a transition matrix (or of a class block) */
+typedef struct {
+    double rho;          // dominant eigenvalue (1 for a stochastic block, < 1 for a transient one)
+    double lambda2;      // modulus of the subdominant eigenvalue
+    double relaxation;   // relaxation time 1 / (1 - |lambda2| / rho), INFINITY if |lambda2| = rho
+    int iterations;      // vector products spent on the estimate
+    int converged;       // 1 if both power iterations met their tolerance
+} t_spectral_estimate;
+
+/* Estimate rho and |lambda2| by power iteration and deflated power iteration */
+int spectralEstimate(t_matrix M, int max_iter, double tol, t_spectral_estimate *est);
+
+/* Same on sparse storage */
+int spectralEstimateSparse(t_sparse_matrix M, int max_iter, double tol, t_spectral_estimate *est);
+
+/* Predicted number of steps for M^n to settle within epsilon:
+   ceil(log(epsilon) / log(rate)) with rate = rho for a transient block and
+   |lambda2| for a stochastic one; -1 if M^n never settles (periodic, reducible) */
+long spectralStepsFor(const t_spectral_estimate *est, double epsilon);
+
+#endif // SPECTRAL_H
@@ -0,0 +1,56 @@
+#ifndef STATIONARY_H
+#define STATIONARY_H
+
+#include "matrix.h"
+
+/* Iteration scheme used to reach the limit of M^n */
+typedef enum {
+    STATIONARY_POWER = 0,     // M^k = M^(k-1) * M, one product per step
+    STATIONARY_SQUARING = 1,  // M^(2^k) = M^(2^(k-1)) * M^(2^(k-1))
+    STATIONARY_AITKEN = 2     // x_k = x_(k-1) * M with Aitken extrapolation
+} t_stationary_method;
+
+/* Solver settings */
+typedef struct {
+    t_stationary_method method;
+    double epsilon;    // stopping threshold on the L1 change
+    int max_iter;      // maximum number of products
+    int sample_rows;   // rows compared by the stopping test (<= 0: all rows)
+    int lazy;          // vector modes, closed classes only: iterate x (I + M) / 2 rescaled to mass 1
+                       // (same stationary vector, no periodicity, no drift from float row sums)
+} t_stationary_options;
+
+/* What the solver did */
+typedef struct {
+    int iterations;    // number of products performed
+    long exponent;     // n such that the result is M^n (matrix mode)
+    int converged;     // 1 if the stopping test was met and the result is stationary
+    double diff;       // last change measured by the stopping test
+    double residual;   // ||pi * M - pi||_1 of the result (worst sampled row)
+} t_stationary_info;
+
+/* Default settings: repeated squaring, epsilon 0.01, 1000 products, 16 sampled rows */
+t_stationary_options stationaryDefaultOptions(void);
+
+/* Limit matrix: result <- M^n with n large enough for the stopping test */
+int stationaryLimitMatrix(t_matrix M, t_stationary_options opt, t_matrix result,
+                          t_stationary_info *info);
+
+/* Stationary distribution vector pi (M.size entries) */
+int stationaryVector(t_matrix M, t_stationary_options opt, double *pi,
+                     t_stationary_info *info);
+
+/* L1 norm of pi * M - pi */
+double stationaryResidual(t_matrix M, const double *pi);
+
+/* Sparse counterparts (vector iteration only: SQUARING runs AITKEN) */
+int stationaryVectorSparse(t_sparse_matrix M, t_stationary_options opt, double *pi,
+                           t_stationary_info *info);
+double stationaryResidualSparse(t_sparse_matrix M, const double *pi);
+
+/* Same iteration started from start (M.rows entries, rescaled to mass 1; the
+   uniform vector is used when start is NULL or carries no mass) */
+int stationaryVectorSparseFrom(t_sparse_matrix M, t_stationary_options opt, const double *start,
+                               double *pi, t_stationary_info *info);
+
+#endif // STATIONARY_H
@@ -0,0 +1,52 @@
+#ifndef STATIONARY_UPDATE_H
+#define STATIONARY_UPDATE_H
+
+#include "adj_list.h"
+#include "partition.h"
+#include "matrix.h"
+#include "stationary.h"
+
+/* One edited transition: the probability of u -> v becomes p (1-based states).
+   p = 0 removes the edge; rows are not renormalized. */
+typedef struct {
+    int u;
+    int v;
+    double p;
+} t_prob_update;
+
+/* Solved chain kept between batches of edits */
+typedef struct {
+    AdjList *adj;             // edited in place, not owned
+    Partition part;           // classes of the current graph
+    t_class_blocks blocks;    // class blocks, values kept in step with adj
+    t_stationary_options opt; // vector iteration settings of every solve
+    char *closed;             // closed[c] = 1 if no edge leaves class c
+    char *solved;             // solved[c] = 1 if pi holds a converged vector for class c
+    double *pi;               // n values (0-based): probability inside each closed class, 0 elsewhere
+} t_stationary_state;
+
+/* What an init or an update did */
+typedef struct {
+    int structural;           // 1 if an edge appeared or vanished (classes recomputed)
+    int solved;               // closed classes (re)solved
+    int kept;                 // closed classes whose vector was reused as it was
+    int converged;            // solved classes that converged
+    int iterations;           // vector products of all the solves
+} t_stationary_update_info;
+
+/* Classes, blocks and the vector of every closed class, each solved from its
+   part of pi0 (n values, may be NULL): vectors already known cost a product or two.
+   0 on success, 1 bad arguments, 2 allocation failure */
+int stationaryStateInit(AdjList *adj, const double *pi0, t_stationary_options opt,
+                        t_stationary_state *st, t_stationary_update_info *info);
+
+/* Apply count edits in order, then re-solve only the closed classes they touch,
+   each from its previous vector. An edge that appears or vanishes may change
+   the classes: they are recomputed, and the vector of any class found unchanged
+   and untouched is kept. 1 (nothing applied) if an edit is out of range. */
+int stationaryStateUpdate(t_stationary_state *st, const t_prob_update *updates, int count,
+                          t_stationary_update_info *info);
+
+void stationaryStateFree(t_stationary_state *st);
+
+#endif // STATIONARY_UPDATE_H
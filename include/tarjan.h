@@ -54,5 +54,8 @@ void tarjanMetaFree(TarjanMeta *meta);
 //runs tarjan's algorithm on the graph to populate the partition
 int tarjanRun(const AdjList *adj, Partition *partition);
 
+//same on the compact form: vertices are visited and edges scanned in the same order
+int tarjanRunCsr(const AdjCsr *g, Partition *partition);
+
  
 #endif //INC_2526_TI301I6_PRJ_GRP8_TARJAN_H
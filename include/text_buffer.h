@@ -0,0 +1,31 @@
+#ifndef TEXT_BUFFER_H
+#define TEXT_BUFFER_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/* Growable in-memory text, used to build output off the main thread
+   and to batch small writes into large ones */
+typedef struct {
+    char *data;      // not NUL-terminated when len == 0
+    size_t len;
+    size_t cap;
+} t_text_buffer;
+
+void textBufferInit(t_text_buffer *b);
+void textBufferFree(t_text_buffer *b);
+
+/* Make room for extra more bytes; 0 on success */
+int textBufferReserve(t_text_buffer *b, size_t extra);
+
+/* Append raw bytes / formatted text; 0 on success */
+int textBufferAppend(t_text_buffer *b, const char *s, size_t len);
+int textBufferPrintf(t_text_buffer *b, const char *fmt, ...);
+
+/* Append a decimal integer without going through printf; 0 on success */
+int textBufferAppendInt(t_text_buffer *b, long long x);
+
+/* Write the content to f and empty the buffer; 0 on success */
+int textBufferFlush(t_text_buffer *b, FILE *f);
+
+#endif // TEXT_BUFFER_H
@@ -13,6 +13,9 @@
 
 #include "adj_list.h"
 #include "matrix.h"
+#include "forecast.h"
+
+#define NB_DAYS 30
 
 typedef struct {
     SDL_Window   *window;
@@ -23,6 +26,7 @@ typedef struct {
     int nbStates;      // number of states (M.size)
     int currentState;  // today's state (0..nbStates-1)
     int selectedDay;   // day offset from today (0 = today)
+    t_forecast forecast; // every start state at D+0 .. D+(NB_DAYS-1), computed once
 } App;
 
 static const char *STATE_NAMES[] = {
@@ -111,7 +115,7 @@ static int hitTestDay(int mx, int my)
     int cellH  = 60;
     int cols   = 7;
 
-    for (int d = 0; d < 30; d++) {
+    for (int d = 0; d < NB_DAYS; d++) {
         int row = d / cols;
         int col = d % cols;
 
@@ -136,7 +140,7 @@ static void drawCalendar(App *app)
 
     SDL_SetRenderDrawColor(app->renderer, 0, 0, 0, 255);
 
-    for (int d = 0; d < 30; d++) {
+    for (int d = 0; d < NB_DAYS; d++) {
         int row = d / cols;
         int col = d % cols;
 
@@ -161,31 +165,14 @@ static void drawCalendar(App *app)
     }
 }
 
-static void computeDistributionForDay(const t_matrix M, int startState,
+static void computeDistributionForDay(const App *app, int startState,
                                       int steps, double *outProbs, int nbStates)
 {
-    if (steps == 0) {
-        for (int i = 0; i < nbStates; i++) outProbs[i] = 0.0;
-        outProbs[startState] = 1.0;
-        return;
-    }
-
-    t_matrix powM = matrixCreate(M.size);
-    t_matrix tmp  = matrixCreate(M.size);
-
-    matrixCopy(powM, M);
-
-    for (int k = 1; k < steps; k++) {
-        matrixMultiply(powM, M, tmp);
-        matrixCopy(powM, tmp);
-    }
+    const double *row = forecastRow(&app->forecast, steps, startState);
 
     for (int j = 0; j < nbStates; j++) {
-        outProbs[j] = powM.data[startState][j];
+        outProbs[j] = row != NULL ? row[j] : 0.0;
     }
-
-    matrixFree(&powM);
-    matrixFree(&tmp);
 }
 
 static void drawInfoPanel(App *app)
@@ -202,7 +189,7 @@ static void drawInfoPanel(App *app)
     // allow up to 10 states safely
     double probs[10];
 
-    computeDistributionForDay(app->M, app->currentState,
+    computeDistributionForDay(app, app->currentState,
                               app->selectedDay, probs, app->nbStates);
 
     int y0 = 420;
@@ -242,11 +229,26 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
 
+    // Distributions of every start state for every day, in one pass over M
+    int states[10], days[NB_DAYS];
+    int nb = app.nbStates < 10 ? app.nbStates : 10;
+    for (int i = 0; i < nb; i++) states[i] = i;
+    for (int d = 0; d < NB_DAYS; d++) days[d] = d;
+
+    t_matrix_ref ref = {&app.M, NULL};
+    if (forecastFromStates(ref, states, nb, days, NB_DAYS, &app.forecast) != 0) {
+        fprintf(stderr, "Error: forecast failed.\n");
+        matrixFree(&app.M);
+        adjFree(adj);
+        return EXIT_FAILURE;
+    }
+
     srand((unsigned)time(NULL));
-    app.currentState = rand() % app.nbStates;
+    app.currentState = rand() % nb;
 
     if (!initSDL(&app)) {
         fprintf(stderr, "SDL initialization failed\n");
+        forecastFree(&app.forecast);
         matrixFree(&app.M);
         adjFree(adj);
         return EXIT_FAILURE;
@@ -261,7 +263,7 @@ int main(int argc, char *argv[])
                 running = 0;
             } else if (e.type == SDL_MOUSEBUTTONDOWN) {
                 int day = hitTestDay(e.button.x, e.button.y);
-                if (day >= 0 && day < 30) {
+                if (day >= 0 && day < NB_DAYS) {
                     app.selectedDay = day;
                 }
             }
@@ -277,6 +279,7 @@ int main(int argc, char *argv[])
     }
 
     cleanupSDL(&app);
+    forecastFree(&app.forecast);
     matrixFree(&app.M);
     adjFree(adj);
 
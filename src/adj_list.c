@@ -1,5 +1,7 @@
 #include "adj_list.h"
 #include <stdlib.h>
+#include <math.h>
+#include <string.h>
 
 // Create an empty adjacency list of size n
 AdjList *adjCreate(int n) {
@@ -66,25 +68,30 @@ void adjAdd(AdjList *adj, int u, int v, float p) {
     adj->L[u].head = new;
 }
 
-// Read graph from file and build adjacency list
-AdjList *adjReadFile(const char *filename) {
+// Edge as read from the file, before merging
+typedef struct {
+    int u, v;
+    float p;
+} RawEdge;
 
-    FILE *f = fopen(filename, "rt");
-    if (!f) {
-        return NULL;
-    }
+// Order edges of one row by target, then by position in the file (kept in u)
+static int compareTargets(const void *a, const void *b) {
+    const RawEdge *x = a, *y = b;
+    if (x->v != y->v) return (x->v > y->v) - (x->v < y->v);
+    return (x->u > y->u) - (x->u < y->u);
+}
 
-    int n = 0;
-    if (fscanf(f, "%d", &n) != 1 || n <= 0) {
-        fclose(f);
-        return NULL;
-    }
+// Order edges of one row by position in the file
+static int comparePositions(const void *a, const void *b) {
+    const RawEdge *x = a, *y = b;
+    return (x->u > y->u) - (x->u < y->u);
+}
 
-    AdjList *adj = adjCreate(n);
-    if (!adj) {
-        fclose(f);
-        return NULL;
-    }
+// Read every valid "u v p" line (0-based in the result)
+static RawEdge *readEdges(FILE *f, int n, int *count) {
+    int cap = 1024, len = 0;
+    RawEdge *e = malloc(cap * sizeof(RawEdge));
+    if (!e) return NULL;
 
     int u, v;
     float p;
@@ -92,33 +99,394 @@ AdjList *adjReadFile(const char *filename) {
     /* Read edges until EOF */
     while (1) {
 
-        int count = fscanf(f, "%d %d %f", &u, &v, &p);
+        int c = fscanf(f, "%d %d %f", &u, &v, &p);
 
-        if (count == EOF || count == 0) {
+        if (c == EOF || c == 0) {
             break;  // end or blank line
         }
 
-        if (count != 3) {
+        if (c != 3) {
             // invalid or partial line → ignore safely
             continue;
         }
 
-        /* Convert from 1-based (file) to 0-based (internal) */
-        int from = u - 1;
-        int to   = v - 1;
+        /* Same validation as adjAdd, indices converted from 1-based */
+        if (u < 1 || u > n || v < 1 || v > n || p < 0.0f || p > 1.0f) {
+            continue;
+        }
+
+        if (len == cap) {
+            cap *= 2;
+            RawEdge *grown = realloc(e, cap * sizeof(RawEdge));
+            if (!grown) {
+                free(e);
+                return NULL;
+            }
+            e = grown;
+        }
+
+        e[len].u = u - 1;
+        e[len].v = v - 1;
+        e[len].p = p;
+        len++;
+    }
+
+    *count = len;
+    return e;
+}
 
-        /* Validate before insertion */
-        if (from >= 0 && from < adj->n &&
-            to >= 0 &&   to < adj->n   )
-        {
-            adjAdd(adj, from, to, p);
+// Read binary (u, v, p) records until EOF, in large blocks
+static RawEdge *readBinaryEdges(FILE *f, int n, int *count) {
+    int cap = 1024, len = 0;
+    RawEdge *e = malloc(cap * sizeof(RawEdge));
+    if (!e) return NULL;
+
+    enum { BLOCK = 4096 };
+    BinaryEdge block[BLOCK];
+    size_t got;
+
+    while ((got = fread(block, sizeof(BinaryEdge), BLOCK, f)) > 0) {
+        for (size_t k = 0; k < got; k++) {
+            int u = block[k].u, v = block[k].v;
+            float p = block[k].p;
+
+            /* Same validation as the text reader */
+            if (u < 1 || u > n || v < 1 || v > n || p < 0.0f || p > 1.0f) {
+                continue;
+            }
+
+            if (len == cap) {
+                cap *= 2;
+                RawEdge *grown = realloc(e, cap * sizeof(RawEdge));
+                if (!grown) {
+                    free(e);
+                    return NULL;
+                }
+                e = grown;
+            }
+
+            e[len].u = u - 1;
+            e[len].v = v - 1;
+            e[len].p = p;
+            len++;
         }
     }
 
+    *count = len;
+    return e;
+}
+
+// Read graph from file and build adjacency list
+AdjList *adjReadFile(const char *filename) {
+    return adjReadFileMerged(filename, DUP_SUM, NULL, NULL);
+}
+
+// Read graph from file, also returning the row sums
+AdjList *adjReadFileSums(const char *filename, double **row_sum) {
+    return adjReadFileMerged(filename, DUP_SUM, row_sum, NULL);
+}
+
+// Lists of the merged graph, built from its compact form
+AdjList *adjReadFileMerged(const char *filename, DuplicatePolicy policy,
+                           double **row_sum, int *duplicates) {
+    AdjCsr g;
+    if (adjReadFileCsr(filename, policy, &g, row_sum, duplicates) != 0) {
+        return NULL;
+    }
+
+    AdjList *adj = adjFromCsr(&g);
+    adjCsrFree(&g);
+    if (adj == NULL && row_sum) {
+        free(*row_sum);
+        *row_sum = NULL;
+    }
+    return adj;
+}
+
+// Ingest: read all edges, bucket them by source, sort each row by target,
+// merge repeated targets at their first line, then lay every row out in
+// the order adjAdd would have produced (reverse of the file)
+int adjReadFileCsr(const char *filename, DuplicatePolicy policy, AdjCsr *g,
+                   double **row_sum, int *duplicates) {
+    if (duplicates) *duplicates = 0;
+    if (row_sum) *row_sum = NULL;
+    if (!g) return 1;
+    memset(g, 0, sizeof(*g));
+
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        return 1;
+    }
+
+    /* Binary files start with the magic string, text files with n */
+    char magic[4];
+    int binary = fread(magic, 1, 4, f) == 4 && memcmp(magic, ADJ_BINARY_MAGIC, 4) == 0;
+    if (!binary) rewind(f);
+
+    int n = 0;
+    int32_t n32 = 0;
+    if (binary ? (fread(&n32, sizeof(n32), 1, f) != 1 || (n = n32) <= 0)
+               : (fscanf(f, "%d", &n) != 1 || n <= 0)) {
+        fclose(f);
+        return 1;
+    }
+
+    int m = 0;
+    RawEdge *raw = binary ? readBinaryEdges(f, n, &m) : readEdges(f, n, &m);
     fclose(f);
+    if (!raw) {
+        return 2;
+    }
+
+    /* Counting sort by source (stable, keeps the file order inside a row) */
+    int *start = calloc(n + 1, sizeof(int));
+    RawEdge *edges = malloc((m > 0 ? m : 1) * sizeof(RawEdge));
+    double *sum = calloc(n, sizeof(double));
+    g->row_ptr = calloc(n + 1, sizeof(int));
+    if (!start || !edges || !sum || !g->row_ptr) {
+        free(raw);
+        free(start);
+        free(edges);
+        free(sum);
+        adjCsrFree(g);
+        return 2;
+    }
+
+    for (int k = 0; k < m; k++) start[raw[k].u + 1]++;
+    for (int i = 0; i < n; i++) start[i + 1] += start[i];
+    for (int k = 0; k < m; k++) edges[start[raw[k].u]++] = raw[k];
+    for (int i = n; i > 0; i--) start[i] = start[i - 1];
+    start[0] = 0;
+    free(raw);
+
+    int dups = 0;
+
+    #pragma omp parallel for reduction(+:dups) schedule(dynamic, 256)
+    for (int i = 0; i < n; i++) {
+        RawEdge *row = edges + start[i];
+        int len = start[i + 1] - start[i];
+
+        /* The source is implied by the bucket: u now holds the line position */
+        for (int k = 0; k < len; k++) row[k].u = k;
+        qsort(row, len, sizeof(RawEdge), compareTargets);
+
+        /* Merge equal targets in double (Neumaier), compact the row in place */
+        int out = 0, rowDups = 0;
+        double rs = 0.0, rc = 0.0;
+        for (int k = 0; k < len; ) {
+            double p = 0.0;
+            int v = row[k].v, first = k;
+            for (; k < len && row[k].v == v; k++) p += row[k].p;
+            rowDups += k - first - 1;
+
+            double t = rs + p;
+            if (fabs(rs) >= p) rc += (rs - t) + p;
+            else rc += (p - t) + rs;
+            rs = t;
+
+            row[out].u = row[first].u;
+            row[out].v = v;
+            row[out].p = (float)p;
+            out++;
+        }
+        sum[i] = rs + rc;
+        qsort(row, out, sizeof(RawEdge), comparePositions);
+        dups += rowDups;
+        g->row_ptr[i + 1] = out;
+    }
+
+    if (duplicates) *duplicates = dups;
+
+    /* The file is refused: nothing to lay out */
+    if (policy == DUP_REJECT && dups > 0) {
+        free(start);
+        free(edges);
+        free(sum);
+        adjCsrFree(g);
+        return 3;
+    }
+
+    for (int i = 0; i < n; i++) g->row_ptr[i + 1] += g->row_ptr[i];
+    g->n = n;
+    g->nnz = g->row_ptr[n];
+    g->v = malloc((g->nnz > 0 ? g->nnz : 1) * sizeof(int));
+    g->p = malloc((g->nnz > 0 ? g->nnz : 1) * sizeof(float));
+    if (!g->v || !g->p) {
+        free(start);
+        free(edges);
+        free(sum);
+        adjCsrFree(g);
+        return 2;
+    }
+
+    /* Each row in list order: last line of the file first, as head insertion gives */
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int i = 0; i < n; i++) {
+        const RawEdge *row = edges + start[i];
+        int first = g->row_ptr[i], out = g->row_ptr[i + 1] - first;
+        for (int k = 0; k < out; k++) {
+            g->v[first + k] = row[out - 1 - k].v;
+            g->p[first + k] = row[out - 1 - k].p;
+        }
+    }
+
+    free(start);
+    free(edges);
+
+    if (row_sum) *row_sum = sum;
+    else free(sum);
+
+    return 0;
+}
+
+// Lists holding the compact graph, each row in the same order
+AdjList *adjFromCsr(const AdjCsr *g) {
+    if (!g || !g->row_ptr) return NULL;
+
+    AdjList *adj = adjCreate(g->n);
+    if (!adj) return NULL;
+
+    int failed = 0;
+
+    #pragma omp parallel for reduction(+:failed) schedule(dynamic, 256)
+    for (int i = 0; i < g->n; i++) {
+        EdgeCell **tail = &adj->L[i].head;
+        for (int e = g->row_ptr[i]; e < g->row_ptr[i + 1]; e++) {
+            EdgeCell *cell = malloc(sizeof(EdgeCell));
+            if (!cell) {
+                failed++;
+                break;
+            }
+            cell->v = g->v[e];
+            cell->p = g->p[e];
+            cell->next = NULL;
+            *tail = cell;
+            tail = &cell->next;
+        }
+    }
+
+    if (failed) {
+        adjFree(adj);
+        return NULL;
+    }
     return adj;
 }
 
+// Compact copy of the lists, each row in list order
+int adjToCsr(const AdjList *adj, AdjCsr *g) {
+    if (!adj || !g) return 1;
+    memset(g, 0, sizeof(*g));
+
+    g->row_ptr = malloc((adj->n + 1) * sizeof(int));
+    if (!g->row_ptr) return 2;
+
+    g->row_ptr[0] = 0;
+    for (int i = 0; i < adj->n; i++) {
+        int len = 0;
+        for (EdgeCell *cur = adj->L[i].head; cur != NULL; cur = cur->next) len++;
+        g->row_ptr[i + 1] = g->row_ptr[i] + len;
+    }
+
+    g->n = adj->n;
+    g->nnz = g->row_ptr[adj->n];
+    g->v = malloc((g->nnz > 0 ? g->nnz : 1) * sizeof(int));
+    g->p = malloc((g->nnz > 0 ? g->nnz : 1) * sizeof(float));
+    if (!g->v || !g->p) {
+        adjCsrFree(g);
+        return 2;
+    }
+
+    for (int i = 0; i < adj->n; i++) {
+        int e = g->row_ptr[i];
+        for (EdgeCell *cur = adj->L[i].head; cur != NULL; cur = cur->next, e++) {
+            g->v[e] = cur->v;
+            g->p[e] = cur->p;
+        }
+    }
+    return 0;
+}
+
+// Free the arrays of a compact graph (never a view of a store)
+void adjCsrFree(AdjCsr *g) {
+    if (!g) return;
+
+    free(g->row_ptr);
+    free(g->v);
+    free(g->p);
+
+    g->row_ptr = NULL;
+    g->v = NULL;
+    g->p = NULL;
+    g->n = 0;
+    g->nnz = 0;
+}
+
+// Memory footprint of the compact form
+long adjCsrBytes(const AdjCsr *g) {
+    if (!g) return 0;
+    return (long)(g->n + 1) * (long)sizeof(int) + (long)g->nnz * (long)(sizeof(int) + sizeof(float));
+}
+
+// Write graph to file (same format as adjReadFile)
+int adjWriteFile(const AdjList *adj, const char *filename) {
+    if (!adj || !filename) return 1;
+
+    FILE *f = fopen(filename, "wt");
+    if (!f) return 2;
+
+    /* Large stdio buffer: the file is written sequentially in big blocks */
+    setvbuf(f, NULL, _IOFBF, 1 << 20);
+
+    fprintf(f, "%d\n", adj->n);
+    for (int i = 0; i < adj->n; i++) {
+        for (EdgeCell *cur = adj->L[i].head; cur != NULL; cur = cur->next) {
+            fprintf(f, "%d %d %.7g\n", i + 1, cur->v + 1, cur->p);
+        }
+    }
+
+    int err = ferror(f);
+    if (fclose(f) != 0 || err) return 3;
+    return 0;
+}
+
+// Write graph to file in the binary format
+int adjWriteBinaryFile(const AdjList *adj, const char *filename) {
+    if (!adj || !filename) return 1;
+
+    FILE *f = fopen(filename, "wb");
+    if (!f) return 2;
+
+    setvbuf(f, NULL, _IOFBF, 1 << 20);
+
+    int32_t n32 = adj->n;
+    fwrite(ADJ_BINARY_MAGIC, 1, 4, f);
+    fwrite(&n32, sizeof(n32), 1, f);
+
+    for (int i = 0; i < adj->n; i++) {
+        for (EdgeCell *cur = adj->L[i].head; cur != NULL; cur = cur->next) {
+            BinaryEdge rec = {i + 1, cur->v + 1, cur->p};
+            fwrite(&rec, sizeof(rec), 1, f);
+        }
+    }
+
+    int err = ferror(f);
+    if (fclose(f) != 0 || err) return 3;
+    return 0;
+}
+
+// Memory footprint of the graph, walking every list
+long adjBytes(const AdjList *adj) {
+    if (!adj) return 0;
+
+    long bytes = (long)adj->n * (long)sizeof(EdgeList);
+    for (int i = 0; i < adj->n; i++) {
+        for (EdgeCell *cur = adj->L[i].head; cur != NULL; cur = cur->next) {
+            bytes += (long)sizeof(EdgeCell);
+        }
+    }
+    return bytes;
+}
+
 // Display adj list (debugging)
 void adjPrint(AdjList *adj) {
     if (!adj) return;
@@ -0,0 +1,371 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "analysis_cache.h"
+#include "file_name.h"
+
+/* Section tags */
+#define TAG_PARTITION  1u
+#define TAG_LINKS      2u
+#define TAG_PERIODS    3u
+#define TAG_STATIONARY 4u
+#define TAG_TEXTS      5u
+#define TAG_SETTINGS   6u
+#define TAG_END        0xFFFFFFFFu
+
+/* Output buffer of analysisCacheSave */
+#define CACHE_WRITE_BUFFER (1 << 20)
+
+/* Bounded reader over the file contents */
+typedef struct {
+    const unsigned char *p;
+    size_t left;
+} t_reader;
+
+static int take(t_reader *r, void *dst, size_t size) {
+    if (r->left < size) return 1;
+    memcpy(dst, r->p, size);
+    r->p += size;
+    r->left -= size;
+    return 0;
+}
+
+static uint64_t mix(uint64_t h, uint64_t x) {
+    h ^= x;
+    h *= 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 32);
+}
+
+/* Same lists, same order, same float bits: same hash. The format version is
+   mixed in so that results saved by an older layout are never reused. */
+uint64_t analysisGraphHash(const AdjList *adj) {
+    uint64_t h = mix(0x6D6B6131ULL, ANALYSIS_CACHE_VERSION);
+    if (adj == NULL) return h;
+
+    h = mix(h, (uint64_t)adj->n);
+    for (int u = 0; u < adj->n; u++) {
+        for (const EdgeCell *e = adj->L[u].head; e != NULL; e = e->next) {
+            uint32_t bits;
+            memcpy(&bits, &e->p, sizeof(bits));
+            h = mix(h, ((uint64_t)(uint32_t)e->v << 32) | bits);
+        }
+        h = mix(h, 0xFFFFFFFF00000000ULL | (uint32_t)u);   /* end of list u */
+    }
+    return h;
+}
+
+uint64_t analysisGraphHashCsr(const AdjCsr *g) {
+    uint64_t h = mix(0x6D6B6131ULL, ANALYSIS_CACHE_VERSION);
+    if (g == NULL || g->row_ptr == NULL) return h;
+
+    h = mix(h, (uint64_t)g->n);
+    for (int u = 0; u < g->n; u++) {
+        for (int e = g->row_ptr[u]; e < g->row_ptr[u + 1]; e++) {
+            uint32_t bits;
+            memcpy(&bits, &g->p[e], sizeof(bits));
+            h = mix(h, ((uint64_t)(uint32_t)g->v[e] << 32) | bits);
+        }
+        h = mix(h, 0xFFFFFFFF00000000ULL | (uint32_t)u);   /* end of row u */
+    }
+    return h;
+}
+
+uint64_t analysisSettingsHash(const char *description) {
+    uint64_t h = mix(0x73657474ULL, ANALYSIS_CACHE_VERSION);
+    for (const unsigned char *p = (const unsigned char *)description; p != NULL && *p; p++) {
+        h = mix(h, *p);
+    }
+    return h;
+}
+
+void analysisCacheInit(t_analysis_cache *cache, const AdjList *adj) {
+    memset(cache, 0, sizeof(*cache));
+    cache->hash = analysisGraphHash(adj);
+    cache->n = adj != NULL ? adj->n : 0;
+    initLinkArray(&cache->links);
+}
+
+void analysisCacheInitCsr(t_analysis_cache *cache, const AdjCsr *g) {
+    memset(cache, 0, sizeof(*cache));
+    cache->hash = analysisGraphHashCsr(g);
+    cache->n = g != NULL ? g->n : 0;
+    initLinkArray(&cache->links);
+}
+
+void analysisCacheFree(t_analysis_cache *cache) {
+    if (cache == NULL) return;
+
+    if (cache->has_partition) partitionFree(&cache->part);
+    if (cache->has_links) freeLinkArray(&cache->links);
+    free(cache->period);
+    free(cache->stationary);
+    for (int i = 0; i < cache->text_count; i++) textBufferFree(&cache->texts[i]);
+    free(cache->texts);
+
+    cache->has_partition = 0;
+    cache->has_links = 0;
+    cache->period = NULL;
+    cache->stationary = NULL;
+    cache->texts = NULL;
+    cache->text_count = 0;
+}
+
+/* Helper : classes sizes then members; checks that they cover 1..n exactly once */
+static int readPartition(t_reader *r, t_analysis_cache *c) {
+    int count;
+    if (take(r, &count, sizeof(int)) != 0 || count < 0 || count > c->n) return 1;
+
+    c->part = partitionCreate(c->n);
+    c->has_partition = 1;
+    if (c->n > 0 && c->part.v2c == NULL) return 2;
+
+    c->part.classes = calloc(count > 0 ? count : 1, sizeof(Class));
+    if (c->part.classes == NULL) return 2;
+    c->part.count = count;
+
+    for (int k = 0; k < count; k++) {
+        int size;
+        if (take(r, &size, sizeof(int)) != 0 || size <= 0 || size > c->n) return 1;
+        c->part.classes[k].vertices = malloc(size * sizeof(int));
+        if (c->part.classes[k].vertices == NULL) return 2;
+        c->part.classes[k].size = size;
+    }
+
+    int seen = 0;
+    for (int k = 0; k < count; k++) {
+        Class *cl = &c->part.classes[k];
+        if (take(r, cl->vertices, cl->size * sizeof(int)) != 0) return 1;
+        for (int i = 0; i < cl->size; i++) {
+            int v = cl->vertices[i];
+            if (v < 1 || v > c->n || c->part.v2c[v] != -1) return 1;
+            c->part.v2c[v] = k;
+            seen++;
+        }
+    }
+    return seen == c->n ? 0 : 1;
+}
+
+static int readLinks(t_reader *r, t_analysis_cache *c) {
+    int size;
+    if (take(r, &size, sizeof(int)) != 0 || size < 0 || (size_t)size > r->left / sizeof(t_link)) return 1;
+
+    c->has_links = 1;
+    c->links.data = malloc((size > 0 ? size : 1) * sizeof(t_link));
+    if (c->links.data == NULL) return 2;
+    c->links.capacity = size > 0 ? size : 1;
+
+    if (take(r, c->links.data, size * sizeof(t_link)) != 0) return 1;
+    c->links.size = size;
+    return 0;
+}
+
+static int readTexts(t_reader *r, t_analysis_cache *c) {
+    int count;
+    if (take(r, &count, sizeof(int)) != 0 || count < 0 || (size_t)count > r->left / sizeof(uint64_t)) return 1;
+
+    c->texts = calloc(count > 0 ? count : 1, sizeof(t_text_buffer));
+    if (c->texts == NULL) return 2;
+    c->text_count = count;
+
+    for (int i = 0; i < count; i++) {
+        uint64_t len;
+        if (take(r, &len, sizeof(len)) != 0 || len > r->left) return 1;
+        if (textBufferAppend(&c->texts[i], (const char *)r->p, (size_t)len) != 0) return 2;
+        r->p += len;
+        r->left -= len;
+    }
+    return 0;
+}
+
+/* Helper : parse the whole file image */
+static int parseCache(t_reader *r, t_analysis_cache *c) {
+    char magic[4];
+    uint32_t version;
+    uint64_t hash;
+    int n;
+
+    if (take(r, magic, 4) != 0 || memcmp(magic, ANALYSIS_CACHE_MAGIC, 4) != 0) return 1;
+    if (take(r, &version, sizeof(version)) != 0 || version != ANALYSIS_CACHE_VERSION) return 1;
+    if (take(r, &hash, sizeof(hash)) != 0 || hash != c->hash) return 1;
+    if (take(r, &n, sizeof(n)) != 0 || n != c->n) return 1;
+
+    int ended = 0;
+    while (r->left > 0 && !ended) {
+        uint32_t tag;
+        uint64_t len;
+        if (take(r, &tag, sizeof(tag)) != 0 || take(r, &len, sizeof(len)) != 0 || len > r->left) return 1;
+        if (tag == TAG_END) {
+            ended = (len == 0 && r->left == 0);
+            if (!ended) return 1;
+            continue;
+        }
+
+        t_reader section = {r->p, (size_t)len};
+        r->p += len;
+        r->left -= len;
+
+        int rc = 0;
+        if (tag == TAG_PARTITION && !c->has_partition) {
+            rc = readPartition(&section, c);
+        } else if (tag == TAG_LINKS && !c->has_links) {
+            rc = readLinks(&section, c);
+        } else if (tag == TAG_PERIODS && c->period == NULL) {
+            int count;
+            if (take(&section, &count, sizeof(int)) != 0 || count < 0 || count > n) return 1;
+            c->period = malloc((count > 0 ? count : 1) * sizeof(int));
+            if (c->period == NULL) return 2;
+            rc = take(&section, c->period, count * sizeof(int));
+        } else if (tag == TAG_STATIONARY && c->stationary == NULL) {
+            c->stationary = malloc((n > 0 ? n : 1) * sizeof(double));
+            if (c->stationary == NULL) return 2;
+            rc = take(&section, c->stationary, n * sizeof(double));
+        } else if (tag == TAG_TEXTS && c->texts == NULL) {
+            rc = readTexts(&section, c);
+        } else if (tag == TAG_SETTINGS) {
+            rc = take(&section, &c->settings, sizeof(c->settings));
+        }
+        if (rc != 0) return rc;
+    }
+
+    if (!ended) return 1;
+
+    /* Links and periods refer to classes */
+    if ((c->has_links || c->period != NULL) && !c->has_partition) return 1;
+    for (int i = 0; c->has_links && i < c->links.size; i++) {
+        const t_link *l = &c->links.data[i];
+        if (l->from_class < 0 || l->from_class >= c->part.count ||
+            l->to_class < 0 || l->to_class >= c->part.count) return 1;
+    }
+    return 0;
+}
+
+int analysisCacheLoad(const char *path, t_analysis_cache *cache) {
+    if (path == NULL || cache == NULL) return 1;
+
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return 1;
+
+    long size = -1;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    if (size < 0 || fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return 1;
+    }
+
+    unsigned char *data = malloc(size > 0 ? size : 1);
+    if (data == NULL) {
+        fclose(f);
+        return 2;
+    }
+    size_t got = fread(data, 1, size, f);
+    fclose(f);
+
+    t_reader r = {data, got};
+    int rc = (got == (size_t)size) ? parseCache(&r, cache) : 1;
+    free(data);
+
+    if (rc != 0) {
+        /* Stale or damaged: start from an empty cache */
+        uint64_t hash = cache->hash;
+        int n = cache->n;
+        analysisCacheFree(cache);
+        memset(cache, 0, sizeof(*cache));
+        cache->hash = hash;
+        cache->n = n;
+        initLinkArray(&cache->links);
+    }
+    return rc;
+}
+
+static void putSection(FILE *f, uint32_t tag, uint64_t len) {
+    fwrite(&tag, sizeof(tag), 1, f);
+    fwrite(&len, sizeof(len), 1, f);
+}
+
+int analysisCacheSave(const char *path, const t_analysis_cache *cache) {
+    if (path == NULL || cache == NULL) return 1;
+
+    /* A unique name beside path: two programs saving at once never share it */
+    char tmp[1024];
+    if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= (int)sizeof(tmp)) return 1;
+
+    int fd = mkstemp(tmp);
+    if (fd < 0) return 2;
+    fchmod(fd, 0644);
+    FILE *f = fdopen(fd, "wb");
+    if (f == NULL) {
+        close(fd);
+        remove(tmp);
+        return 2;
+    }
+    setvbuf(f, NULL, _IOFBF, CACHE_WRITE_BUFFER);
+
+    uint32_t version = ANALYSIS_CACHE_VERSION;
+    fwrite(ANALYSIS_CACHE_MAGIC, 1, 4, f);
+    fwrite(&version, sizeof(version), 1, f);
+    fwrite(&cache->hash, sizeof(cache->hash), 1, f);
+    fwrite(&cache->n, sizeof(cache->n), 1, f);
+
+    const Partition *p = &cache->part;
+    if (cache->has_partition) {
+        putSection(f, TAG_PARTITION, (uint64_t)(1 + p->count + cache->n) * sizeof(int));
+        fwrite(&p->count, sizeof(int), 1, f);
+        for (int k = 0; k < p->count; k++) fwrite(&p->classes[k].size, sizeof(int), 1, f);
+        for (int k = 0; k < p->count; k++) {
+            fwrite(p->classes[k].vertices, sizeof(int), p->classes[k].size, f);
+        }
+    }
+
+    if (cache->has_links) {
+        putSection(f, TAG_LINKS, sizeof(int) + (uint64_t)cache->links.size * sizeof(t_link));
+        fwrite(&cache->links.size, sizeof(int), 1, f);
+        fwrite(cache->links.data, sizeof(t_link), cache->links.size, f);
+    }
+
+    if (cache->period != NULL && cache->has_partition) {
+        putSection(f, TAG_PERIODS, (uint64_t)(1 + p->count) * sizeof(int));
+        fwrite(&p->count, sizeof(int), 1, f);
+        fwrite(cache->period, sizeof(int), p->count, f);
+    }
+
+    if (cache->stationary != NULL) {
+        putSection(f, TAG_STATIONARY, (uint64_t)cache->n * sizeof(double));
+        fwrite(cache->stationary, sizeof(double), cache->n, f);
+    }
+
+    if (cache->settings != 0) {
+        putSection(f, TAG_SETTINGS, sizeof(cache->settings));
+        fwrite(&cache->settings, sizeof(cache->settings), 1, f);
+    }
+
+    if (cache->texts != NULL) {
+        uint64_t len = sizeof(int);
+        for (int i = 0; i < cache->text_count; i++) len += sizeof(uint64_t) + cache->texts[i].len;
+        putSection(f, TAG_TEXTS, len);
+        fwrite(&cache->text_count, sizeof(int), 1, f);
+        for (int i = 0; i < cache->text_count; i++) {
+            uint64_t tl = cache->texts[i].len;
+            fwrite(&tl, sizeof(tl), 1, f);
+            if (tl > 0) fwrite(cache->texts[i].data, 1, tl, f);
+        }
+    }
+
+    putSection(f, TAG_END, 0);
+
+    int rc = ferror(f) ? 2 : 0;
+    if (fclose(f) != 0) rc = 2;
+    if (rc == 0 && rename(tmp, path) != 0) rc = 2;
+    if (rc != 0) remove(tmp);
+    return rc;
+}
+
+int analysisCacheEnabled(void) {
+    const char *env = getenv("MARKOV_NO_CACHE");
+    return env == NULL || env[0] == '\0' || strcmp(env, "0") == 0;
+}
+
+void analysisCachePath(char *out, size_t cap, const char *dir, const char *input) {
+    fileStemPath(out, cap, dir, input, "_analysis.bin");
+}
@@ -1,5 +1,10 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "export_mermaid.h"
 
 size_t nodeId(int idx1, char *out, size_t out_cap) {
@@ -35,74 +40,462 @@ size_t nodeId(int idx1, char *out, size_t out_cap) {
     return len;
 }
 
-int writeMermaid(const AdjList *adj, const char *filepath) {
-    if (adj == NULL || filepath == NULL) {
+/* ---------- Buffered writer ---------- */
+
+// Bytes collected before each write() call
+#define MMD_BUFFER_SIZE (1 << 20)
+
+// Longest line the exporter can produce (two ids, a probability, arrows)
+#define MMD_LINE_MAX 128
+
+typedef struct {
+    int fd;
+    char *buf;
+    size_t len;
+    int failed;
+} MermaidWriter;
+
+// Send the whole buffer to the file, retrying on partial writes
+static void writerFlush(MermaidWriter *w) {
+    size_t done = 0;
+    while (done < w->len && !w->failed) {
+        ssize_t k = write(w->fd, w->buf + done, w->len - done);
+        if (k < 0) {
+            if (errno == EINTR) continue;
+            w->failed = 1;
+        } else {
+            done += (size_t)k;
+        }
+    }
+    w->len = 0;
+}
+
+// Guarantee room for one more line
+static char *writerLine(MermaidWriter *w) {
+    if (MMD_BUFFER_SIZE - w->len < MMD_LINE_MAX) {
+        writerFlush(w);
+    }
+    return w->buf + w->len;
+}
+
+static char *putText(char *p, const char *s, size_t len) {
+    memcpy(p, s, len);
+    return p + len;
+}
+
+// Decimal digits of a non-negative integer
+static char *putUnsigned(char *p, unsigned long long x) {
+    char tmp[24];
+    int len = 0;
+    do {
+        tmp[len++] = (char)('0' + x % 10);
+        x /= 10;
+    } while (x > 0);
+    while (len > 0) *p++ = tmp[--len];
+    return p;
+}
+
+// Same text as printf("%.2f", p) without going through printf:
+// float * 100 is exact in double, so rint() rounds exactly as printf does
+static char *putProbability(char *p, float value) {
+    double x = (double)value * 100.0;
+    if (!(fabs(x) < 1e15)) {
+        return p + snprintf(p, MMD_LINE_MAX / 2, "%.2f", value);
+    }
+
+    double r = rint(x);
+    if (signbit(r)) *p++ = '-';
+    unsigned long long c = (unsigned long long)fabs(r);
+
+    p = putUnsigned(p, c / 100);
+    *p++ = '.';
+    *p++ = (char)('0' + (c / 10) % 10);
+    *p++ = (char)('0' + c % 10);
+    return p;
+}
+
+// Open the file and allocate the buffer; 0 on success
+static int writerOpen(MermaidWriter *w, const char *filepath) {
+    w->len = 0;
+    w->failed = 0;
+    w->buf = malloc(MMD_BUFFER_SIZE);
+    if (!w->buf) {
         return MMD_ERR_FILE;
     }
 
-    FILE *f = fopen(filepath, "wt");
-    if (!f) {
+    w->fd = open(filepath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (w->fd < 0) {
         fprintf(stderr, "Error writing graph: cannot open '%s' (%s)\n",
                 filepath, strerror(errno));
+        free(w->buf);
         return MMD_ERR_FILE;
     }
 
     // Write Mermaid headers
-    if (fputs(MMD_CONFIG_HEADER, f) == EOF) {
-        fclose(f);
+    w->len = (size_t)(putText(w->buf, MMD_CONFIG_HEADER MMD_FLOWCHART_HEADER,
+                              strlen(MMD_CONFIG_HEADER MMD_FLOWCHART_HEADER)) - w->buf);
+    return MMD_OK;
+}
+
+// Flush, close and release; returns the status of the whole export
+static int writerClose(MermaidWriter *w) {
+    writerFlush(w);
+    int failed = w->failed;
+    if (close(w->fd) != 0) failed = 1;
+    free(w->buf);
+    return failed ? MMD_ERR_FILE : MMD_OK;
+}
+
+// Id of vertex idx1 (1-based), computed on the spot
+static char *putNodeId(char *p, int idx1) {
+    char id[NODE_ID_MAX];
+    size_t len = nodeId(idx1, id, NODE_ID_MAX);
+    return putText(p, id, len);
+}
+
+// Node line: A((1))
+static void emitNode(MermaidWriter *w, int v) {
+    char *p = writerLine(w);
+    p = putNodeId(p, v + 1);
+    p = putText(p, "((", 2);
+    p = putUnsigned(p, (unsigned long long)v + 1);
+    p = putText(p, "))\n", 3);
+    w->len = (size_t)(p - w->buf);
+}
+
+// Edge line: A -->|0.50| B
+static void emitEdge(MermaidWriter *w, int u, int v, float prob) {
+    char *p = writerLine(w);
+    p = putNodeId(p, u + 1);
+    p = putText(p, " -->|", 5);
+    p = putProbability(p, prob);
+    p = putText(p, "| ", 2);
+    p = putNodeId(p, v + 1);
+    *p++ = '\n';
+    w->len = (size_t)(p - w->buf);
+}
+
+/* ---------- Export ---------- */
+
+int writeMermaid(const AdjList *adj, const char *filepath) {
+    if (adj == NULL || filepath == NULL) {
         return MMD_ERR_FILE;
     }
-    if (fputs(MMD_FLOWCHART_HEADER, f) == EOF) {
-        fclose(f);
+
+    // Every id computed once: ids + i * NODE_ID_MAX, length in idLen[i]
+    int n = adj->n;
+    char *ids = malloc((size_t)n * NODE_ID_MAX);
+    unsigned char *idLen = malloc((size_t)n);
+    if (!ids || !idLen) {
+        free(ids);
+        free(idLen);
         return MMD_ERR_FILE;
     }
 
-    // ---- Step 2: Write nodes (A((1)), B((2)), ...) ----
-    char id[NODE_ID_MAX];
-    for (size_t i = 0; i < adj->n; ++i) {
-        size_t len = nodeId((int)(i + 1), id, NODE_ID_MAX);
-        if (len == 0) {
-            fclose(f);
-            return MMD_ERR_FILE;
-        }
-        if (fprintf(f, "%s((%d))\n", id, (int)(i + 1)) < 0) {
-            fclose(f);
+    for (int i = 0; i < n; ++i) {
+        idLen[i] = (unsigned char)nodeId(i + 1, ids + (size_t)i * NODE_ID_MAX, NODE_ID_MAX);
+        if (idLen[i] == 0) {
+            free(ids);
+            free(idLen);
             return MMD_ERR_FILE;
         }
     }
 
+    MermaidWriter w;
+    if (writerOpen(&w, filepath) != MMD_OK) {
+        free(ids);
+        free(idLen);
+        return MMD_ERR_FILE;
+    }
+
+    // ---- Step 2: Write nodes (A((1)), B((2)), ...) ----
+    for (int i = 0; i < n; ++i) {
+        char *p = writerLine(&w);
+        p = putText(p, ids + (size_t)i * NODE_ID_MAX, idLen[i]);
+        p = putText(p, "((", 2);
+        p = putUnsigned(p, (unsigned long long)i + 1);
+        p = putText(p, "))\n", 3);
+        w.len = (size_t)(p - w.buf);
+    }
+
     // ---- Step 3: Write edges (A -->|p| B) ----
-    char src_id[NODE_ID_MAX];
-    char dst_id[NODE_ID_MAX];
+    for (int u = 0; u < n && !w.failed; ++u) {
+        const char *src = ids + (size_t)u * NODE_ID_MAX;
 
-    for (size_t u = 0; u < adj->n; ++u) {
-        // Generate source node ID (A, B, C...)
-        if (nodeId((int)(u + 1), src_id, NODE_ID_MAX) == 0) {
-            fclose(f);
-            return MMD_ERR_FILE;
+        for (EdgeCell *cur = adj->L[u].head; cur != NULL; cur = cur->next) {
+            if (cur->v < 0 || cur->v >= n) continue;
+
+            char *p = writerLine(&w);
+            p = putText(p, src, idLen[u]);
+            p = putText(p, " -->|", 5);
+            p = putProbability(p, cur->p);
+            p = putText(p, "| ", 2);
+            p = putText(p, ids + (size_t)cur->v * NODE_ID_MAX, idLen[cur->v]);
+            *p++ = '\n';
+            w.len = (size_t)(p - w.buf);
         }
+    }
+
+    free(ids);
+    free(idLen);
+    return writerClose(&w);
+}
+
+/* ---------- Reduced views ---------- */
+
+int writeMermaidCondensed(const AdjList *adj, const Partition *part, const char *filepath) {
+    if (adj == NULL || part == NULL || part->v2c == NULL || filepath == NULL) {
+        return MMD_ERR_FILE;
+    }
+
+    // seen[d] == c + 1 once the link c -> d has been written for source class c
+    int *seen = calloc((size_t)part->count, sizeof(int));
+    if (!seen) {
+        return MMD_ERR_FILE;
+    }
+
+    MermaidWriter w;
+    if (writerOpen(&w, filepath) != MMD_OK) {
+        free(seen);
+        return MMD_ERR_FILE;
+    }
+
+    // One node per class: C1["C1 (3 states)"]
+    for (int c = 0; c < part->count; ++c) {
+        char *p = writerLine(&w);
+        p = putText(p, "C", 1);
+        p = putUnsigned(p, (unsigned long long)c + 1);
+        p = putText(p, "[\"C", 3);
+        p = putUnsigned(p, (unsigned long long)c + 1);
+        p = putText(p, " (", 2);
+        p = putUnsigned(p, (unsigned long long)part->classes[c].size);
+        p = putText(p, part->classes[c].size == 1 ? " state)\"]\n" : " states)\"]\n",
+                    part->classes[c].size == 1 ? 10 : 11);
+        w.len = (size_t)(p - w.buf);
+    }
+
+    // One edge per linked pair of classes, deduplicated in O(1) per graph edge
+    for (int c = 0; c < part->count && !w.failed; ++c) {
+        const Class *cls = &part->classes[c];
+
+        for (int k = 0; k < cls->size; ++k) {
+            int u = cls->vertices[k] - 1;
 
-        // Traverse adjacency list of vertex u
-        EdgeCell *cur = adj->L[u].head;
-        while (cur != NULL) {
-            // Generate destination node ID
-            if (nodeId((int)cur->v + 1, dst_id, NODE_ID_MAX) == 0) {
-                fclose(f);
-                return MMD_ERR_FILE;
+            for (EdgeCell *cur = adj->L[u].head; cur != NULL; cur = cur->next) {
+                int d = part->v2c[cur->v + 1];
+                if (d < 0 || d == c || seen[d] == c + 1) continue;
+                seen[d] = c + 1;
+
+                char *p = writerLine(&w);
+                p = putText(p, "C", 1);
+                p = putUnsigned(p, (unsigned long long)c + 1);
+                p = putText(p, " --> C", 6);
+                p = putUnsigned(p, (unsigned long long)d + 1);
+                *p++ = '\n';
+                w.len = (size_t)(p - w.buf);
             }
+        }
+    }
+
+    free(seen);
+    return writerClose(&w);
+}
+
+int writeMermaidTopK(const AdjList *adj, int k, const char *filepath) {
+    if (adj == NULL || filepath == NULL || k <= 0) {
+        return MMD_ERR_FILE;
+    }
+
+    const EdgeCell **best = malloc((size_t)k * sizeof(EdgeCell *));
+    if (!best) {
+        return MMD_ERR_FILE;
+    }
+
+    MermaidWriter w;
+    if (writerOpen(&w, filepath) != MMD_OK) {
+        free(best);
+        return MMD_ERR_FILE;
+    }
+
+    for (int u = 0; u < adj->n; ++u) {
+        emitNode(&w, u);
+    }
+
+    for (int u = 0; u < adj->n && !w.failed; ++u) {
+        // Keep the k heaviest cells, heaviest first (ties: list order)
+        int kept = 0;
+        for (const EdgeCell *cur = adj->L[u].head; cur != NULL; cur = cur->next) {
+            if (cur->v < 0 || cur->v >= adj->n) continue;
+            if (kept == k && cur->p <= best[k - 1]->p) continue;
 
-            // Write edge: A -->|0.50| B
-            if (fprintf(f, "%s -->|%.2f| %s\n", src_id, cur->p, dst_id) < 0) {
-                fclose(f);
-                return MMD_ERR_FILE;
+            int pos = (kept < k) ? kept++ : k - 1;
+            while (pos > 0 && best[pos - 1]->p < cur->p) {
+                best[pos] = best[pos - 1];
+                pos--;
             }
+            best[pos] = cur;
+        }
 
-            cur = cur->next;
+        for (int i = 0; i < kept; ++i) {
+            emitEdge(&w, u, best[i]->v, best[i]->p);
         }
     }
 
-    fclose(f);
-    return MMD_OK;
+    free(best);
+    return writerClose(&w);
+}
+
+int writeMermaidNeighbourhood(const AdjList *adj, const int *seeds, int seed_count,
+                              int depth, int max_nodes, const char *filepath) {
+    if (adj == NULL || seeds == NULL || seed_count <= 0 || depth < 0 || filepath == NULL) {
+        return MMD_ERR_FILE;
+    }
+
+    int n = adj->n;
+    int cap = (max_nodes > 0 && max_nodes < n) ? max_nodes : n;
+
+    // visited[v] = BFS level + 1; calloc'd pages are only touched where the BFS goes
+    int *visited = calloc((size_t)n, sizeof(int));
+    int *queue = malloc((size_t)cap * sizeof(int));
+    if (!visited || !queue) {
+        free(visited);
+        free(queue);
+        return MMD_ERR_FILE;
+    }
+
+    int count = 0;
+    for (int s = 0; s < seed_count && count < cap; ++s) {
+        int v = seeds[s] - 1;
+        if (v < 0 || v >= n || visited[v]) continue;
+        visited[v] = 1;
+        queue[count++] = v;
+    }
+
+    // Breadth-first, level by level, until depth or the node budget is reached
+    for (int head = 0; head < count && count < cap; ++head) {
+        int u = queue[head];
+        if (visited[u] > depth) break;
+
+        for (EdgeCell *cur = adj->L[u].head; cur != NULL && count < cap; cur = cur->next) {
+            if (cur->v < 0 || cur->v >= n || visited[cur->v]) continue;
+            visited[cur->v] = visited[u] + 1;
+            queue[count++] = cur->v;
+        }
+    }
+
+    MermaidWriter w;
+    if (writerOpen(&w, filepath) != MMD_OK) {
+        free(visited);
+        free(queue);
+        return MMD_ERR_FILE;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        emitNode(&w, queue[i]);
+    }
+
+    // Only edges between emitted states
+    for (int i = 0; i < count && !w.failed; ++i) {
+        int u = queue[i];
+        for (EdgeCell *cur = adj->L[u].head; cur != NULL; cur = cur->next) {
+            if (cur->v >= 0 && cur->v < n && visited[cur->v]) {
+                emitEdge(&w, u, cur->v, cur->p);
+            }
+        }
+    }
+
+    free(visited);
+    free(queue);
+    return writerClose(&w);
+}
+
+MermaidViewOptions mermaidDefaultView(void) {
+    MermaidViewOptions opt;
+    opt.view = MMD_VIEW_AUTO;
+    opt.k = MMD_TOPK_DEFAULT;
+    opt.seeds[0] = 1;
+    opt.seed_count = 1;
+    return opt;
+}
+
+/* Helper : "name" or "name:arg"; returns the argument (NULL if none), or "" on mismatch */
+static const char *viewArgument(const char *text, const char *name) {
+    size_t len = strlen(name);
+    if (strncmp(text, name, len) != 0) return "";
+    if (text[len] == '\0') return NULL;
+    if (text[len] == ':' && text[len + 1] != '\0') return text + len + 1;
+    return "";
 }
 
+int mermaidParseView(const char *text, MermaidViewOptions *opt) {
+    if (text == NULL || opt == NULL) return 1;
 
+    *opt = mermaidDefaultView();
+    if (strcmp(text, "auto") == 0) return 0;
+    if (strcmp(text, "full") == 0) {
+        opt->view = MMD_VIEW_FULL;
+        return 0;
+    }
+    if (strcmp(text, "condensed") == 0) {
+        opt->view = MMD_VIEW_CONDENSED;
+        return 0;
+    }
+
+    const char *arg = viewArgument(text, "topk");
+    if (arg == NULL || *arg != '\0') {
+        opt->view = MMD_VIEW_TOPK;
+        if (arg == NULL) return 0;
+        char *end;
+        long k = strtol(arg, &end, 10);
+        if (*end != '\0' || k < 1 || k > 1000000) return 1;
+        opt->k = (int)k;
+        return 0;
+    }
+
+    arg = viewArgument(text, "neighbourhood");
+    if (arg == NULL || *arg != '\0') {
+        opt->view = MMD_VIEW_NEIGHBOURHOOD;
+        if (arg == NULL) return 0;
+        opt->seed_count = 0;
+        while (*arg != '\0') {
+            char *end;
+            long s = strtol(arg, &end, 10);
+            if (end == arg || s < 1 || s > 0x7fffffffL || opt->seed_count == MMD_SEEDS_MAX) return 1;
+            opt->seeds[opt->seed_count++] = (int)s;
+            if (*end == ',') end++;
+            else if (*end != '\0') return 1;
+            arg = end;
+        }
+        return opt->seed_count > 0 ? 0 : 1;
+    }
+
+    return 1;
+}
+
+int mermaidViewNeedsPartition(const MermaidViewOptions *opt) {
+    return opt != NULL && opt->view == MMD_VIEW_CONDENSED;
+}
+
+int writeMermaidView(const AdjList *adj, const Partition *part,
+                     const MermaidViewOptions *opt, const char *filepath) {
+    if (adj == NULL || opt == NULL) return MMD_ERR_FILE;
+
+    switch (opt->view) {
+        case MMD_VIEW_FULL:
+            return writeMermaid(adj, filepath);
+        case MMD_VIEW_CONDENSED:
+            return writeMermaidCondensed(adj, part, filepath);
+        case MMD_VIEW_TOPK:
+            return writeMermaidTopK(adj, opt->k, filepath);
+        case MMD_VIEW_NEIGHBOURHOOD:
+            return writeMermaidNeighbourhood(adj, opt->seeds, opt->seed_count,
+                                             adj->n, MMD_RENDER_MAX, filepath);
+        case MMD_VIEW_AUTO:
+        default:
+            if (adj->n > MMD_RENDER_MAX) {
+                return writeMermaidNeighbourhood(adj, opt->seeds, opt->seed_count,
+                                                 adj->n, MMD_RENDER_MAX, filepath);
+            }
+            return writeMermaid(adj, filepath);
+    }
+}
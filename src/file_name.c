@@ -0,0 +1,22 @@
+#include <stdio.h>
+#include <string.h>
+#include "file_name.h"
+
+size_t fileStem(const char *path, const char **stem) {
+    const char *base = path;
+    const char *slash1 = strrchr(path, '/');
+    const char *slash2 = strrchr(path, '\\');
+    if (slash1 && slash1 >= base) base = slash1 + 1;
+    if (slash2 && slash2 >= base) base = slash2 + 1;
+
+    const char *dot = strrchr(base, '.');
+    *stem = base;
+    return (dot != NULL && dot > base) ? (size_t)(dot - base) : strlen(base);
+}
+
+int fileStemPath(char *out, size_t cap, const char *dir, const char *input, const char *suffix) {
+    const char *stem;
+    int len = (int)fileStem(input, &stem);
+    int n = snprintf(out, cap, "%s/%.*s%s", dir, len, stem, suffix);
+    return (n < 0 || (size_t)n >= cap) ? 1 : 0;
+}
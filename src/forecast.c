@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "forecast.h"
+
+/* Dense products: columns handled by one task */
+#define FORECAST_BLOCK_COLS 64
+
+/* Sparse products: starts handled by one task */
+#define FORECAST_START_SLICE 8
+
+/* Below this many multiply-adds per product the loops stay sequential */
+#define FORECAST_PARALLEL_MIN 100000L
+
+/* A requested horizon and its position in the request */
+typedef struct {
+    int horizon;
+    int index;
+} t_horizon_slot;
+
+static int compareSlots(const void *a, const void *b) {
+    const t_horizon_slot *x = a, *y = b;
+    if (x->horizon != y->horizon) return x->horizon < y->horizon ? -1 : 1;
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+/* Helper : active[i] = 1 if state i carries mass in some start (other rows are skipped) */
+static void markActive(const double *X, int n, int k, char *active) {
+    for (int i = 0; i < n; i++) {
+        const double *x = X + (size_t)i * k;
+        int any = 0;
+        for (int s = 0; s < k && !any; s++) any = x[s] != 0.0;
+        active[i] = (char)any;
+    }
+}
+
+/* Helper : Y = X * M on dense storage, blocks stored state by state (X[i * k + s]).
+   Tasks own disjoint column ranges and every (j, s) sums over i in increasing
+   order, as vectorMatrixMultiply does: the result does not depend on threads. */
+static void denseStep(const t_matrix *M, const double *X, const char *active, int k, double *Y) {
+    int n = M->size;
+
+    #pragma omp parallel for schedule(static) if ((long)n * n * k > FORECAST_PARALLEL_MIN)
+    for (int jb = 0; jb < n; jb += FORECAST_BLOCK_COLS) {
+        int je = jb + FORECAST_BLOCK_COLS < n ? jb + FORECAST_BLOCK_COLS : n;
+        memset(Y + (size_t)jb * k, 0, (size_t)(je - jb) * k * sizeof(double));
+
+        for (int i = 0; i < n; i++) {
+            if (!active[i]) continue;
+            const double *x = X + (size_t)i * k;
+            const double *row = M->data[i];
+            for (int j = jb; j < je; j++) {
+                double m = row[j];
+                if (m == 0.0) continue;
+                double *y = Y + (size_t)j * k;
+                for (int s = 0; s < k; s++) y[s] += x[s] * m;
+            }
+        }
+    }
+}
+
+/* Helper : starts s0 .. s1 - 1 on sparse storage, through every horizon.
+   The slice has its own blocks (X[i * w + s], w = s1 - s0) and only visits
+   the states that carry mass: rows of X are listed in increasing order, so
+   every (j, s) sums over i as sparseVectorMultiply does. 0, or 2 on allocation failure. */
+static int sparseSlice(const t_sparse_matrix *M, const double *starts, int s0, int s1,
+                       const t_horizon_slot *slots, int count, t_forecast *out) {
+    int n = M->rows, k = out->k, w = s1 - s0;
+    double *X = calloc((size_t)n * w, sizeof(double));
+    double *Y = calloc((size_t)n * w, sizeof(double));
+    int *xrows = malloc(n * sizeof(int));
+    int *yrows = malloc(n * sizeof(int));
+    char *mark = calloc(n, 1);
+    if (!X || !Y || !xrows || !yrows || !mark) {
+        free(X);
+        free(Y);
+        free(xrows);
+        free(yrows);
+        free(mark);
+        return 2;
+    }
+
+    int xcount = 0, ycount = 0;
+    for (int i = 0; i < n; i++) {
+        int any = 0;
+        for (int s = 0; s < w; s++) {
+            X[(size_t)i * w + s] = starts[(size_t)(s0 + s) * n + i];
+            any |= X[(size_t)i * w + s] != 0.0;
+        }
+        if (any) xrows[xcount++] = i;
+    }
+
+    int next = 0;
+    for (int t = 0; ; t++) {
+        for (; next < count && slots[next].horizon == t; next++) {
+            double *snap = out->data + (size_t)slots[next].index * k * n;
+            for (int s = 0; s < w; s++) {
+                double *row = snap + (size_t)(s0 + s) * n;
+                memset(row, 0, n * sizeof(double));
+                for (int r = 0; r < xcount; r++) row[xrows[r]] = X[(size_t)xrows[r] * w + s];
+            }
+        }
+        if (next == count) break;
+
+        /* Y still holds the block of two steps back: clear only its rows */
+        for (int r = 0; r < ycount; r++) memset(Y + (size_t)yrows[r] * w, 0, w * sizeof(double));
+
+        for (int r = 0; r < xcount; r++) {
+            const double *x = X + (size_t)xrows[r] * w;
+            for (int e = M->row_ptr[xrows[r]]; e < M->row_ptr[xrows[r] + 1]; e++) {
+                double m = M->values[e];
+                int j = M->col_idx[e];
+                double *y = Y + (size_t)j * w;
+                mark[j] = 1;
+                for (int s = 0; s < w; s++) y[s] += x[s] * m;
+            }
+        }
+
+        /* Rows of the new block in increasing order; the old rows are cleared next step */
+        int *old = xrows;
+        ycount = xcount;
+        xrows = yrows;
+        yrows = old;
+        xcount = 0;
+        for (int j = 0; j < n; j++) {
+            if (mark[j]) {
+                mark[j] = 0;
+                xrows[xcount++] = j;
+            }
+        }
+
+        double *swap = X;
+        X = Y;
+        Y = swap;
+    }
+
+    free(X);
+    free(Y);
+    free(xrows);
+    free(yrows);
+    free(mark);
+    return 0;
+}
+
+int forecastRun(t_matrix_ref M, const double *starts, int k,
+                const int *horizons, int count, t_forecast *out) {
+    if (out == NULL) return 1;
+    memset(out, 0, sizeof(*out));
+
+    int n = matrixRefSize(M);
+    if (n <= 0 || starts == NULL || k <= 0 || horizons == NULL || count <= 0) return 1;
+    if (M.sparse != NULL && M.sparse->cols != n) return 1;
+    for (int h = 0; h < count; h++) {
+        if (horizons[h] < 0) return 1;
+    }
+
+    size_t block = (size_t)n * k;
+    t_horizon_slot *slots = malloc(count * sizeof(t_horizon_slot));
+    out->horizons = malloc(count * sizeof(int));
+    out->data = malloc(count * block * sizeof(double));
+    if (!slots || !out->horizons || !out->data) {
+        free(slots);
+        forecastFree(out);
+        return 2;
+    }
+
+    out->k = k;
+    out->n = n;
+    out->count = count;
+    memcpy(out->horizons, horizons, count * sizeof(int));
+
+    /* Horizons in increasing order: one sweep serves them all */
+    for (int h = 0; h < count; h++) {
+        slots[h].horizon = horizons[h];
+        slots[h].index = h;
+    }
+    qsort(slots, count, sizeof(t_horizon_slot), compareSlots);
+
+    /* Sparse: slices of starts run independently, each on its own support */
+    if (M.sparse != NULL) {
+        int slices = (k + FORECAST_START_SLICE - 1) / FORECAST_START_SLICE;
+        int failed = 0;
+
+        #pragma omp parallel for schedule(dynamic, 1) reduction(+:failed) if (slices > 1)
+        for (int sl = 0; sl < slices; sl++) {
+            int s0 = sl * FORECAST_START_SLICE;
+            int s1 = s0 + FORECAST_START_SLICE < k ? s0 + FORECAST_START_SLICE : k;
+            failed += sparseSlice(M.sparse, starts, s0, s1, slots, count, out) != 0;
+        }
+
+        free(slots);
+        if (failed) {
+            forecastFree(out);
+            return 2;
+        }
+        return 0;
+    }
+
+    /* Dense: one shared block, M read once per product for all k starts */
+    double *X = malloc(block * sizeof(double));
+    double *Y = malloc(block * sizeof(double));
+    char *active = malloc(n);
+    if (!X || !Y || !active) {
+        free(slots);
+        free(X);
+        free(Y);
+        free(active);
+        forecastFree(out);
+        return 2;
+    }
+
+    for (int s = 0; s < k; s++) {
+        for (int i = 0; i < n; i++) X[(size_t)i * k + s] = starts[(size_t)s * n + i];
+    }
+
+    int next = 0;
+    for (int t = 0; ; t++) {
+        /* Snapshots due now, back in the start-by-start layout */
+        for (; next < count && slots[next].horizon == t; next++) {
+            double *snap = out->data + (size_t)slots[next].index * block;
+            for (int s = 0; s < k; s++) {
+                for (int i = 0; i < n; i++) snap[(size_t)s * n + i] = X[(size_t)i * k + s];
+            }
+        }
+        if (next == count) break;
+
+        markActive(X, n, k, active);
+        denseStep(M.dense, X, active, k, Y);
+
+        double *swap = X;
+        X = Y;
+        Y = swap;
+    }
+
+    free(slots);
+    free(X);
+    free(Y);
+    free(active);
+    return 0;
+}
+
+int forecastFromStates(t_matrix_ref M, const int *states, int k,
+                       const int *horizons, int count, t_forecast *out) {
+    if (out != NULL) memset(out, 0, sizeof(*out));
+
+    int n = matrixRefSize(M);
+    if (n <= 0 || states == NULL || k <= 0) return 1;
+    for (int s = 0; s < k; s++) {
+        if (states[s] < 0 || states[s] >= n) return 1;
+    }
+
+    double *starts = calloc((size_t)n * k, sizeof(double));
+    if (!starts) return 2;
+    for (int s = 0; s < k; s++) starts[(size_t)s * n + states[s]] = 1.0;
+
+    int rc = forecastRun(M, starts, k, horizons, count, out);
+    free(starts);
+    return rc;
+}
+
+const double *forecastRow(const t_forecast *f, int h, int s) {
+    if (f == NULL || f->data == NULL || h < 0 || h >= f->count || s < 0 || s >= f->k) return NULL;
+    return f->data + ((size_t)h * f->k + s) * f->n;
+}
+
+void forecastFree(t_forecast *f) {
+    if (f == NULL) return;
+
+    free(f->horizons);
+    free(f->data);
+
+    f->horizons = NULL;
+    f->data = NULL;
+    f->k = 0;
+    f->n = 0;
+    f->count = 0;
+}
@@ -0,0 +1,294 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "adj_list.h"
+#include "generator.h"
+#include "text_buffer.h"
+
+/* Probabilities are drawn in millionths so that every row sums to exactly 1 */
+#define GEN_UNITS 1000000
+
+/* Bytes collected before each fwrite */
+#define GEN_FLUSH_SIZE (1 << 20)
+
+/* ---------- Random numbers (counter-based: state u has its own stream) ---------- */
+
+static unsigned long long mix64(unsigned long long x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+typedef struct {
+    unsigned long long key;
+    unsigned long long counter;
+} t_gen_rng;
+
+static unsigned long long genNext(t_gen_rng *r) {
+    return mix64(r->key + 0x632BE59BD9B4E019ULL * ++r->counter);
+}
+
+/* Uniform integer in [0, bound) */
+static long long genBelow(t_gen_rng *r, long long bound) {
+    return (long long)(genNext(r) % (unsigned long long)bound);
+}
+
+/* Uniform double in (0, 1] */
+static double genUnit(t_gen_rng *r) {
+    return ((genNext(r) >> 11) + 1) * (1.0 / 9007199254740992.0);
+}
+
+/* ---------- Buffered output ---------- */
+
+/* Write the buffer out once it is large enough */
+static int flushIfFull(t_text_buffer *b, FILE *f) {
+    if (b->len < GEN_FLUSH_SIZE) return 0;
+    return textBufferFlush(b, f);
+}
+
+/* One edge, 1-based, probability given in millionths; 0 on success */
+static int writeEdge(t_text_buffer *b, t_gen_format format, int u, int v, int units) {
+    if (format == GEN_BINARY) {
+        BinaryEdge rec = {u, v, (float)units / GEN_UNITS};
+        return textBufferAppend(b, (const char *)&rec, sizeof(rec));
+    }
+
+    /* Fixed six decimals, "0.250000\n" */
+    char prob[9];
+    int frac = units % GEN_UNITS;
+    prob[0] = (char)('0' + units / GEN_UNITS);
+    prob[1] = '.';
+    for (int i = 7, rest = frac; i >= 2; i--, rest /= 10) prob[i] = (char)('0' + rest % 10);
+    prob[8] = '\n';
+
+    int rc = textBufferAppendInt(b, u);
+    rc |= textBufferAppend(b, " ", 1);
+    rc |= textBufferAppendInt(b, v);
+    rc |= textBufferAppend(b, " ", 1);
+    rc |= textBufferAppend(b, prob, sizeof(prob));
+    return rc;
+}
+
+/* ---------- Layout ---------- */
+
+t_gen_options generatorDefaultOptions(void) {
+    t_gen_options opt = {1000, 4, DEGREE_UNIFORM, 10, 2, 0, 2, 1, 0.2, 1, GEN_TEXT,
+                         SIZES_EQUAL, 0.5, NULL};
+    return opt;
+}
+
+/* Requested size of every class (before the periodic trimming); 1 if the
+   sizes cannot cover the non-absorbing states with one state per class at least */
+static int classSizes(const t_gen_options *opt, int *size) {
+    int total = opt->states - opt->absorbing;
+    int classes = opt->classes;
+
+    if (opt->sizes == SIZES_LIST) {
+        long long sum = 0;
+        for (int c = 0; c < classes; c++) {
+            if (opt->size_list[c] < 1) return 1;
+            size[c] = opt->size_list[c];
+            sum += size[c];
+        }
+        return sum == total ? 0 : 1;
+    }
+
+    if (opt->sizes == SIZES_GEOMETRIC) {
+        /* One state each, the rest shared in proportion to ratio^c (scaled so the
+           largest weight is 1); the rounding remainder goes to the first classes */
+        double first = opt->size_ratio > 1.0 ? pow(opt->size_ratio, -(double)(classes - 1)) : 1.0;
+        double wsum = 0.0, w = first;
+        for (int c = 0; c < classes; c++, w *= opt->size_ratio) wsum += w;
+
+        int given = 0;
+        w = first;
+        for (int c = 0; c < classes; c++, w *= opt->size_ratio) {
+            size[c] = 1 + (int)floor((double)(total - classes) * w / wsum);
+            given += size[c];
+        }
+        if (given > total) return 1;
+        for (int c = 0; given < total; c = (c + 1) % classes, given++) size[c]++;
+        return 0;
+    }
+
+    int base = total / classes, rem = total % classes;
+    for (int c = 0; c < classes; c++) size[c] = base + (c < rem);
+    return 0;
+}
+
+/* Class c covers states start[c] .. start[c + 1] - 1 (0-based, after the
+   absorbing states); period[c] is 1 for an aperiodic class. A periodic class
+   is trimmed to a multiple of its period and passes the rest to the next one. */
+static int buildLayout(const t_gen_options *opt, int *start, int *period) {
+    /* start[] holds the requested sizes until it is overwritten below */
+    if (classSizes(opt, start) != 0) return 1;
+
+    int carry = 0, pos = opt->absorbing;
+
+    for (int c = 0; c < opt->classes; c++) {
+        int size = start[c] + carry;
+        carry = 0;
+        period[c] = 1;
+
+        if (c < opt->periodic && opt->period > 1 && c < opt->classes - 1) {
+            int extra = size % opt->period;
+            if (size - extra >= opt->period) {
+                size -= extra;
+                carry = extra;
+                period[c] = opt->period;
+            }
+        } else if (c < opt->periodic && opt->period > 1 && size % opt->period == 0) {
+            period[c] = opt->period;
+        }
+
+        start[c] = pos;
+        pos += size;
+    }
+    start[opt->classes] = pos;
+
+    return pos == opt->states ? 0 : 1;
+}
+
+/* Out-degree of one state */
+static int drawDegree(const t_gen_options *opt, t_gen_rng *r) {
+    int d = opt->degree;
+    switch (opt->law) {
+        case DEGREE_UNIFORM:
+            d = 1 + (int)genBelow(r, 2 * (long long)opt->degree - 1);
+            break;
+        case DEGREE_GEOMETRIC:
+            if (opt->degree > 1) {
+                double q = 1.0 - 1.0 / opt->degree;
+                double k = 1.0 + floor(log(genUnit(r)) / log(q));
+                d = (k > GEN_MAX_DEGREE) ? GEN_MAX_DEGREE : (int)k;
+            }
+            break;
+        default:
+            break;
+    }
+    if (d < 1) d = 1;
+    return d > GEN_MAX_DEGREE ? GEN_MAX_DEGREE : d;
+}
+
+/* ---------- Generation ---------- */
+
+int generateChain(const t_gen_options *opt, FILE *out, long long *edges) {
+    if (edges) *edges = 0;
+    if (opt == NULL || out == NULL || opt->states < 1 || opt->degree < 1 ||
+        opt->classes < 0 || opt->absorbing < 0 ||
+        (long long)opt->absorbing + opt->classes > opt->states ||
+        (opt->classes == 0 && opt->absorbing != opt->states) ||
+        opt->recurrent < 0 || opt->periodic < 0 || opt->periodic > opt->recurrent ||
+        opt->recurrent > opt->classes || opt->period < 1 ||
+        opt->leak < 0.0 || opt->leak >= 1.0 ||
+        (opt->sizes == SIZES_GEOMETRIC && !(opt->size_ratio > 0.0)) ||
+        (opt->sizes == SIZES_LIST && opt->size_list == NULL)) {
+        return 1;
+    }
+
+    int *start = malloc((opt->classes + 1) * sizeof(int));
+    int *period = malloc((opt->classes + 1) * sizeof(int));
+    int *target = malloc((GEN_MAX_DEGREE + 2) * sizeof(int));
+    int *units = malloc((GEN_MAX_DEGREE + 2) * sizeof(int));
+    t_text_buffer b;
+    textBufferInit(&b);
+    if (!start || !period || !target || !units || textBufferReserve(&b, GEN_FLUSH_SIZE + 64) != 0 ||
+        (opt->classes > 0 && buildLayout(opt, start, period) != 0)) {
+        free(start);
+        free(period);
+        free(target);
+        free(units);
+        textBufferFree(&b);
+        return 1;
+    }
+
+    int failed = 0;
+    long long written = 0;
+
+    /* Header */
+    if (opt->format == GEN_BINARY) {
+        int32_t n32 = opt->states;
+        failed |= textBufferAppend(&b, ADJ_BINARY_MAGIC, 4);
+        failed |= textBufferAppend(&b, (const char *)&n32, sizeof(n32));
+    } else {
+        failed |= textBufferAppendInt(&b, opt->states);
+        failed |= textBufferAppend(&b, "\n", 1);
+    }
+
+    /* Absorbing states */
+    for (int u = 0; u < opt->absorbing && !failed; u++) {
+        failed |= writeEdge(&b, opt->format, u + 1, u + 1, GEN_UNITS);
+        failed |= flushIfFull(&b, out);
+        written++;
+    }
+
+    int exitUnits = (int)lround(opt->leak * GEN_UNITS);
+    if (opt->leak > 0.0 && exitUnits == 0) exitUnits = 1;
+
+    for (int c = 0; c < opt->classes && !failed; c++) {
+        int a = start[c], s = start[c + 1] - a, d = period[c];
+        int transient = (c >= opt->recurrent) && a > 0;
+
+        for (int k = 0; k < s && !failed; k++) {
+            int u = a + k;
+            t_gen_rng r = {mix64(opt->seed ^ mix64((unsigned long long)u)), 0};
+
+            int deg = drawDegree(opt, &r);
+            int m = 0;
+
+            /* Ring through the class: keeps it strongly connected */
+            target[m++] = a + (k + 1) % s;
+
+            if (d == 1 && k == 0 && s > 1) {
+                target[m++] = u;                  /* self-loop: aperiodic */
+            } else if (d > 1 && k == d - 1) {
+                target[m++] = a;                  /* cycle of length d: period exactly d */
+            }
+
+            for (int i = 1; i < deg; i++) {
+                if (d > 1) target[m++] = a + (int)genBelow(&r, s / d) * d + (k + 1) % d;
+                else target[m++] = a + (int)genBelow(&r, s);
+            }
+
+            /* One unit per edge, the rest split by random weights,
+               rounding remainder on the ring edge: the row sums to exactly 1 */
+            int mass = transient ? GEN_UNITS - exitUnits : GEN_UNITS;
+            if (m > mass) m = mass;
+
+            long long wsum = 0;
+            for (int i = 0; i < m; i++) {
+                units[i] = 1 + (int)genBelow(&r, 1000);
+                wsum += units[i];
+            }
+            int rest = mass - m, given = 0;
+            for (int i = 0; i < m; i++) {
+                units[i] = 1 + (int)((long long)units[i] * rest / wsum);
+                given += units[i];
+            }
+            units[0] += mass - given;
+
+            for (int i = 0; i < m; i++) {
+                failed |= writeEdge(&b, opt->format, u + 1, target[i] + 1, units[i]);
+            }
+            written += m;
+
+            /* Transient states leak towards an earlier state */
+            if (transient) {
+                failed |= writeEdge(&b, opt->format, u + 1, (int)genBelow(&r, a) + 1, exitUnits);
+                written++;
+            }
+            failed |= flushIfFull(&b, out);
+        }
+    }
+
+    failed |= textBufferFlush(&b, out);
+    if (edges) *edges = written;
+
+    free(start);
+    free(period);
+    free(target);
+    free(units);
+    textBufferFree(&b);
+    return failed ? 2 : 0;
+}
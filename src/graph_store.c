@@ -0,0 +1,410 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "graph_store.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* Helper : shared memory object name, or NULL for a regular file */
+static const char *shmName(const char *name) {
+    size_t len = strlen(GRAPH_STORE_SHM_PREFIX);
+    return strncmp(name, GRAPH_STORE_SHM_PREFIX, len) == 0 ? name + len : NULL;
+}
+
+static uint64_t align8(uint64_t x) {
+    return (x + 7) & ~(uint64_t)7;
+}
+
+int graphStoreIsName(const char *name) {
+    if (name == NULL) return 0;
+    if (shmName(name) != NULL) return 1;
+
+    FILE *f = fopen(name, "rb");
+    if (!f) return 0;
+    char magic[4];
+    int is = fread(magic, 1, 4, f) == 4 && memcmp(magic, GRAPH_STORE_MAGIC, 4) == 0;
+    fclose(f);
+    return is;
+}
+
+/* Helper : header with every offset for this graph */
+static t_graph_store_header storeLayout(int n, int nnz, int class_count) {
+    t_graph_store_header h;
+    memset(&h, 0, sizeof(h));
+    h.version = GRAPH_STORE_VERSION;
+    h.n = n;
+    h.nnz = nnz;
+    h.class_count = class_count;
+
+    uint64_t at = align8(sizeof(h));
+    h.row_ptr = at;  at = align8(at + (uint64_t)(n + 1) * sizeof(int32_t));
+    h.col_idx = at;  at = align8(at + (uint64_t)nnz * sizeof(int32_t));
+    h.values = at;   at = align8(at + (uint64_t)nnz * sizeof(double));
+    h.adj_v = at;    at = align8(at + (uint64_t)nnz * sizeof(int32_t));
+    h.adj_p = at;    at = align8(at + (uint64_t)nnz * sizeof(float));
+    if (class_count >= 0) {
+        h.v2c = at;          at = align8(at + (uint64_t)(n + 1) * sizeof(int32_t));
+        h.class_start = at;  at = align8(at + (uint64_t)(class_count + 1) * sizeof(int32_t));
+        h.members = at;      at = align8(at + (uint64_t)n * sizeof(int32_t));
+    }
+    h.size = at;
+    return h;
+}
+
+/* Helper : fill a writable mapping; the magic is set by the caller, last */
+static int storeFill(unsigned char *base, const t_graph_store_header *h,
+                     const t_sparse_matrix *S, const AdjList *adj, const Partition *part) {
+    int32_t *row_ptr = (int32_t *)(base + h->row_ptr);
+    int32_t *col_idx = (int32_t *)(base + h->col_idx);
+    double *values = (double *)(base + h->values);
+    int32_t *adj_v = (int32_t *)(base + h->adj_v);
+    float *adj_p = (float *)(base + h->adj_p);
+
+    memcpy(row_ptr, S->row_ptr, (size_t)(h->n + 1) * sizeof(int32_t));
+    memcpy(col_idx, S->col_idx, (size_t)h->nnz * sizeof(int32_t));
+    memcpy(values, S->values, (size_t)h->nnz * sizeof(double));
+
+    /* Lists are copied as they are, row by row. Each cell is also found in its
+       sorted row by binary search: a list holding the same target twice would
+       not match its merged CSR row, so it is refused. */
+    int bad = 0;
+    #pragma omp parallel for reduction(+:bad) schedule(dynamic, 256)
+    for (int u = 0; u < h->n; u++) {
+        int k = row_ptr[u];
+        for (const EdgeCell *e = adj->L[u].head; e != NULL; e = e->next, k++) {
+            int lo = row_ptr[u], hi = row_ptr[u + 1] - 1;
+            while (lo < hi) {
+                int mid = (lo + hi) / 2;
+                if (col_idx[mid] < e->v) lo = mid + 1;
+                else hi = mid;
+            }
+            if (k >= row_ptr[u + 1] || lo > hi || col_idx[lo] != e->v) {
+                bad++;
+                break;
+            }
+            adj_v[k] = e->v;
+            adj_p[k] = e->p;
+        }
+        if (k != row_ptr[u + 1]) bad++;
+    }
+    if (bad) return 1;
+
+    if (part != NULL) {
+        int32_t *v2c = (int32_t *)(base + h->v2c);
+        int32_t *class_start = (int32_t *)(base + h->class_start);
+        int32_t *members = (int32_t *)(base + h->members);
+
+        memcpy(v2c, part->v2c, (size_t)(h->n + 1) * sizeof(int32_t));
+        int at = 0;
+        for (int c = 0; c < part->count; c++) {
+            class_start[c] = at;
+            if (at + part->classes[c].size > h->n) return 1;
+            memcpy(members + at, part->classes[c].vertices,
+                   (size_t)part->classes[c].size * sizeof(int32_t));
+            at += part->classes[c].size;
+        }
+        class_start[part->count] = at;
+        if (at != h->n) return 1;
+    }
+    return 0;
+}
+
+int graphStorePublish(const char *name, const AdjList *adj, const Partition *part) {
+    if (name == NULL || adj == NULL || adj->n <= 0) return 1;
+    if (part != NULL && (part->v2c == NULL || part->count < 0)) return 1;
+
+    t_sparse_matrix S = adjToSparse(adj);
+    t_graph_store_header h = storeLayout(adj->n, S.nnz, part != NULL ? part->count : -1);
+
+    /* A file is written beside its final name and renamed; a shared memory
+       object is unlinked first, so attached readers keep their old mapping */
+    const char *shm = shmName(name);
+    char tmp[4096];
+    int fd;
+    if (shm != NULL) {
+        if (shm_unlink(shm) != 0 && errno != ENOENT) {
+            sparseFree(&S);
+            return 3;
+        }
+        fd = shm_open(shm, O_RDWR | O_CREAT | O_EXCL, 0644);
+    } else {
+        /* Unique temporary name: concurrent publishers never write the same file */
+        if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", name) >= (int)sizeof(tmp)) {
+            sparseFree(&S);
+            return 1;
+        }
+        fd = mkstemp(tmp);
+        if (fd >= 0) fchmod(fd, 0644);
+    }
+    if (fd < 0) {
+        sparseFree(&S);
+        return 3;
+    }
+
+    int rc = 3;
+    unsigned char *base = MAP_FAILED;
+    if (ftruncate(fd, (off_t)h.size) == 0) {
+        base = mmap(NULL, h.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (base != MAP_FAILED) {
+        memcpy(base, &h, sizeof(h));
+        rc = storeFill(base, &h, &S, adj, part);
+        if (rc == 0) {
+            memcpy(base, GRAPH_STORE_MAGIC, 4);
+            if (shm == NULL && msync(base, h.size, MS_SYNC) != 0) rc = 3;
+        }
+        munmap(base, h.size);
+    }
+    close(fd);
+    sparseFree(&S);
+
+    if (rc == 0 && shm == NULL && rename(tmp, name) != 0) rc = 3;
+    if (rc != 0) {
+        int saved = errno;
+        if (shm != NULL) shm_unlink(shm);
+        else remove(tmp);
+        errno = saved;
+    }
+    return rc;
+}
+
+int graphStoreUnlink(const char *name) {
+    if (name == NULL) return 1;
+    const char *shm = shmName(name);
+    return (shm != NULL ? shm_unlink(shm) : remove(name)) == 0 ? 0 : 3;
+}
+
+/* Helper : the array at offset off holds count elements of size bytes inside the store */
+static int arrayFits(const t_graph_store_header *h, uint64_t off, uint64_t count, size_t size) {
+    return off % 8 == 0 && off >= sizeof(*h) && off <= h->size
+        && count <= (h->size - off) / size;
+}
+
+/* Helper : every offset and index can be trusted once this returns 0 */
+static int storeCheck(const unsigned char *base, size_t size, t_graph_store *gs) {
+    const t_graph_store_header *h = (const t_graph_store_header *)base;
+    if (memcmp(h->magic, GRAPH_STORE_MAGIC, 4) != 0 || h->version != GRAPH_STORE_VERSION) return 1;
+    if (h->size != size || h->n <= 0 || h->nnz < 0 || h->class_count < -1) return 1;
+
+    uint64_t n = (uint64_t)h->n, nnz = (uint64_t)h->nnz;
+    if (!arrayFits(h, h->row_ptr, n + 1, sizeof(int32_t)) ||
+        !arrayFits(h, h->col_idx, nnz, sizeof(int32_t)) ||
+        !arrayFits(h, h->values, nnz, sizeof(double)) ||
+        !arrayFits(h, h->adj_v, nnz, sizeof(int32_t)) ||
+        !arrayFits(h, h->adj_p, nnz, sizeof(float))) return 1;
+
+    const int32_t *row_ptr = (const int32_t *)(base + h->row_ptr);
+    const int32_t *col_idx = (const int32_t *)(base + h->col_idx);
+    const int32_t *adj_v = (const int32_t *)(base + h->adj_v);
+
+    if (row_ptr[0] != 0 || row_ptr[h->n] != h->nnz) return 1;
+    for (int u = 0; u < h->n; u++) {
+        if (row_ptr[u + 1] < row_ptr[u]) return 1;
+    }
+
+    int bad = 0;
+    #pragma omp parallel for reduction(+:bad) schedule(static)
+    for (int u = 0; u < h->n; u++) {
+        for (int k = row_ptr[u]; k < row_ptr[u + 1]; k++) {
+            if (col_idx[k] < 0 || col_idx[k] >= h->n) bad++;
+            else if (k > row_ptr[u] && col_idx[k] <= col_idx[k - 1]) bad++;
+            if (adj_v[k] < 0 || adj_v[k] >= h->n) bad++;
+        }
+    }
+    if (bad) return 1;
+
+    gs->class_count = -1;
+    if (h->class_count >= 0) {
+        uint64_t count = (uint64_t)h->class_count;
+        if (!arrayFits(h, h->v2c, n + 1, sizeof(int32_t)) ||
+            !arrayFits(h, h->class_start, count + 1, sizeof(int32_t)) ||
+            !arrayFits(h, h->members, n, sizeof(int32_t))) return 1;
+
+        const int32_t *v2c = (const int32_t *)(base + h->v2c);
+        const int32_t *class_start = (const int32_t *)(base + h->class_start);
+        const int32_t *members = (const int32_t *)(base + h->members);
+
+        if (v2c[0] != -1 || class_start[0] != 0 || class_start[count] != h->n) return 1;
+
+        /* Members must list every state exactly once, in the class v2c gives it */
+        char *seen = calloc(n + 1, 1);
+        if (seen == NULL) return 1;
+        for (int c = 0; c < h->class_count && !bad; c++) {
+            if (class_start[c + 1] <= class_start[c] || class_start[c + 1] > h->n) bad++;
+            for (int k = class_start[c]; k < class_start[c + 1] && !bad; k++) {
+                int v = members[k];
+                if (v < 1 || v > h->n || v2c[v] != c || seen[v]) bad++;
+                else seen[v] = 1;
+            }
+        }
+        free(seen);
+        if (bad) return 1;
+
+        gs->class_count = h->class_count;
+        gs->v2c = v2c;
+        gs->class_start = class_start;
+        gs->members = members;
+    }
+
+    gs->n = h->n;
+    gs->nnz = h->nnz;
+    gs->row_ptr = row_ptr;
+    gs->col_idx = col_idx;
+    gs->values = (const double *)(base + h->values);
+    gs->adj_v = adj_v;
+    gs->adj_p = (const float *)(base + h->adj_p);
+    return 0;
+}
+
+int graphStoreAttach(const char *name, t_graph_store *gs) {
+    if (gs == NULL) return 1;
+    memset(gs, 0, sizeof(*gs));
+    if (name == NULL) return 1;
+
+    const char *shm = shmName(name);
+    int fd = shm != NULL ? shm_open(shm, O_RDONLY, 0) : open(name, O_RDONLY);
+    if (fd < 0) return 1;
+
+    struct stat st;
+    void *base = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(t_graph_store_header)) {
+        base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (base == MAP_FAILED) return 1;
+
+    if (storeCheck(base, (size_t)st.st_size, gs) != 0) {
+        munmap(base, (size_t)st.st_size);
+        memset(gs, 0, sizeof(*gs));
+        return 1;
+    }
+    gs->base = base;
+    gs->size = (size_t)st.st_size;
+    return 0;
+}
+
+void graphStoreDetach(t_graph_store *gs) {
+    if (gs == NULL) return;
+    if (gs->base != NULL) munmap(gs->base, gs->size);
+    memset(gs, 0, sizeof(*gs));
+}
+
+#else
+
+/* No POSIX mappings: stores are never recognized and graphOpen only reads files */
+int graphStoreIsName(const char *name) {
+    (void)name;
+    return 0;
+}
+
+int graphStorePublish(const char *name, const AdjList *adj, const Partition *part) {
+    (void)name;
+    (void)adj;
+    (void)part;
+    return 3;
+}
+
+int graphStoreUnlink(const char *name) {
+    (void)name;
+    return 3;
+}
+
+int graphStoreAttach(const char *name, t_graph_store *gs) {
+    (void)name;
+    if (gs != NULL) memset(gs, 0, sizeof(*gs));
+    return 1;
+}
+
+void graphStoreDetach(t_graph_store *gs) {
+    if (gs != NULL) memset(gs, 0, sizeof(*gs));
+}
+
+#endif
+
+t_sparse_matrix graphStoreMatrix(const t_graph_store *gs) {
+    t_sparse_matrix S = {0, 0, 0, NULL, NULL, NULL};
+    if (gs == NULL || gs->base == NULL) return S;
+
+    /* The mapping is read-only: const is dropped only to fit t_sparse_matrix */
+    S.rows = gs->n;
+    S.cols = gs->n;
+    S.nnz = gs->nnz;
+    S.row_ptr = (int *)gs->row_ptr;
+    S.col_idx = (int *)gs->col_idx;
+    S.values = (double *)gs->values;
+    return S;
+}
+
+int graphStorePartition(const t_graph_store *gs, Partition *part) {
+    if (gs == NULL || part == NULL || gs->base == NULL || gs->class_count < 0) return 1;
+
+    part->classes = malloc((gs->class_count > 0 ? gs->class_count : 1) * sizeof(Class));
+    if (part->classes == NULL) return 2;
+
+    for (int c = 0; c < gs->class_count; c++) {
+        part->classes[c].vertices = (int *)gs->members + gs->class_start[c];
+        part->classes[c].size = gs->class_start[c + 1] - gs->class_start[c];
+    }
+    part->count = gs->class_count;
+    part->v2c = (int *)gs->v2c;
+    return 0;
+}
+
+void graphStorePartitionRelease(Partition *part) {
+    if (part == NULL) return;
+    free(part->classes);
+    part->classes = NULL;
+    part->count = 0;
+    part->v2c = NULL;
+}
+
+AdjCsr graphStoreCsr(const t_graph_store *gs) {
+    AdjCsr g = {0, 0, NULL, NULL, NULL};
+    if (gs == NULL || gs->base == NULL) return g;
+
+    /* Read-only mapping: const is dropped only to fit AdjCsr */
+    g.n = gs->n;
+    g.nnz = gs->nnz;
+    g.row_ptr = (int *)gs->row_ptr;
+    g.v = (int *)gs->adj_v;
+    g.p = (float *)gs->adj_p;
+    return g;
+}
+
+AdjList *graphStoreToAdj(const t_graph_store *gs) {
+    if (gs == NULL || gs->base == NULL) return NULL;
+
+    /* Cells come in the stored list order, so lists, hashes and every
+       traversal come out exactly as with the original file */
+    AdjCsr g = graphStoreCsr(gs);
+    return adjFromCsr(&g);
+}
+
+AdjList *graphOpen(const char *name, t_graph_store *gs) {
+    memset(gs, 0, sizeof(*gs));
+    if (!graphStoreIsName(name)) return adjReadFile(name);
+
+    if (graphStoreAttach(name, gs) != 0) return NULL;
+    AdjList *adj = graphStoreToAdj(gs);
+    if (!adj) graphStoreDetach(gs);
+    return adj;
+}
+
+int graphOpenCsr(const char *name, t_graph_store *gs, AdjCsr *g) {
+    memset(gs, 0, sizeof(*gs));
+    memset(g, 0, sizeof(*g));
+    if (!graphStoreIsName(name)) {
+        int rc = adjReadFileCsr(name, DUP_SUM, g, NULL, NULL);
+        return rc == 2 ? 2 : (rc != 0 ? 1 : 0);
+    }
+
+    if (graphStoreAttach(name, gs) != 0) return 1;
+    *g = graphStoreCsr(gs);
+    return 0;
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "hasse.h"
+#include "text_buffer.h"
 
 /* Ensure that the dynamic array has enough capacity. */
 static int ensureCapacity(t_link_array *array) {
@@ -71,8 +72,20 @@ void buildLinksBetweenClasses(const AdjList *adj, const Partition *p, t_link_arr
         return;
     }
 
+    AdjCsr g;
+    if (adjToCsr(adj, &g) != 0) return;
+    buildLinksBetweenClassesCsr(&g, p, links);
+    adjCsrFree(&g);
+}
+
+/* Same on the compact form: links come out in the same order. */
+void buildLinksBetweenClassesCsr(const AdjCsr *g, const Partition *p, t_link_array *links){
+    if (g == NULL || g->row_ptr == NULL || p == NULL || links == NULL) {
+        return;
+    }
+
     const int *v2c = p->v2c;
-    int n = adj->n;
+    int n = g->n;
 
     for (int i = 0; i < n; i++) {
 
@@ -80,11 +93,9 @@ void buildLinksBetweenClasses(const AdjList *adj, const Partition *p, t_link_arr
         int classFrom = v2c[vertex];
         if (classFrom < 0) continue;
 
-        EdgeCell *cell = adj->L[i].head;
-
-        while (cell != NULL) {
+        for (int e = g->row_ptr[i]; e < g->row_ptr[i + 1]; e++) {
 
-            int neighbourVertex = cell->v + 1;
+            int neighbourVertex = g->v[e] + 1;
             int classTo = v2c[neighbourVertex];
 
             if (classTo >= 0 && classFrom != classTo) {
@@ -92,8 +103,6 @@ void buildLinksBetweenClasses(const AdjList *adj, const Partition *p, t_link_arr
                     addLink(links, classFrom, classTo);
                 }
             }
-
-            cell = cell->next;
         }
     }
 }
@@ -101,33 +110,139 @@ void buildLinksBetweenClasses(const AdjList *adj, const Partition *p, t_link_arr
 
 /* Export Hasse diagram in Mermaid syntax. */
 void printHasseMermaidToFile(const Partition *p, const t_link_array *links, const char *filepath){
+    t_hasse_options opt = hasseDefaultOptions();
+    if (writeHasseMermaid(p, links, &opt, filepath) != 0) {
+        perror("fopen");
+    }
+}
+
+/* Bytes collected before each fwrite. */
+#define HASSE_FLUSH_SIZE (1 << 20)
+
+/* Write the buffer out once it is large enough. */
+static int flushIfFull(t_text_buffer *b, FILE *f) {
+    if (b->len < HASSE_FLUSH_SIZE) return 0;
+    return textBufferFlush(b, f);
+}
+
+/* Default labels: full member list only. */
+t_hasse_options hasseDefaultOptions(void) {
+    t_hasse_options opt = {-1, 0, 0, NULL};
+    return opt;
+}
+
+/* One line per class: "C<k> <size>: v1 v2 ..." */
+static int writeMemberIndex(const Partition *p, const char *filepath) {
+    FILE *f = fopen(filepath, "w");
+    if (f == NULL) return 2;
+
+    t_text_buffer b;
+    textBufferInit(&b);
+    int rc = 0;
+
+    for (int c = 0; c < p->count && rc == 0; c++) {
+        const Class *cl = &p->classes[c];
+        textBufferAppend(&b, "C", 1);
+        textBufferAppendInt(&b, c + 1);
+        textBufferAppend(&b, " ", 1);
+        textBufferAppendInt(&b, cl->size);
+        textBufferAppend(&b, ":", 1);
+        for (int k = 0; k < cl->size; k++) {
+            textBufferAppend(&b, " ", 1);
+            textBufferAppendInt(&b, cl->vertices[k]);
+            if ((k & 1023) == 0) rc |= flushIfFull(&b, f);
+        }
+        textBufferAppend(&b, "\n", 1);
+    }
+
+    rc |= textBufferFlush(&b, f);
+    textBufferFree(&b);
+    if (fclose(f) != 0) rc = 3;
+    return rc;
+}
+
+/* Buffered export: labels cost O(max_members) per class, so the diagram
+   scales with the number of classes rather than with the number of states. */
+int writeHasseMermaid(const Partition *p, const t_link_array *links,
+                      const t_hasse_options *opt, const char *filepath) {
+    if (p == NULL || links == NULL || opt == NULL || filepath == NULL) return 1;
+
+    /* A class is recurrent iff it has no outgoing link (removing transitive
+       links never leaves a class without any). */
+    char *hasOut = NULL;
+    if (opt->show_kind) {
+        hasOut = calloc(p->count > 0 ? p->count : 1, 1);
+        if (hasOut == NULL) return 2;
+        for (int i = 0; i < links->size; i++) hasOut[links->data[i].from_class] = 1;
+    }
+
     FILE *f = fopen(filepath, "w");
     if (f == NULL) {
-        perror("fopen");
-        return;
+        free(hasOut);
+        return 2;
     }
 
-    fprintf(f, "graph TD;\n");
+    t_text_buffer b;
+    textBufferInit(&b);
+    int rc = 0;
+
+    textBufferAppend(&b, "graph TD;\n", 10);
 
     /* Print nodes. */
     for (int c = 0; c < p->count; c++) {
         const Class *cl = &p->classes[c];
-        fprintf(f, "  C%d[\"C%d: {", c + 1, c + 1);
-        for (int k = 0; k < cl->size; k++) {
-            fprintf(f, "%d", cl->vertices[k]);
-            if (k < cl->size - 1) fprintf(f, ", ");
+        int shown = (opt->max_members < 0 || opt->max_members > cl->size) ? cl->size : opt->max_members;
+
+        textBufferAppend(&b, "  C", 3);
+        textBufferAppendInt(&b, c + 1);
+        textBufferAppend(&b, "[\"C", 3);
+        textBufferAppendInt(&b, c + 1);
+        textBufferAppend(&b, ": {", 3);
+        for (int k = 0; k < shown; k++) {
+            textBufferAppendInt(&b, cl->vertices[k]);
+            if (k < shown - 1) textBufferAppend(&b, ", ", 2);
+        }
+        if (shown < cl->size) textBufferAppend(&b, shown > 0 ? ", ...}" : "...}", shown > 0 ? 6 : 4);
+        else textBufferAppend(&b, "}", 1);
+
+        if (opt->show_size || opt->show_kind) {
+            textBufferAppend(&b, " (", 2);
+            if (opt->show_size) {
+                textBufferAppendInt(&b, cl->size);
+                textBufferAppend(&b, cl->size == 1 ? " state" : " states", cl->size == 1 ? 6 : 7);
+            }
+            if (opt->show_size && opt->show_kind) textBufferAppend(&b, ", ", 2);
+            if (opt->show_kind) {
+                if (hasOut[c]) textBufferAppend(&b, "transient", 9);
+                else textBufferAppend(&b, "recurrent", 9);
+            }
+            textBufferAppend(&b, ")", 1);
         }
-        fprintf(f, "}\"];\n");
+
+        textBufferAppend(&b, "\"];\n", 4);
+        rc |= flushIfFull(&b, f);
     }
 
     /* Print edges. */
     for (int i = 0; i < links->size; i++) {
-        fprintf(f, "  C%d --> C%d;\n",
-                links->data[i].from_class + 1,
-                links->data[i].to_class + 1);
+        textBufferAppend(&b, "  C", 3);
+        textBufferAppendInt(&b, links->data[i].from_class + 1);
+        textBufferAppend(&b, " --> C", 6);
+        textBufferAppendInt(&b, links->data[i].to_class + 1);
+        textBufferAppend(&b, ";\n", 2);
+        rc |= flushIfFull(&b, f);
+    }
+
+    rc |= textBufferFlush(&b, f);
+    textBufferFree(&b);
+    free(hasOut);
+    if (fclose(f) != 0) rc = 3;
+
+    if (rc == 0 && opt->index_path != NULL) {
+        rc = writeMemberIndex(p, opt->index_path);
     }
 
-    fclose(f);
+    return rc;
 }
 
 /* Remove transitive links from the SCC graph.
@@ -0,0 +1,640 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "hitting.h"
+
+/* Neighbour lists longer than this are not sorted by degree during RCM */
+#define RCM_SORT_MAX 32
+
+/* Compressed sparse rows of the linear system being factorized */
+typedef struct {
+    int n;
+    int *ptr;
+    int *col;
+    double *val;
+} t_system;
+
+static void systemFree(t_system *A) {
+    free(A->ptr);
+    free(A->col);
+    free(A->val);
+    A->ptr = NULL;
+    A->col = NULL;
+    A->val = NULL;
+    A->n = 0;
+}
+
+/* Allocate the rows of a system with nnz entries (ptr[] is filled by the caller) */
+static int systemCreate(t_system *A, int n, int nnz) {
+    A->n = n;
+    A->ptr = malloc((n + 1) * sizeof(int));
+    A->col = malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    A->val = malloc((nnz > 0 ? nnz : 1) * sizeof(double));
+    if (!A->ptr || !A->col || !A->val) {
+        systemFree(A);
+        return 2;
+    }
+    return 0;
+}
+
+/* ---------- Reverse Cuthill-McKee ordering (limits fill-in) ---------- */
+
+/* perm[new] = old, computed on the symmetrized pattern of A */
+static int rcmOrder(const t_system *A, int *perm) {
+    int n = A->n;
+    int nnz = A->ptr[n];
+
+    int *tptr = calloc(n + 1, sizeof(int));
+    int *tcol = malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    int *deg = calloc(n, sizeof(int));
+    int *byDeg = malloc(n * sizeof(int));
+    int *bucket = NULL;
+    char *seen = calloc(n, 1);
+    if (!tptr || !tcol || !deg || !byDeg || !seen) {
+        free(tptr); free(tcol); free(deg); free(byDeg); free(seen);
+        return 2;
+    }
+
+    /* Transposed pattern */
+    for (int e = 0; e < nnz; e++) tptr[A->col[e] + 1]++;
+    for (int i = 0; i < n; i++) tptr[i + 1] += tptr[i];
+    int *fill = malloc((n + 1) * sizeof(int));
+    if (!fill) {
+        free(tptr); free(tcol); free(deg); free(byDeg); free(seen);
+        return 2;
+    }
+    for (int i = 0; i <= n; i++) fill[i] = tptr[i];
+    for (int i = 0; i < n; i++) {
+        for (int e = A->ptr[i]; e < A->ptr[i + 1]; e++) {
+            tcol[fill[A->col[e]]++] = i;
+        }
+    }
+
+    int maxDeg = 0;
+    for (int i = 0; i < n; i++) {
+        deg[i] = (A->ptr[i + 1] - A->ptr[i]) + (tptr[i + 1] - tptr[i]);
+        if (deg[i] > maxDeg) maxDeg = deg[i];
+    }
+
+    /* Counting sort of the vertices by degree: BFS roots are taken in that order */
+    bucket = calloc(maxDeg + 2, sizeof(int));
+    if (!bucket) {
+        free(tptr); free(tcol); free(deg); free(byDeg); free(seen); free(fill);
+        return 2;
+    }
+    for (int i = 0; i < n; i++) bucket[deg[i] + 1]++;
+    for (int d = 0; d <= maxDeg; d++) bucket[d + 1] += bucket[d];
+    for (int i = 0; i < n; i++) byDeg[bucket[deg[i]]++] = i;
+
+    int head = 0, tail = 0;
+    for (int r = 0; r < n; r++) {
+        int root = byDeg[r];
+        if (seen[root]) continue;
+
+        seen[root] = 1;
+        perm[tail++] = root;
+
+        while (head < tail) {
+            int v = perm[head++];
+            int first = tail;
+
+            for (int pass = 0; pass < 2; pass++) {
+                const int *ptr = pass ? tptr : A->ptr;
+                const int *col = pass ? tcol : A->col;
+                for (int e = ptr[v]; e < ptr[v + 1]; e++) {
+                    int w = col[e];
+                    if (!seen[w]) {
+                        seen[w] = 1;
+                        perm[tail++] = w;
+                    }
+                }
+            }
+
+            /* Neighbours by increasing degree */
+            if (tail - first <= RCM_SORT_MAX) {
+                for (int a = first + 1; a < tail; a++) {
+                    int w = perm[a], b = a - 1;
+                    while (b >= first && deg[perm[b]] > deg[w]) {
+                        perm[b + 1] = perm[b];
+                        b--;
+                    }
+                    perm[b + 1] = w;
+                }
+            }
+        }
+    }
+
+    /* Reverse */
+    for (int i = 0, j = n - 1; i < j; i++, j--) {
+        int t = perm[i];
+        perm[i] = perm[j];
+        perm[j] = t;
+    }
+
+    free(tptr); free(tcol); free(deg); free(byDeg); free(seen); free(fill); free(bucket);
+    return 0;
+}
+
+/* ---------- Sparse LU (row-by-row, IKJ elimination) ---------- */
+
+/* Append (c, v) to a growing factor, doubling its capacity when needed */
+static int factorPush(int **col, double **val, int *cap, int len, int c, double v) {
+    if (len >= *cap) {
+        int newCap = (*cap > 0) ? *cap * 2 : 64;
+        int *nc = realloc(*col, newCap * sizeof(int));
+        if (!nc) return 2;
+        *col = nc;
+        double *nv = realloc(*val, newCap * sizeof(double));
+        if (!nv) return 2;
+        *val = nv;
+        *cap = newCap;
+    }
+    (*col)[len] = c;
+    (*val)[len] = v;
+    return 0;
+}
+
+/* Min-heap of column indices */
+static void heapPush(int *heap, int *size, int v) {
+    int i = (*size)++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap[parent] <= v) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = v;
+}
+
+static int heapPop(int *heap, int *size) {
+    int top = heap[0];
+    int last = heap[--(*size)];
+    int i = 0;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= *size) break;
+        if (child + 1 < *size && heap[child + 1] < heap[child]) child++;
+        if (heap[child] >= last) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (*size > 0) heap[i] = last;
+    return top;
+}
+
+/* Factorize P A P^T = L U with P the RCM ordering */
+static int sparseLuFactor(const t_system *A, t_sparse_lu *lu) {
+    int n = A->n;
+
+    lu->size = n;
+    lu->perm = malloc(n * sizeof(int));
+    lu->inv = malloc(n * sizeof(int));
+    lu->l_ptr = malloc((n + 1) * sizeof(int));
+    lu->u_ptr = malloc((n + 1) * sizeof(int));
+    lu->l_col = NULL;
+    lu->l_val = NULL;
+    lu->u_col = NULL;
+    lu->u_val = NULL;
+
+    double *w = malloc(n * sizeof(double));
+    int *mark = malloc(n * sizeof(int));
+    int *pattern = malloc(n * sizeof(int));
+    int *heap = malloc(n * sizeof(int));
+
+    int rc = 0;
+    if (!lu->perm || !lu->inv || !lu->l_ptr || !lu->u_ptr || !w || !mark || !pattern || !heap) {
+        rc = 2;
+        goto done;
+    }
+
+    rc = rcmOrder(A, lu->perm);
+    if (rc != 0) goto done;
+    for (int i = 0; i < n; i++) {
+        lu->inv[lu->perm[i]] = i;
+        mark[i] = -1;
+    }
+
+    int lLen = 0, lCap = 0, uLen = 0, uCap = 0;
+    lu->l_ptr[0] = 0;
+    lu->u_ptr[0] = 0;
+
+    for (int i = 0; i < n; i++) {
+        int old = lu->perm[i];
+        int np = 0, hs = 0;
+
+        /* Scatter row i of P A P^T */
+        for (int e = A->ptr[old]; e < A->ptr[old + 1]; e++) {
+            int c = lu->inv[A->col[e]];
+            if (mark[c] != i) {
+                mark[c] = i;
+                w[c] = 0.0;
+                pattern[np++] = c;
+                if (c < i) heapPush(heap, &hs, c);
+            }
+            w[c] += A->val[e];
+        }
+
+        /* Eliminate columns k < i in increasing order */
+        while (hs > 0) {
+            int k = heapPop(heap, &hs);
+            double lk = w[k] / lu->u_val[lu->u_ptr[k]];
+            w[k] = lk;
+            if (lk == 0.0) continue;
+
+            for (int e = lu->u_ptr[k] + 1; e < lu->u_ptr[k + 1]; e++) {
+                int c = lu->u_col[e];
+                if (mark[c] != i) {
+                    mark[c] = i;
+                    w[c] = 0.0;
+                    pattern[np++] = c;
+                    if (c < i) heapPush(heap, &hs, c);
+                }
+                w[c] -= lk * lu->u_val[e];
+            }
+        }
+
+        if (mark[i] != i || w[i] <= 0.0) {
+            rc = 4;   /* zero or negative pivot: the system is singular */
+            goto done;
+        }
+
+        /* Gather L (multipliers) and U (diagonal first) */
+        rc = factorPush(&lu->u_col, &lu->u_val, &uCap, uLen++, i, w[i]);
+        for (int p = 0; p < np && rc == 0; p++) {
+            int c = pattern[p];
+            if (w[c] == 0.0 || c == i) continue;
+            if (c < i) rc = factorPush(&lu->l_col, &lu->l_val, &lCap, lLen++, c, w[c]);
+            else       rc = factorPush(&lu->u_col, &lu->u_val, &uCap, uLen++, c, w[c]);
+        }
+        if (rc != 0) goto done;
+
+        lu->l_ptr[i + 1] = lLen;
+        lu->u_ptr[i + 1] = uLen;
+    }
+
+done:
+    free(w);
+    free(mark);
+    free(pattern);
+    free(heap);
+    if (rc != 0) sparseLuFree(lu);
+    return rc;
+}
+
+/* Solve A x = b in place: forward substitution with L, backward with U */
+int sparseLuSolve(const t_sparse_lu *lu, double *b) {
+    if (lu == NULL || b == NULL || lu->perm == NULL) return 1;
+
+    int n = lu->size;
+    double *x = malloc(n * sizeof(double));
+    if (!x) return 2;
+
+    for (int i = 0; i < n; i++) {
+        double s = b[lu->perm[i]];
+        for (int e = lu->l_ptr[i]; e < lu->l_ptr[i + 1]; e++) {
+            s -= lu->l_val[e] * x[lu->l_col[e]];
+        }
+        x[i] = s;
+    }
+
+    for (int i = n - 1; i >= 0; i--) {
+        double s = x[i];
+        for (int e = lu->u_ptr[i] + 1; e < lu->u_ptr[i + 1]; e++) {
+            s -= lu->u_val[e] * x[lu->u_col[e]];
+        }
+        x[i] = s / lu->u_val[lu->u_ptr[i]];
+    }
+
+    for (int i = 0; i < n; i++) b[lu->perm[i]] = x[i];
+    free(x);
+    return 0;
+}
+
+/* Solve A^T x = b in place: U^T then L^T, both column-oriented on the row factors */
+int sparseLuSolveTranspose(const t_sparse_lu *lu, double *b) {
+    if (lu == NULL || b == NULL || lu->perm == NULL) return 1;
+
+    int n = lu->size;
+    double *x = malloc(n * sizeof(double));
+    if (!x) return 2;
+
+    for (int i = 0; i < n; i++) x[i] = b[lu->perm[i]];
+
+    for (int i = 0; i < n; i++) {
+        x[i] /= lu->u_val[lu->u_ptr[i]];
+        for (int e = lu->u_ptr[i] + 1; e < lu->u_ptr[i + 1]; e++) {
+            x[lu->u_col[e]] -= lu->u_val[e] * x[i];
+        }
+    }
+
+    for (int i = n - 1; i >= 0; i--) {
+        for (int e = lu->l_ptr[i]; e < lu->l_ptr[i + 1]; e++) {
+            x[lu->l_col[e]] -= lu->l_val[e] * x[i];
+        }
+    }
+
+    for (int i = 0; i < n; i++) b[lu->perm[i]] = x[i];
+    free(x);
+    return 0;
+}
+
+/* Free the factors */
+void sparseLuFree(t_sparse_lu *lu) {
+    if (lu == NULL) return;
+    free(lu->perm);
+    free(lu->inv);
+    free(lu->l_ptr);
+    free(lu->l_col);
+    free(lu->l_val);
+    free(lu->u_ptr);
+    free(lu->u_col);
+    free(lu->u_val);
+    lu->perm = NULL;
+    lu->inv = NULL;
+    lu->l_ptr = NULL;
+    lu->l_col = NULL;
+    lu->l_val = NULL;
+    lu->u_ptr = NULL;
+    lu->u_col = NULL;
+    lu->u_val = NULL;
+    lu->size = 0;
+}
+
+/* ---------- Hitting times to a target set ---------- */
+
+/* Predecessor lists (reverse graph) of adj */
+static int buildPredecessors(const AdjList *adj, int **pptr, int **pcol) {
+    int n = adj->n;
+    int *ptr = calloc(n + 1, sizeof(int));
+    if (!ptr) return 2;
+
+    int m = 0;
+    for (int u = 0; u < n; u++) {
+        for (EdgeCell *c = adj->L[u].head; c != NULL; c = c->next) {
+            ptr[c->v + 1]++;
+            m++;
+        }
+    }
+    for (int v = 0; v < n; v++) ptr[v + 1] += ptr[v];
+
+    int *col = malloc((m > 0 ? m : 1) * sizeof(int));
+    int *fill = malloc(n * sizeof(int));
+    if (!col || !fill) {
+        free(ptr); free(col); free(fill);
+        return 2;
+    }
+    for (int v = 0; v < n; v++) fill[v] = ptr[v];
+    for (int u = 0; u < n; u++) {
+        for (EdgeCell *c = adj->L[u].head; c != NULL; c = c->next) {
+            col[fill[c->v]++] = u;
+        }
+    }
+
+    free(fill);
+    *pptr = ptr;
+    *pcol = col;
+    return 0;
+}
+
+/* Solve (I - Q) h = 1 on the states that reach the targets almost surely */
+int hittingTimes(const AdjList *adj, const int *is_target, double *h) {
+    if (adj == NULL || is_target == NULL || h == NULL) {
+        return 1;
+    }
+
+    int n = adj->n;
+    int *pptr = NULL, *pcol = NULL;
+    if (buildPredecessors(adj, &pptr, &pcol) != 0) return 2;
+
+    /* state: 0 = unknown, 1 = reaches the targets, 2 = may miss them */
+    char *state = calloc(n, 1);
+    int *queue = malloc(n * sizeof(int));
+    int *idx = malloc(n * sizeof(int));
+    if (!state || !queue || !idx) {
+        free(pptr); free(pcol); free(state); free(queue); free(idx);
+        return 2;
+    }
+
+    /* Backward BFS from the targets */
+    int head = 0, tail = 0;
+    for (int v = 0; v < n; v++) {
+        if (is_target[v]) {
+            state[v] = 1;
+            queue[tail++] = v;
+        }
+    }
+    while (head < tail) {
+        int v = queue[head++];
+        for (int e = pptr[v]; e < pptr[v + 1]; e++) {
+            int u = pcol[e];
+            if (state[u] == 0) {
+                state[u] = 1;
+                queue[tail++] = u;
+            }
+        }
+    }
+
+    /* Backward BFS from the states that cannot reach the targets, not crossing them */
+    head = tail = 0;
+    for (int v = 0; v < n; v++) {
+        if (state[v] == 0) {
+            state[v] = 2;
+            queue[tail++] = v;
+        }
+    }
+    while (head < tail) {
+        int v = queue[head++];
+        for (int e = pptr[v]; e < pptr[v + 1]; e++) {
+            int u = pcol[e];
+            if (state[u] != 2 && !is_target[u]) {
+                state[u] = 2;
+                queue[tail++] = u;
+            }
+        }
+    }
+
+    /* Unknowns: non-target states that hit the targets with probability 1 */
+    int k = 0, nnz = 0;
+    for (int v = 0; v < n; v++) {
+        idx[v] = -1;
+        if (state[v] == 1 && !is_target[v]) {
+            idx[v] = k++;
+            nnz++;
+            for (EdgeCell *c = adj->L[v].head; c != NULL; c = c->next) nnz++;
+        }
+    }
+
+    int rc = 0;
+    if (k > 0) {
+        t_system A;
+        if (systemCreate(&A, k, nnz) != 0) {
+            rc = 2;
+        } else {
+            int e = 0;
+            for (int v = 0; v < n; v++) {
+                int i = idx[v];
+                if (i < 0) continue;
+                A.ptr[i] = e;
+                A.col[e] = i;
+                A.val[e++] = 1.0;
+                for (EdgeCell *c = adj->L[v].head; c != NULL; c = c->next) {
+                    if (idx[c->v] >= 0) {
+                        A.col[e] = idx[c->v];
+                        A.val[e++] = -c->p;
+                    }
+                }
+            }
+            A.ptr[k] = e;
+
+            t_sparse_lu lu;
+            rc = sparseLuFactor(&A, &lu);
+            systemFree(&A);
+
+            if (rc == 0) {
+                double *b = malloc(k * sizeof(double));
+                if (!b) {
+                    rc = 2;
+                } else {
+                    for (int i = 0; i < k; i++) b[i] = 1.0;
+                    rc = sparseLuSolve(&lu, b);
+                    for (int v = 0; v < n; v++) {
+                        if (idx[v] >= 0) h[v] = b[idx[v]];
+                    }
+                    free(b);
+                }
+                sparseLuFree(&lu);
+            }
+        }
+    }
+
+    for (int v = 0; v < n; v++) {
+        if (is_target[v]) h[v] = 0.0;
+        else if (state[v] == 2) h[v] = INFINITY;
+    }
+
+    free(pptr); free(pcol); free(state); free(queue); free(idx);
+    return rc;
+}
+
+/* ---------- Mean first passage times inside a recurrent class ---------- */
+
+/* Factorize B = I - P + e_r e_r^T (r = last member) and derive pi and B^-1 * 1.
+   With h = m(., j): h = B^-1 1 - B^-1 e_j / pi_j + const, const chosen so h_j = 0. */
+int passageSolverCreate(const AdjList *adj, const Class *cls, t_passage_solver *s) {
+    if (adj == NULL || cls == NULL || s == NULL || cls->size <= 0) {
+        return 1;
+    }
+
+    int k = cls->size;
+    int n = adj->n;
+
+    s->size = k;
+    s->vertices = malloc(k * sizeof(int));
+    s->local = malloc(n * sizeof(int));
+    s->pi = malloc(k * sizeof(double));
+    s->a = malloc(k * sizeof(double));
+    s->lu.perm = NULL;
+    if (!s->vertices || !s->local || !s->pi || !s->a) {
+        passageSolverFree(s);
+        return 2;
+    }
+
+    for (int v = 0; v < n; v++) s->local[v] = -1;
+    for (int i = 0; i < k; i++) {
+        s->vertices[i] = cls->vertices[i];
+        s->local[cls->vertices[i] - 1] = i;
+    }
+
+    int nnz = k;
+    for (int i = 0; i < k; i++) {
+        for (EdgeCell *c = adj->L[s->vertices[i] - 1].head; c != NULL; c = c->next) {
+            if (s->local[c->v] < 0) {
+                passageSolverFree(s);
+                return 3;   /* an edge leaves the class: it is transient */
+            }
+            nnz++;
+        }
+    }
+
+    t_system B;
+    if (systemCreate(&B, k, nnz) != 0) {
+        passageSolverFree(s);
+        return 2;
+    }
+    int e = 0;
+    for (int i = 0; i < k; i++) {
+        B.ptr[i] = e;
+        B.col[e] = i;
+        B.val[e++] = (i == k - 1) ? 2.0 : 1.0;
+        for (EdgeCell *c = adj->L[s->vertices[i] - 1].head; c != NULL; c = c->next) {
+            B.col[e] = s->local[c->v];
+            B.val[e++] = -c->p;
+        }
+    }
+    B.ptr[k] = e;
+
+    int rc = sparseLuFactor(&B, &s->lu);
+    systemFree(&B);
+    if (rc != 0) {
+        passageSolverFree(s);
+        return rc;
+    }
+
+    /* a = B^-1 1 */
+    for (int i = 0; i < k; i++) s->a[i] = 1.0;
+    sparseLuSolve(&s->lu, s->a);
+
+    /* pi is proportional to row r of B^-1: B^T y = e_r */
+    for (int i = 0; i < k; i++) s->pi[i] = 0.0;
+    s->pi[k - 1] = 1.0;
+    sparseLuSolveTranspose(&s->lu, s->pi);
+
+    double sum = 0.0;
+    for (int i = 0; i < k; i++) sum += s->pi[i];
+    if (sum <= 0.0) {
+        passageSolverFree(s);
+        return 4;
+    }
+    for (int i = 0; i < k; i++) s->pi[i] /= sum;
+
+    return 0;
+}
+
+/* m(i, target) = a_i - a_target + (g_target - g_i) / pi_target with g = B^-1 e_target */
+int passageTimesTo(const t_passage_solver *s, int target, double *m) {
+    if (s == NULL || m == NULL || target < 0 || target >= s->size) {
+        return 1;
+    }
+
+    int k = s->size;
+    for (int i = 0; i < k; i++) m[i] = 0.0;
+    m[target] = 1.0;
+
+    int rc = sparseLuSolve(&s->lu, m);
+    if (rc != 0) return rc;
+
+    double pj = s->pi[target];
+    double gj = m[target];
+    double aj = s->a[target];
+
+    for (int i = 0; i < k; i++) {
+        m[i] = (s->a[i] - aj) + (gj - m[i]) / pj;
+    }
+    m[target] = 1.0 / pj;
+    return 0;
+}
+
+/* Free a passage solver */
+void passageSolverFree(t_passage_solver *s) {
+    if (s == NULL) return;
+    free(s->vertices);
+    free(s->local);
+    free(s->pi);
+    free(s->a);
+    s->vertices = NULL;
+    s->local = NULL;
+    s->pi = NULL;
+    s->a = NULL;
+    if (s->lu.perm != NULL) sparseLuFree(&s->lu);
+    s->size = 0;
+}
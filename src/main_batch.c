@@ -0,0 +1,626 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "adj_list.h"
+#include "markov_check.h"
+#include "export_mermaid.h"
+#include "tarjan.h"
+#include "partition.h"
+#include "hasse.h"
+#include "matrix.h"
+#include "stationary.h"
+#include "file_name.h"
+#include "profile.h"
+
+/* Stages selectable with -stages (SCC is run whenever a later stage needs it) */
+#define BATCH_VALIDATE   1
+#define BATCH_SCC        2
+#define BATCH_HASSE      4
+#define BATCH_STATIONARY 8
+#define BATCH_EXPORT     16
+#define BATCH_ALL        31
+
+/* Same tolerance as graph_part1 */
+#define BATCH_LO 0.99f
+#define BATCH_HI 1.00f
+
+/* Classes larger than this are summarized in the Hasse diagram (as graph_part2) */
+#define BATCH_HASSE_INLINE_MAX 20
+
+/* Stationary solve of each closed class (probabilities are floats: the
+   change between iterates cannot go much below 1e-7) */
+#define BATCH_STATIONARY_EPSILON 1e-6
+#define BATCH_STATIONARY_MAX_ITER 10000
+
+/* Tarjan recurses once per state on the path: workers get a large stack */
+#define BATCH_WORKER_STACK (512L * 1024L * 1024L)
+
+#define BATCH_PATH_MAX 1024
+
+static const char *STAGE_NAMES[] = {"validate", "scc", "hasse", "stationary", "export"};
+#define BATCH_STAGE_COUNT 5
+
+/* Outcome of one input file, shown in the summary */
+typedef struct {
+    const char *path;
+    int n;
+    long long edges;
+    int bad_rows;          // -1 if not validated
+    int classes;           // -1 if SCC not run
+    int closed;            // closed (recurrent) classes
+    int periodic;          // closed classes of period > 1, -1 if stationary not run
+    int converged;         // closed classes whose stationary solve converged, -1 if not run
+    double seconds;
+    const char *status;    // "ok" or the first failure
+} t_batch_result;
+
+/* Work shared by the pool */
+typedef struct {
+    int stages;
+    DuplicatePolicy policy;    // repeated (u, v) lines: summed or refused
+    MermaidViewOptions view;   // what the export stage draws
+    const char *outdir;
+    char **files;
+    char **names;          // output name of each file, unique in the batch
+    int count;
+    t_batch_result *results;
+    int next;              // next file to hand out (under lock)
+    int finished;
+    int inner_threads;     // OpenMP threads per worker
+    pthread_mutex_t lock;
+} t_batch_queue;
+
+/* Helper : base name of input without its extension (malloc'd) */
+static char *stemCopy(const char *input)
+{
+    const char *base;
+    size_t len = fileStem(input, &base);
+    char *stem = malloc(len + 1);
+    if (stem != NULL) {
+        memcpy(stem, base, len);
+        stem[len] = '\0';
+    }
+    return stem;
+}
+
+/* Helper : output name of every input, unique in the batch. The stem is kept
+   when no other input has it; inputs sharing a stem (a/g.txt and b/g.txt, or
+   g.txt and g.bin) get "<stem>_<position in the batch>" instead, so no two
+   workers ever write the same file. Returns NULL on allocation failure. */
+static char **outputNames(char **files, int count)
+{
+    char **names = calloc(count > 0 ? count : 1, sizeof(char *));
+    char **stems = calloc(count > 0 ? count : 1, sizeof(char *));
+    int failed = (names == NULL || stems == NULL);
+
+    for (int i = 0; i < count && !failed; i++) {
+        stems[i] = stemCopy(files[i]);
+        if (stems[i] == NULL) failed = 1;
+    }
+
+    for (int i = 0; i < count && !failed; i++) {
+        int shared = 0;
+        for (int j = 0; j < count && !shared; j++) {
+            shared = (j != i && strcmp(stems[i], stems[j]) == 0);
+        }
+
+        size_t cap = strlen(stems[i]) + 16;
+        names[i] = malloc(cap);
+        if (names[i] == NULL) {
+            failed = 1;
+            break;
+        }
+        if (!shared) {
+            strcpy(names[i], stems[i]);
+            continue;
+        }
+
+        /* "<stem>_<k>" may itself be the stem of another input: skip to the next k */
+        for (int k = i + 1;; k += count) {
+            snprintf(names[i], cap, "%s_%d", stems[i], k);
+            int taken = 0;
+            for (int j = 0; j < count && !taken; j++) {
+                taken = strcmp(names[i], stems[j]) == 0 || (j < i && strcmp(names[i], names[j]) == 0);
+            }
+            if (!taken) break;
+        }
+        fprintf(stderr, "Note: %s shares its name with another input, outputs are named %s_*\n",
+                files[i], names[i]);
+    }
+
+    for (int i = 0; i < count && stems != NULL; i++) free(stems[i]);
+    free(stems);
+    if (failed && names != NULL) {
+        for (int i = 0; i < count; i++) free(names[i]);
+        free(names);
+        names = NULL;
+    }
+    return names;
+}
+
+/* Helper : "<outdir>/<output name><suffix>" */
+static void outputPath(char *out, const char *outdir, const char *name, const char *suffix)
+{
+    snprintf(out, BATCH_PATH_MAX, "%s/%s%s", outdir, name, suffix);
+}
+
+/* Helper : one class per line, "C<k>: v1 v2 ..." */
+static int writeClasses(const Partition *part, const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL) return 2;
+    for (int c = 0; c < part->count; c++) {
+        fprintf(f, "C%d:", c + 1);
+        for (int k = 0; k < part->classes[c].size; k++) fprintf(f, " %d", part->classes[c].vertices[k]);
+        fprintf(f, "\n");
+    }
+    return fclose(f) != 0 ? 2 : 0;
+}
+
+/* Helper : closed[c] = 1 if no edge leaves class c */
+static void findClosedClasses(const AdjList *adj, const Partition *part, char *closed)
+{
+    for (int c = 0; c < part->count; c++) closed[c] = 1;
+    for (int u = 0; u < adj->n; u++) {
+        int cu = part->v2c[u + 1];
+        for (EdgeCell *e = adj->L[u].head; e != NULL; e = e->next) {
+            if (part->v2c[e->v + 1] != cu) closed[cu] = 0;
+        }
+    }
+}
+
+/* Helper : Hasse diagram, summarized when classes are large (as graph_part2) */
+static int writeHasse(const AdjList *adj, const Partition *part, const char *outdir, const char *name)
+{
+    char path[BATCH_PATH_MAX], indexPath[BATCH_PATH_MAX];
+    outputPath(path, outdir, name, "_hasse.mmd");
+    outputPath(indexPath, outdir, name, "_classes.txt");
+
+    t_link_array links;
+    initLinkArray(&links);
+    buildLinksBetweenClasses(adj, part, &links);
+    removeTransitiveLinks(&links);
+
+    int largest = 0;
+    for (int c = 0; c < part->count; c++) {
+        if (part->classes[c].size > largest) largest = part->classes[c].size;
+    }
+
+    t_hasse_options opt = hasseDefaultOptions();
+    if (largest > BATCH_HASSE_INLINE_MAX) {
+        opt.max_members = 5;
+        opt.show_size = 1;
+        opt.show_kind = 1;
+        opt.index_path = indexPath;
+    }
+
+    int rc = writeHasseMermaid(part, &links, &opt, path);
+    freeLinkArray(&links);
+    return rc;
+}
+
+/* Helper : stationary distribution of every closed class, one file per graph */
+static int writeStationary(const AdjList *adj, const Partition *part, const char *closed,
+                           const char *outdir, const char *name, t_batch_result *res)
+{
+    char path[BATCH_PATH_MAX];
+    outputPath(path, outdir, name, "_stationary.txt");
+
+    t_class_blocks blocks;
+    if (classBlocksBuild(adj, part, &blocks) != 0) return 2;
+
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        classBlocksFree(&blocks);
+        return 2;
+    }
+
+    t_stationary_options opt = stationaryDefaultOptions();
+    opt.method = STATIONARY_AITKEN;
+    opt.epsilon = BATCH_STATIONARY_EPSILON;
+    opt.max_iter = BATCH_STATIONARY_MAX_ITER;
+
+    int rc = 0;
+    res->converged = 0;
+    res->periodic = 0;
+    for (int c = 0; c < part->count && rc == 0; c++) {
+        if (!closed[c]) continue;
+
+        const Class *cl = &part->classes[c];
+        int period = sparsePeriod(blocks.blocks[c]);
+        if (period > 1) res->periodic++;
+
+        double *pi = malloc(cl->size * sizeof(double));
+        if (pi == NULL) {
+            rc = 2;
+            break;
+        }
+
+        t_stationary_info info;
+        stationaryVectorSparse(blocks.blocks[c], opt, pi, &info);
+        if (info.converged) res->converged++;
+
+        fprintf(f, "C%d: %d states, period %d, %s after %d products (residual %g)\n",
+                c + 1, cl->size, period, info.converged ? "converged" : "not converged",
+                info.iterations, info.residual);
+        if (info.converged) {
+            for (int i = 0; i < cl->size; i++) fprintf(f, "  %d %.9g\n", cl->vertices[i], pi[i]);
+        }
+        free(pi);
+    }
+
+    if (fclose(f) != 0 && rc == 0) rc = 2;
+    classBlocksFree(&blocks);
+    return rc;
+}
+
+/* Helper : every selected stage on one file, written under its output name;
+   fills res and returns its status */
+static const char *processFile(const char *input, const char *name, int stages,
+                               DuplicatePolicy policy, const MermaidViewOptions *view,
+                               const char *outdir, t_batch_result *res)
+{
+    char path[BATCH_PATH_MAX];
+
+    res->n = 0;
+    res->edges = 0;
+    res->bad_rows = -1;
+    res->classes = -1;
+    res->closed = 0;
+    res->periodic = -1;
+    res->converged = -1;
+
+    AdjList *adj;
+    int duplicates = 0;
+    if (stages & BATCH_VALIDATE) {
+        MarkovReport report;
+        adj = markovReadFile(input, BATCH_LO, BATCH_HI, policy, &report);
+        duplicates = report.duplicates;
+        if (adj != NULL) res->bad_rows = report.bad_count;
+        markovReportFree(&report);
+    } else {
+        adj = adjReadFileMerged(input, policy, NULL, &duplicates);
+    }
+    if (adj == NULL) return duplicates > 0 ? "duplicate edges" : "read error";
+
+    res->n = adj->n;
+    for (int u = 0; u < adj->n; u++) {
+        for (EdgeCell *e = adj->L[u].head; e != NULL; e = e->next) res->edges++;
+    }
+
+    /* As graph_part1: an invalid chain is not analysed further */
+    if (res->bad_rows > 0) {
+        adjFree(adj);
+        return "not markov";
+    }
+
+    const char *status = "ok";
+
+    int condensed = (stages & BATCH_EXPORT) && mermaidViewNeedsPartition(view);
+    if ((stages & BATCH_EXPORT) && !condensed) {
+        outputPath(path, outdir, name, "_graph.mmd");
+        if (writeMermaidView(adj, NULL, view, path) != 0) status = "export failed";
+    }
+
+    if ((stages & (BATCH_SCC | BATCH_HASSE | BATCH_STATIONARY)) || condensed) {
+        Partition part = partitionCreate(adj->n);
+        char *closed = NULL;
+
+        if (part.v2c == NULL || tarjanRun(adj, &part) != 0) {
+            status = "scc failed";
+        } else {
+            res->classes = part.count;
+            closed = malloc(part.count > 0 ? part.count : 1);
+        }
+
+        if (closed != NULL) {
+            findClosedClasses(adj, &part, closed);
+            for (int c = 0; c < part.count; c++) res->closed += closed[c];
+
+            if (stages & BATCH_SCC) {
+                outputPath(path, outdir, name, "_scc.txt");
+                if (writeClasses(&part, path) != 0) status = "scc write failed";
+            }
+            if ((stages & BATCH_HASSE) && writeHasse(adj, &part, outdir, name) != 0) {
+                status = "hasse failed";
+            }
+            if ((stages & BATCH_STATIONARY)
+                && writeStationary(adj, &part, closed, outdir, name, res) != 0) {
+                status = "stationary failed";
+            }
+            if (condensed) {
+                outputPath(path, outdir, name, "_graph.mmd");
+                if (writeMermaidView(adj, &part, view, path) != 0) status = "export failed";
+            }
+        } else if (res->classes >= 0) {
+            status = "out of memory";
+        }
+
+        free(closed);
+        partitionFree(&part);
+    }
+
+    adjFree(adj);
+    return status;
+}
+
+/* Worker : take the next file until none is left */
+static void *batchWorker(void *arg)
+{
+    t_batch_queue *q = arg;
+
+#ifdef _OPENMP
+    /* Parallel loops inside a file share the cores with the other workers */
+    omp_set_num_threads(q->inner_threads);
+#endif
+
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        int i = q->next++;
+        pthread_mutex_unlock(&q->lock);
+        if (i >= q->count) break;
+
+        t_batch_result *res = &q->results[i];
+        res->path = q->files[i];
+        double t0 = profileNow();
+        res->status = processFile(q->files[i], q->names[i], q->stages, q->policy, &q->view, q->outdir, res);
+        res->seconds = profileNow() - t0;
+
+        pthread_mutex_lock(&q->lock);
+        q->finished++;
+        fprintf(stderr, "[%d/%d] %s: %s (%.3f s)\n", q->finished, q->count,
+                res->path, res->status, res->seconds);
+        pthread_mutex_unlock(&q->lock);
+    }
+    return NULL;
+}
+
+/* Helper : fixed-width summary on f, then the same rows as CSV in csv (may be NULL) */
+static void writeSummary(FILE *f, FILE *csv, const t_batch_result *results, int count, double total)
+{
+    int ok = 0;
+    fprintf(f, "\n%-40s %10s %12s %6s %8s %7s %9s %10s %10s  %s\n",
+            "file", "states", "edges", "bad", "classes", "closed", "periodic", "converged",
+            "seconds", "status");
+    if (csv != NULL) {
+        fprintf(csv, "file,states,edges,bad_rows,classes,closed,periodic,converged,seconds,status\n");
+    }
+
+    for (int i = 0; i < count; i++) {
+        const t_batch_result *r = &results[i];
+        const char *name = r->path;
+        int len = (int)strlen(name);
+        if (len > 40) name += len - 40;   /* keep the end of long paths */
+
+        fprintf(f, "%-40s %10d %12lld %6d %8d %7d %9d %10d %10.3f  %s\n",
+                name, r->n, r->edges, r->bad_rows, r->classes, r->closed, r->periodic,
+                r->converged, r->seconds, r->status);
+        if (csv != NULL) {
+            fprintf(csv, "%s,%d,%lld,%d,%d,%d,%d,%d,%.6f,%s\n",
+                    r->path, r->n, r->edges, r->bad_rows, r->classes, r->closed, r->periodic,
+                    r->converged, r->seconds, r->status);
+        }
+        if (strcmp(r->status, "ok") == 0) ok++;
+    }
+
+    fprintf(f, "\n%d of %d files processed successfully in %.3f s (-1: stage not run)\n",
+            ok, count, total);
+}
+
+/* Helper : "validate,scc,..." or "all" to a stage mask, 0 if a name is unknown */
+static int parseStages(const char *list)
+{
+    if (strcmp(list, "all") == 0) return BATCH_ALL;
+
+    int mask = 0;
+    const char *p = list;
+    while (*p != '\0') {
+        const char *end = strchr(p, ',');
+        int len = end ? (int)(end - p) : (int)strlen(p);
+        int found = 0;
+        for (int k = 0; k < BATCH_STAGE_COUNT; k++) {
+            if ((int)strlen(STAGE_NAMES[k]) == len && strncmp(p, STAGE_NAMES[k], len) == 0) {
+                mask |= 1 << k;
+                found = 1;
+            }
+        }
+        if (!found) return 0;
+        p = end ? end + 1 : p + len;
+    }
+    return mask;
+}
+
+static int compareNames(const void *a, const void *b)
+{
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/* Helper : append path, or the regular files of a directory (sorted), to the list */
+static int collectInputs(const char *path, char ***files, int *count, int *cap)
+{
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        perror(path);
+        return 1;
+    }
+
+    int first = *count;
+    DIR *dir = NULL;
+    if (S_ISDIR(st.st_mode)) {
+        dir = opendir(path);
+        if (dir == NULL) {
+            perror(path);
+            return 1;
+        }
+    }
+
+    struct dirent *entry = NULL;
+    for (;;) {
+        char *name;
+        if (dir == NULL) {
+            if (*count > first) break;
+            name = strdup(path);
+        } else {
+            entry = readdir(dir);
+            if (entry == NULL) break;
+            if (entry->d_name[0] == '.') continue;
+
+            name = malloc(strlen(path) + strlen(entry->d_name) + 2);
+            if (name != NULL) sprintf(name, "%s/%s", path, entry->d_name);
+            if (name != NULL && (stat(name, &st) != 0 || !S_ISREG(st.st_mode))) {
+                free(name);
+                continue;
+            }
+        }
+        if (name == NULL) break;
+
+        if (*count == *cap) {
+            int newCap = *cap > 0 ? 2 * *cap : 16;
+            char **grown = realloc(*files, newCap * sizeof(char *));
+            if (grown == NULL) {
+                free(name);
+                break;
+            }
+            *files = grown;
+            *cap = newCap;
+        }
+        (*files)[(*count)++] = name;
+    }
+
+    if (dir != NULL) {
+        closedir(dir);
+        qsort(*files + first, *count - first, sizeof(char *), compareNames);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int stages = BATCH_ALL;
+    DuplicatePolicy policy = DUP_SUM;
+    MermaidViewOptions view = mermaidDefaultView();
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *outdir = "../output_files";
+    char **files = NULL;
+    int count = 0, cap = 0, bad = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-stages") == 0 && i + 1 < argc) {
+            stages = parseStages(argv[++i]);
+            if (stages == 0) bad = 1;
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            workers = atoi(argv[++i]);
+            if (workers <= 0) bad = 1;
+        } else if (strcmp(argv[i], "-dup") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "sum") == 0) policy = DUP_SUM;
+            else if (strcmp(argv[i], "reject") == 0) policy = DUP_REJECT;
+            else bad = 1;
+        } else if (strcmp(argv[i], "-view") == 0 && i + 1 < argc) {
+            if (mermaidParseView(argv[++i], &view) != 0) bad = 1;
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            outdir = argv[++i];
+        } else if (argv[i][0] == '-') {
+            bad = 1;
+        } else if (collectInputs(argv[i], &files, &count, &cap) != 0) {
+            bad = 1;
+        }
+    }
+
+    if (bad || count == 0) {
+        fprintf(stderr, "Usage: %s [-stages all|validate,scc,hasse,stationary,export] [-j workers]"
+                        " [-dup sum|reject]"
+                        " [-view auto|full|condensed|topk[:k]|neighbourhood[:s1,s2,...]]"
+                        " [-o output_dir] file|directory...\n", argv[0]);
+        for (int i = 0; i < count; i++) free(files[i]);
+        free(files);
+        return EXIT_FAILURE;
+    }
+
+    if (mkdir(outdir, 0755) != 0 && errno != EEXIST) {
+        perror(outdir);
+        for (int i = 0; i < count; i++) free(files[i]);
+        free(files);
+        return EXIT_FAILURE;
+    }
+
+    if (workers < 1) workers = 1;
+    if (workers > count) workers = count;
+
+    t_batch_queue q;
+    q.stages = stages;
+    q.policy = policy;
+    q.view = view;
+    q.outdir = outdir;
+    q.files = files;
+    q.names = outputNames(files, count);
+    q.count = count;
+    q.results = calloc(count, sizeof(t_batch_result));
+    q.next = 0;
+    q.finished = 0;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    q.inner_threads = cores > workers ? (int)(cores / workers) : 1;
+    pthread_mutex_init(&q.lock, NULL);
+
+    pthread_t *threads = malloc(workers * sizeof(pthread_t));
+    if (q.results == NULL || q.names == NULL || threads == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        free(q.results);
+        free(threads);
+        for (int i = 0; q.names != NULL && i < count; i++) free(q.names[i]);
+        free(q.names);
+        for (int i = 0; i < count; i++) free(files[i]);
+        free(files);
+        return EXIT_FAILURE;
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, BATCH_WORKER_STACK);
+
+    double t0 = profileNow();
+    int started = 0;
+    for (int w = 0; w < workers; w++) {
+        if (pthread_create(&threads[w], &attr, batchWorker, &q) != 0) break;
+        started++;
+    }
+    if (started == 0) batchWorker(&q);   /* no thread could be created: run here */
+    for (int w = 0; w < started; w++) pthread_join(threads[w], NULL);
+    double total = profileNow() - t0;
+
+    pthread_attr_destroy(&attr);
+    pthread_mutex_destroy(&q.lock);
+
+    char csvPath[BATCH_PATH_MAX];
+    snprintf(csvPath, sizeof(csvPath), "%s/summary.csv", outdir);
+    FILE *csv = fopen(csvPath, "w");
+    if (csv == NULL) perror(csvPath);
+
+    writeSummary(stdout, csv, q.results, count, total);
+    if (csv != NULL) {
+        fclose(csv);
+        printf("Summary written to %s\n", csvPath);
+    }
+
+    int failures = 0;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(q.results[i].status, "ok") != 0) failures++;
+        free(files[i]);
+        free(q.names[i]);
+    }
+    free(q.names);
+    free(files);
+    free(threads);
+    free(q.results);
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,407 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "adj_list.h"
+#include "markov_check.h"
+#include "matrix.h"
+#include "tarjan.h"
+#include "partition.h"
+#include "hasse.h"
+#include "stationary.h"
+#include "generator.h"
+#include "perf_counters.h"
+#include "profile.h"
+
+/* Dense matrices (N^2 memory, N^3 products) are only timed up to these sizes */
+#define BENCH_DENSE_MAX 2000
+#define BENCH_DENSE_MULTIPLY_MAX 1000
+
+/* States per class in the generated graphs, and cap on the class count
+   (removeTransitiveLinks is cubic in the number of links) */
+#define BENCH_CLASS_SIZE 500
+#define BENCH_CLASS_MAX 200
+
+#define BENCH_MAX_SIZES 32
+
+/* Timed stages, in pipeline order */
+typedef enum {
+    STAGE_LOAD,
+    STAGE_VALIDATE,
+    STAGE_MATRIX,
+    STAGE_MATRIX_DENSE,
+    STAGE_MULTIPLY,
+    STAGE_MULTIPLY_DENSE,
+    STAGE_SCC,
+    STAGE_LINKS,
+    STAGE_TRANSITIVE,
+    STAGE_PERIOD,
+    STAGE_STATIONARY,
+    STAGE_COUNT
+} t_stage;
+
+static const char *STAGE_NAMES[STAGE_COUNT] = {
+    "load", "validate", "matrix", "matrix_dense", "multiply", "multiply_dense", "scc",
+    "links", "transitive", "period", "stationary"
+};
+
+/* One stage of one repetition */
+typedef struct {
+    double seconds;        // negative if the stage was skipped
+    t_perf_sample hw;      // hardware counters over the stage (-1 if unavailable)
+} t_stage_sample;
+
+/* Start of a timed region */
+typedef struct {
+    double t0;
+    t_perf_sample c0;
+} t_stage_clock;
+
+/* Measurements of one graph size */
+typedef struct {
+    int states;
+    long long edges;
+    t_stage_sample *samples[STAGE_COUNT];   // one entry per repetition
+    long peak_rss_kb;
+} t_bench_size;
+
+/* Helper : start timing a stage (counters are read last, closest to the work) */
+static void clockStart(const t_perf_counters *pc, t_stage_clock *clk)
+{
+    clk->t0 = profileNow();
+    perfCountersRead(pc, &clk->c0);
+}
+
+/* Helper : stop timing a stage (counters are read first) */
+static void clockStop(const t_perf_counters *pc, const t_stage_clock *clk, t_stage_sample *s)
+{
+    t_perf_sample c1;
+    perfCountersRead(pc, &c1);
+    s->seconds = profileNow() - clk->t0;
+    perfSampleDiff(&c1, &clk->c0, &s->hw);
+}
+
+static int compareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int compareInts(const void *a, const void *b)
+{
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/* Helper : q-quantile (nearest rank) of n values, sorted in place */
+static double quantile(double *v, int n, double q)
+{
+    qsort(v, n, sizeof(double), compareDoubles);
+    int k = (int)(q * n + 0.999999) - 1;
+    if (k < 0) k = 0;
+    if (k >= n) k = n - 1;
+    return v[k];
+}
+
+/* Helper : one pass over the whole pipeline, each stage timed separately */
+static int runPipeline(const char *path, const t_perf_counters *pc, t_stage_sample *t)
+{
+    t_stage_clock clk;
+    clockStart(pc, &clk);
+    AdjList *adj = adjReadFile(path);
+    clockStop(pc, &clk, &t[STAGE_LOAD]);
+    if (adj == NULL) return 1;
+
+    int n = adj->n;
+
+    clockStart(pc, &clk);
+    MarkovReport report;
+    markovCompute(adj, 0.99f, 1.00f, &report);
+    markovReportFree(&report);
+    clockStop(pc, &clk, &t[STAGE_VALIDATE]);
+
+    clockStart(pc, &clk);
+    t_sparse_matrix S = adjToSparse(adj);
+    clockStop(pc, &clk, &t[STAGE_MATRIX]);
+
+    t_matrix M = {0, NULL};
+    t[STAGE_MATRIX_DENSE].seconds = -1.0;
+    if (n <= BENCH_DENSE_MAX) {
+        clockStart(pc, &clk);
+        M = adjToMatrix(adj);
+        clockStop(pc, &clk, &t[STAGE_MATRIX_DENSE]);
+    }
+
+    clockStart(pc, &clk);
+    double dropped = 0.0;
+    t_sparse_matrix S2 = sparseMultiply(S, S, 0.0, &dropped);
+    clockStop(pc, &clk, &t[STAGE_MULTIPLY]);
+    sparseFree(&S2);
+
+    t[STAGE_MULTIPLY_DENSE].seconds = -1.0;
+    if (n <= BENCH_DENSE_MULTIPLY_MAX) {
+        t_matrix R = matrixCreate(n);
+        clockStart(pc, &clk);
+        matrixMultiply(M, M, R);
+        clockStop(pc, &clk, &t[STAGE_MULTIPLY_DENSE]);
+        matrixFree(&R);
+    }
+
+    clockStart(pc, &clk);
+    Partition part = partitionCreate(n);
+    tarjanRun(adj, &part);
+    clockStop(pc, &clk, &t[STAGE_SCC]);
+
+    clockStart(pc, &clk);
+    t_link_array links;
+    initLinkArray(&links);
+    buildLinksBetweenClasses(adj, &part, &links);
+    clockStop(pc, &clk, &t[STAGE_LINKS]);
+
+    clockStart(pc, &clk);
+    removeTransitiveLinks(&links);
+    clockStop(pc, &clk, &t[STAGE_TRANSITIVE]);
+
+    clockStart(pc, &clk);
+    t_class_blocks blocks;
+    if (classBlocksBuildSparse(S, &part, &blocks) == 0) {
+        for (int c = 0; c < part.count; c++) sparsePeriod(blocks.blocks[c]);
+        classBlocksFree(&blocks);
+    }
+    clockStop(pc, &clk, &t[STAGE_PERIOD]);
+
+    clockStart(pc, &clk);
+    double *pi = malloc(n * sizeof(double));
+    if (pi != NULL) {
+        t_stationary_info info;
+        stationaryVectorSparse(S, stationaryDefaultOptions(), pi, &info);
+        free(pi);
+    }
+    clockStop(pc, &clk, &t[STAGE_STATIONARY]);
+
+    freeLinkArray(&links);
+    partitionFree(&part);
+    matrixFree(&M);
+    sparseFree(&S);
+    adjFree(adj);
+    return 0;
+}
+
+/* Helper : generate a graph of the given size into path */
+static int generateGraph(const char *path, int states, int degree,
+                         unsigned long long seed, long long *edges)
+{
+    t_gen_options opt = generatorDefaultOptions();
+    opt.states = states;
+    opt.degree = degree;
+    opt.classes = states / BENCH_CLASS_SIZE;
+    if (opt.classes < 1) opt.classes = 1;
+    if (opt.classes > BENCH_CLASS_MAX) opt.classes = BENCH_CLASS_MAX;
+    opt.recurrent = (opt.classes + 4) / 5;
+    opt.periodic = opt.recurrent / 2;
+    opt.absorbing = (states > 100) ? states / 1000 + 1 : 0;
+    opt.seed = seed;
+    opt.format = GEN_BINARY;
+
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) return 2;
+    int rc = generateChain(&opt, f, edges);
+    if (fclose(f) != 0) rc = 2;
+    return rc;
+}
+
+/* Helper : median of counter k over the repetitions, -1 if any read failed */
+static double medianCounter(const t_stage_sample *samples, int reps, int k, double *tmp)
+{
+    for (int r = 0; r < reps; r++) {
+        if (samples[r].hw.value[k] < 0) return -1.0;
+        tmp[r] = (double)samples[r].hw.value[k];
+    }
+    return quantile(tmp, reps, 0.5);
+}
+
+/* Helper : one derived metric as a CSV field or JSON value (empty / null if unavailable) */
+static void putMetric(FILE *out, int json, double num, double den)
+{
+    if (num >= 0.0 && den > 0.0) fprintf(out, "%.6e", num / den);
+    else if (json) fprintf(out, "null");
+}
+
+/* Helper : write every stage of every size as CSV or JSON */
+static void writeReport(FILE *out, int json, const t_bench_size *sizes, int count, int reps)
+{
+    const char *sep = "";
+    if (json) fprintf(out, "[");
+    else fprintf(out, "states,edges,stage,reps,median_s,p95_s,edges_per_s,peak_rss_kb,"
+                      "ipc,llc_misses_per_edge,branch_misses_per_edge\n");
+
+    double *tmp = malloc(reps * sizeof(double));
+    if (tmp == NULL) return;
+
+    for (int s = 0; s < count; s++) {
+        for (int k = 0; k < STAGE_COUNT; k++) {
+            const t_stage_sample *samples = sizes[s].samples[k];
+            if (samples[0].seconds < 0.0) continue;   /* too large for this stage */
+
+            for (int r = 0; r < reps; r++) tmp[r] = samples[r].seconds;
+            double median = quantile(tmp, reps, 0.5);
+            double p95 = quantile(tmp, reps, 0.95);
+            double rate = median > 0.0 ? sizes[s].edges / median : 0.0;
+
+            double hw[PERF_COUNTER_COUNT];
+            for (int c = 0; c < PERF_COUNTER_COUNT; c++) hw[c] = medianCounter(samples, reps, c, tmp);
+            double edges = (double)sizes[s].edges;
+
+            if (json) {
+                fprintf(out, "%s\n  {\"states\": %d, \"edges\": %lld, \"stage\": \"%s\", \"reps\": %d, "
+                             "\"median_s\": %.6e, \"p95_s\": %.6e, \"edges_per_s\": %.6e, "
+                             "\"peak_rss_kb\": %ld, \"ipc\": ",
+                        sep, sizes[s].states, sizes[s].edges, STAGE_NAMES[k], reps,
+                        median, p95, rate, sizes[s].peak_rss_kb);
+                putMetric(out, 1, hw[PERF_INSTRUCTIONS], hw[PERF_CYCLES]);
+                fprintf(out, ", \"llc_misses_per_edge\": ");
+                putMetric(out, 1, hw[PERF_LLC_MISSES], edges);
+                fprintf(out, ", \"branch_misses_per_edge\": ");
+                putMetric(out, 1, hw[PERF_BRANCH_MISSES], edges);
+                fprintf(out, "}");
+                sep = ",";
+            } else {
+                fprintf(out, "%d,%lld,%s,%d,%.6e,%.6e,%.6e,%ld,",
+                        sizes[s].states, sizes[s].edges, STAGE_NAMES[k], reps,
+                        median, p95, rate, sizes[s].peak_rss_kb);
+                putMetric(out, 0, hw[PERF_INSTRUCTIONS], hw[PERF_CYCLES]);
+                fprintf(out, ",");
+                putMetric(out, 0, hw[PERF_LLC_MISSES], edges);
+                fprintf(out, ",");
+                putMetric(out, 0, hw[PERF_BRANCH_MISSES], edges);
+                fprintf(out, "\n");
+            }
+        }
+    }
+
+    if (json) fprintf(out, "\n]\n");
+    free(tmp);
+}
+
+/* Helper : parse "1000,10000,100000", sorted in increasing order (the peak
+   RSS reported for a size is the high-water mark of every size run before it) */
+static int parseSizes(const char *list, int *sizes)
+{
+    int count = 0;
+    const char *p = list;
+    while (*p != '\0' && count < BENCH_MAX_SIZES) {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (end == p || v <= 0) return 0;
+        sizes[count++] = (int)v;
+        p = (*end == ',') ? end + 1 : end;
+    }
+    qsort(sizes, count, sizeof(int), compareInts);
+    return count;
+}
+
+int main(int argc, char **argv)
+{
+    int sizeList[BENCH_MAX_SIZES] = {1000, 10000, 100000};
+    int sizeCount = 3;
+    int reps = 5, degree = 4, json = 0, useCounters = 1;
+    unsigned long long seed = 1;
+    const char *output = NULL;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-sizes") == 0) sizeCount = parseSizes(argv[i + 1], sizeList);
+        else if (strcmp(argv[i], "-reps") == 0) reps = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-d") == 0) degree = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-seed") == 0) seed = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "-format") == 0) json = (strcmp(argv[i + 1], "json") == 0);
+        else if (strcmp(argv[i], "-o") == 0) output = argv[i + 1];
+        else if (strcmp(argv[i], "-counters") == 0) useCounters = (strcmp(argv[i + 1], "off") != 0);
+        else sizeCount = 0;
+    }
+
+    if (sizeCount <= 0 || reps <= 0 || degree <= 0 || argc % 2 == 0) {
+        fprintf(stderr, "Usage: %s [-sizes n1,n2,...] [-reps r] [-d degree] [-seed s]"
+                        " [-format csv|json] [-o file] [-counters on|off]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    /* Opened before any parallel region so that the worker threads inherit them */
+    t_perf_counters pc;
+    for (int k = 0; k < PERF_COUNTER_COUNT; k++) pc.fd[k] = -1;
+    pc.opened = 0;
+    if (useCounters) {
+        perfCountersOpen(&pc);
+        if (pc.opened < PERF_COUNTER_COUNT) {
+            fprintf(stderr, "Hardware counters: %d of %d available (%s)", pc.opened,
+                    PERF_COUNTER_COUNT, strerror(pc.error));
+            for (int k = 0; k < PERF_COUNTER_COUNT; k++) {
+                if (pc.fd[k] < 0) fprintf(stderr, ", no %s", PERF_COUNTER_NAMES[k]);
+            }
+            fprintf(stderr, "\n");
+        }
+    }
+
+    char path[] = "/tmp/markov_bench_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        perfCountersClose(&pc);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+
+    t_bench_size sizes[BENCH_MAX_SIZES];
+    int done = 0, rc = 0;
+
+    for (int s = 0; s < sizeCount && rc == 0; s++) {
+        t_bench_size *b = &sizes[s];
+        b->states = sizeList[s];
+
+        if (generateGraph(path, b->states, degree, seed, &b->edges) != 0) {
+            fprintf(stderr, "Error: could not generate %d states\n", b->states);
+            rc = 1;
+            break;
+        }
+
+        for (int k = 0; k < STAGE_COUNT; k++) {
+            b->samples[k] = calloc(reps, sizeof(t_stage_sample));
+            if (b->samples[k] == NULL) rc = 2;
+        }
+        done++;
+
+        t_stage_sample t[STAGE_COUNT];
+        for (int r = 0; r < reps && rc == 0; r++) {
+            if (runPipeline(path, &pc, t) != 0) {
+                rc = 1;
+                break;
+            }
+            for (int k = 0; k < STAGE_COUNT; k++) b->samples[k][r] = t[k];
+        }
+
+        /* High-water mark of the whole process: sizes run in increasing order
+           (parseSizes sorts them), so it is reached by the current size */
+        b->peak_rss_kb = profilePeakRssKb();
+        fprintf(stderr, "%d states, %lld edges: done\n", b->states, b->edges);
+    }
+
+    remove(path);
+    perfCountersClose(&pc);
+
+    if (rc == 0) {
+        FILE *out = (output != NULL) ? fopen(output, "w") : stdout;
+        if (out == NULL) {
+            perror(output);
+            rc = 1;
+        } else {
+            writeReport(out, json, sizes, done, reps);
+            if (out != stdout) fclose(out);
+        }
+    }
+
+    for (int s = 0; s < done; s++) {
+        for (int k = 0; k < STAGE_COUNT; k++) free(sizes[s].samples[k]);
+    }
+
+    return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
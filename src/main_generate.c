@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "generator.h"
+
+/* Print the command line help */
+static void usage(const char *prog)
+{
+    t_gen_options d = generatorDefaultOptions();
+
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  -n <states>       number of states (%d)\n"
+            "  -d <degree>       mean out-degree (%d)\n"
+            "  -law <law>        fixed | uniform | geometric (uniform)\n"
+            "  -c <classes>      strongly connected classes (%d)\n"
+            "  -sizes <sizes>    equal | geometric[:ratio] | s1,s2,... (equal)\n"
+            "                    a list sets the class count, and the state count\n"
+            "                    (list sum + absorbing states) unless -n is given\n"
+            "  -r <recurrent>    closed classes among them (%d)\n"
+            "  -p <periodic>     periodic closed classes (%d)\n"
+            "  -period <d>       their period (%d)\n"
+            "  -a <absorbing>    absorbing states (%d)\n"
+            "  -leak <mass>      exit probability of transient states (%.2f)\n"
+            "  -seed <seed>      random seed (%llu)\n"
+            "  -binary           binary output instead of text\n"
+            "  -o <file>         output file (standard output)\n",
+            prog, d.states, d.degree, d.classes, d.recurrent, d.periodic,
+            d.period, d.absorbing, d.leak, d.seed);
+}
+
+/* "-sizes": equal, geometric[:ratio] or a comma-separated list of sizes
+   (*list is allocated for the list form, *count entries). Returns 0, or 1 on bad text. */
+static int parseSizes(const char *text, t_gen_options *opt, int **list, int *count)
+{
+    if (strcmp(text, "equal") == 0) {
+        opt->sizes = SIZES_EQUAL;
+        return 0;
+    }
+    if (strncmp(text, "geometric", 9) == 0) {
+        opt->sizes = SIZES_GEOMETRIC;
+        if (text[9] == '\0') return 0;
+        if (text[9] != ':') return 1;
+        char *end;
+        opt->size_ratio = strtod(text + 10, &end);
+        return (*end != '\0' || !(opt->size_ratio > 0.0)) ? 1 : 0;
+    }
+
+    *count = 1;
+    for (const char *p = text; *p; p++) *count += (*p == ',');
+    free(*list);
+    *list = malloc(*count * sizeof(int));
+    if (*list == NULL) return 1;
+
+    const char *p = text;
+    for (int c = 0; c < *count; c++) {
+        char *end;
+        long size = strtol(p, &end, 10);
+        if (end == p || size < 1 || size > 0x7fffffffL || (*end != ',' && *end != '\0')) return 1;
+        (*list)[c] = (int)size;
+        p = end + 1;
+    }
+
+    opt->sizes = SIZES_LIST;
+    opt->size_list = *list;
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    t_gen_options opt = generatorDefaultOptions();
+    const char *output = NULL;
+    int *sizeList = NULL;
+    int sizeCount = 0, statesGiven = 0, classesGiven = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "-binary") == 0) {
+            opt.format = GEN_BINARY;
+            continue;
+        }
+        if (val == NULL) {
+            usage(argv[0]);
+            free(sizeList);
+            return EXIT_FAILURE;
+        }
+        i++;
+
+        if (strcmp(arg, "-n") == 0) {
+            opt.states = atoi(val);
+            statesGiven = 1;
+        } else if (strcmp(arg, "-d") == 0) opt.degree = atoi(val);
+        else if (strcmp(arg, "-c") == 0) {
+            opt.classes = atoi(val);
+            classesGiven = 1;
+        }
+        else if (strcmp(arg, "-r") == 0) opt.recurrent = atoi(val);
+        else if (strcmp(arg, "-p") == 0) opt.periodic = atoi(val);
+        else if (strcmp(arg, "-period") == 0) opt.period = atoi(val);
+        else if (strcmp(arg, "-a") == 0) opt.absorbing = atoi(val);
+        else if (strcmp(arg, "-leak") == 0) opt.leak = atof(val);
+        else if (strcmp(arg, "-seed") == 0) opt.seed = strtoull(val, NULL, 10);
+        else if (strcmp(arg, "-o") == 0) output = val;
+        else if (strcmp(arg, "-law") == 0) {
+            if (strcmp(val, "fixed") == 0) opt.law = DEGREE_FIXED;
+            else if (strcmp(val, "uniform") == 0) opt.law = DEGREE_UNIFORM;
+            else if (strcmp(val, "geometric") == 0) opt.law = DEGREE_GEOMETRIC;
+            else {
+                usage(argv[0]);
+                free(sizeList);
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(arg, "-sizes") == 0) {
+            if (parseSizes(val, &opt, &sizeList, &sizeCount) != 0) {
+                usage(argv[0]);
+                free(sizeList);
+                return EXIT_FAILURE;
+            }
+        } else {
+            usage(argv[0]);
+            free(sizeList);
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* A size list fixes the classes, and the states unless -n says otherwise */
+    if (opt.sizes == SIZES_LIST) {
+        long long sum = opt.absorbing;
+        for (int c = 0; c < sizeCount; c++) sum += sizeList[c];
+        if ((classesGiven && opt.classes != sizeCount) || sum > 0x7fffffffLL) {
+            fprintf(stderr, "Error: -sizes lists %d classes of %lld states in all.\n",
+                    sizeCount, sum - opt.absorbing);
+            free(sizeList);
+            return EXIT_FAILURE;
+        }
+        opt.classes = sizeCount;
+        if (!statesGiven) opt.states = (int)sum;
+    }
+
+    FILE *out = stdout;
+    if (output != NULL) {
+        out = fopen(output, "wb");
+        if (out == NULL) {
+            perror(output);
+            free(sizeList);
+            return EXIT_FAILURE;
+        }
+    }
+
+    long long edges = 0;
+    int rc = generateChain(&opt, out, &edges);
+    free(sizeList);
+
+    if (out != stdout && fclose(out) != 0) rc = 2;
+
+    if (rc == 1) {
+        fprintf(stderr, "Error: inconsistent options.\n");
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (rc != 0) {
+        fprintf(stderr, "Error: could not write the graph.\n");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "%d states, %lld edges written.\n", opt.states, edges);
+    return EXIT_SUCCESS;
+}
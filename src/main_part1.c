@@ -5,23 +5,100 @@
 #include "adj_list.h"
 #include "export_mermaid.h"
 #include "markov_check.h"
+#include "tarjan.h"
+#include "graph_store.h"
+#include "profile.h"
+#include "file_name.h"
 
-static void printAdjacencyAndCheck(AdjList *adj) {
+static void printAdjacencyAndCheck(AdjList *adj, const MarkovReport *report) {
     printf("=== Adjacency List (%d vertices) ===\n", adj->n);
     adjPrint(adj);
 
-    const float LO = 0.99f;
-    const float HI = 1.00f;
+    printf("\n=== Markov Check (tolerance [%.2f ; %.2f]) ===\n", report->lo, report->hi);
+    markovReportPrint(report);
+}
+
+/* Offer to repair an invalid graph in place and to save the corrected file.
+   Returns 1 if the graph is now Markov-valid. */
+static int repairGraph(AdjList *adj, float lo, float hi, MarkovResult *result) {
+    int choice = 0;
+
+    printf("\nRepair policy (0 = quit, 1 = scale rows, 2 = self-loop fill, 3 = drop zero rows): ");
+    if (scanf("%d", &choice) != 1 || choice < 1 || choice > 3) {
+        return 0;
+    }
+
+    MarkovRepairStats stats;
+    int stage = profileBegin("repair");
+    int rc = markovRepair(adj, lo, hi, (MarkovRepairPolicy)(choice - 1), &stats);
+    profileIterations(stats.rows_scaled + stats.loops_added + stats.rows_dropped);
+    profileEnd(stage);
+    if (rc != 0) {
+        fprintf(stderr, "Error: repair failed (code %d).\n", rc);
+        return 0;
+    }
+
+    printf("Rows scaled: %d, self-loops added: %d, vertices dropped: %d, rows left: %d\n",
+           stats.rows_scaled, stats.loops_added, stats.rows_dropped, stats.rows_left);
+    if (stats.rows_dropped > 0) {
+        printf("Graph now has %d vertices (renumbered in their original order).\n", adj->n);
+    }
+
+    *result = markovIsValid(adj, lo, hi);
+    if (!result->is_markov) {
+        fprintf(stderr, "Graph is still NOT Markov-valid (%d vertices failing).\n", result->bad_count);
+        return 0;
+    }
+
+    char path[256];
+    printf("Save corrected graph to (path, or - to skip): ");
+    if (scanf("%255s", path) == 1 && strcmp(path, "-") != 0) {
+        if (adjWriteFile(adj, path) != 0) {
+            fprintf(stderr, "Error: could not write %s.\n", path);
+        } else {
+            printf("Corrected graph written to %s\n", path);
+        }
+    }
 
-    printf("\n=== Markov Check (tolerance [%.2f ; %.2f]) ===\n", LO, HI);
-    markovReport(adj, LO, HI);
+    return 1;
 }
 
-int main(void)
+/* "-dup sum|reject": what to do with repeated (u, v) lines (summed by default);
+   "-view auto|full|condensed|topk[:k]|neighbourhood[:s1,s2,...]": the Mermaid export */
+static int parseOptions(int argc, char **argv, DuplicatePolicy *policy, MermaidViewOptions *view)
+{
+    *policy = DUP_SUM;
+    *view = mermaidDefaultView();
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-dup") == 0) {
+            if (i + 1 < argc && strcmp(argv[i + 1], "sum") == 0) *policy = DUP_SUM;
+            else if (i + 1 < argc && strcmp(argv[i + 1], "reject") == 0) *policy = DUP_REJECT;
+            else return 1;
+            i++;
+        } else if (strcmp(argv[i], "-view") == 0) {
+            if (i + 1 >= argc || mermaidParseView(argv[i + 1], view) != 0) return 1;
+            i++;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
 {
     char filename[256];
     char outputPath[256];
 
+    profileInit(argc, argv, "graph_part1");
+
+    DuplicatePolicy policy;
+    MermaidViewOptions view;
+    if (parseOptions(argc, argv, &policy, &view) != 0) {
+        fprintf(stderr, "Usage: %s [-dup sum|reject]"
+                        " [-view auto|full|condensed|topk[:k]|neighbourhood[:s1,s2,...]]"
+                        " [--profile[=file]]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
     printf("\n=== Main part 1 ===\n");
     printf("Enter graph file path: ");
     if (scanf("%255s", filename) != 1) {
@@ -31,51 +108,99 @@ int main(void)
 
     printf("\nLoading graph from file: %s\n", filename);
 
-    AdjList *adj = adjReadFile(filename);
+    const float LO = 0.99f;
+    const float HI = 1.00f;
+
+    /* Row sums are checked while the file is read (a published store has
+       no text to read: its lists are checked once rebuilt) */
+    MarkovReport report;
+    report.duplicates = 0;
+    t_graph_store store;
+    int stage = profileBegin("load_and_check");
+    AdjList *adj = NULL;
+    if (graphStoreIsName(filename)) {
+        adj = graphOpen(filename, &store);
+        if (adj != NULL && markovCompute(adj, LO, HI, &report) != 0) {
+            adjFree(adj);
+            adj = NULL;
+        }
+        graphStoreDetach(&store);
+    } else {
+        adj = markovReadFile(filename, LO, HI, policy, &report);
+    }
+    if (adj == NULL && report.duplicates > 0) {
+        fprintf(stderr, "Error: %d repeated (u, v) lines refused (-dup reject).\n", report.duplicates);
+        return EXIT_FAILURE;
+    }
     if (adj == NULL) {
         fprintf(stderr, "Error: could not read graph from file.\n");
         return EXIT_FAILURE;
     }
+    if (profile_active) profileEstimatedBytes(adjBytes(adj) + (long long)adj->n * sizeof(double));
+    profileIterations(adj->n);
+    profileEnd(stage);
 
     int n = adj->n;
-    printf("Graph loaded with %d vertices.\n\n", n);
+    printf("Graph loaded with %d vertices.\n", n);
+    if (report.duplicates > 0) {
+        printf("%d repeated (u, v) lines merged into single edges.\n", report.duplicates);
+    }
+    printf("\n");
 
-    printAdjacencyAndCheck(adj);
+    stage = profileBegin("print");
+    printAdjacencyAndCheck(adj, &report);
+    profileEnd(stage);
 
-    const float LO = 0.99f;
-    const float HI = 1.00f;
-    MarkovResult result = markovIsValid(adj, LO, HI);
+    MarkovResult result = markovResultOf(&report);
+    markovReportFree(&report);
 
     if (!result.is_markov) {
         fprintf(stderr, "\nGraph is NOT Markov-valid.\n");
         printf("Vertices failing check: %d\n", result.bad_count);
-        adjFree(adj);
-        return 1;
+
+        if (!repairGraph(adj, LO, HI, &result)) {
+            adjFree(adj);
+            return 1;
+        }
     }
 
     printf("\nGraph is Markov-valid. Vertices failing check: %d\n",
            result.bad_count);
 
     /* Build output Mermaid file path */
-    const char *base = filename;
-    const char *slash1 = strrchr(filename, '/');
-    const char *slash2 = strrchr(filename, '\\');
-    if (slash1 && slash1 > base) base = slash1 + 1;
-    if (slash2 && slash2 > base) base = slash2 + 1;
-
-    strcpy(outputPath, "../output_files/");
-    strcat(outputPath, base);
-
-    char *dot = strrchr(outputPath, '.');
-    if (dot) {
-        strcpy(dot, "_graph.mmd");
-    } else {
-        strcat(outputPath, "_graph.mmd");
+    if (fileStemPath(outputPath, sizeof(outputPath), "../output_files", filename, "_graph.mmd") != 0) {
+        fprintf(stderr, "Error: output path too long for %s.\n", filename);
+        adjFree(adj);
+        return 1;
     }
 
     printf("\nSaving Mermaid Markov graph to %s...\n", outputPath);
 
-    int rc = writeMermaid(adj, outputPath);
+    int rc;
+    stage = profileBegin("mermaid_export");
+    Partition part = {0};
+    if (mermaidViewNeedsPartition(&view)) {
+        part = partitionCreate(adj->n);
+        if (part.v2c == NULL || tarjanRun(adj, &part) != 0) {
+            fprintf(stderr, "Error: could not compute the classes.\n");
+            partitionFree(&part);
+            adjFree(adj);
+            return 2;
+        }
+        printf("Exporting the %d classes and the links between them.\n", part.count);
+    } else if (view.view == MMD_VIEW_TOPK) {
+        printf("Exporting the %d heaviest outgoing edges of each state.\n", view.k);
+    } else if (view.view == MMD_VIEW_NEIGHBOURHOOD) {
+        printf("Exporting at most %d states reached from the %d seed state(s).\n",
+               MMD_RENDER_MAX, view.seed_count);
+    } else if (view.view == MMD_VIEW_AUTO && adj->n > MMD_RENDER_MAX) {
+        /* Too big to render: keep the first states reached from state 1 */
+        printf("%d vertices: exporting the %d states closest to state 1 only.\n",
+               adj->n, MMD_RENDER_MAX);
+    }
+    rc = writeMermaidView(adj, &part, &view, outputPath);
+    partitionFree(&part);
+    profileEnd(stage);
     if (rc != 0) {
         fprintf(stderr, "Error: could not write Mermaid file.\n");
         adjFree(adj);
@@ -5,6 +5,14 @@
 #include "tarjan.h"
 #include "partition.h"
 #include "hasse.h"
+#include "reach.h"
+#include "profile.h"
+#include "analysis_cache.h"
+#include "graph_store.h"
+#include "file_name.h"
+
+/* Classes larger than this are summarized in the diagram */
+#define HASSE_INLINE_MAX 20
 
 /* Print the partition (one line per strongly connected component). */
 static void printPartition(const Partition *p)
@@ -22,10 +30,12 @@ static void printPartition(const Partition *p)
     }
 }
 
-int main(void)
+int main(int argc, char **argv)
 {
     char filename[256];
 
+    profileInit(argc, argv, "graph_part2");
+
     printf("\n=== Main part 2 ===\n");
     printf("Enter graph file path: ");
     if (scanf("%255s", filename) != 1) {
@@ -35,32 +45,70 @@ int main(void)
 
     printf("\nLoading graph from file: %s\n", filename);
 
-    /* Build adjacency list from file. */
-    AdjList *adj = adjReadFile(filename);
-    if (adj == NULL) {
+    /* Compact graph from file, or the view of a published graph store:
+       this program never needs adjacency lists. */
+    int stage = profileBegin("load");
+    t_graph_store store;
+    AdjCsr graph;
+    if (graphOpenCsr(filename, &store, &graph) != 0) {
         fprintf(stderr, "Error: could not read graph from file.\n");
         return EXIT_FAILURE;
     }
+    if (profile_active && store.base == NULL) profileEstimatedBytes(adjCsrBytes(&graph));
+    profileEnd(stage);
 
-    int n = adj->n;
+    int n = graph.n;
     printf("Graph loaded with %d vertices.\n\n", n);
 
-    /* Create partition structure and run Tarjan to compute SCCs. */
-    Partition partition = partitionCreate(n);
-    if (partition.v2c == NULL) {
-        fprintf(stderr, "Error: could not allocate partition.\n");
-        adjFree(adj);
-        return EXIT_FAILURE;
+    /* Partition and reduced links of an unchanged graph come from the analysis cache,
+       which owns them in any case (partition and links below are shallow copies). */
+    char cachePath[256];
+    analysisCachePath(cachePath, sizeof(cachePath), "../output_files", filename);
+
+    stage = profileBegin("cache_load");
+    t_analysis_cache cache;
+    analysisCacheInitCsr(&cache, &graph);
+    if (analysisCacheEnabled() && analysisCacheLoad(cachePath, &cache) == 0 && cache.has_links) {
+        printf("(classes and links loaded from %s)\n\n", cachePath);
     }
+    profileEnd(stage);
+    int cacheDirty = 0;
 
-    int status = tarjanRun(adj, &partition);
-    if (status != 0) {
-        fprintf(stderr, "Error: Tarjan algorithm failed (code %d).\n", status);
-        partitionFree(&partition);
-        adjFree(adj);
-        return EXIT_FAILURE;
+    /* A partition published with the store is used in place, without Tarjan;
+       the cache must then not free it (storePartition). */
+    int storePartition = !cache.has_partition && graphStorePartition(&store, &cache.part) == 0;
+    if (storePartition) cache.has_partition = 1;
+
+    /* Create partition structure and run Tarjan to compute SCCs. */
+    if (!cache.has_partition) {
+        stage = profileBegin("tarjan");
+        cache.part = partitionCreate(n);
+        cache.has_partition = 1;
+        if (cache.part.v2c == NULL) {
+            fprintf(stderr, "Error: could not allocate partition.\n");
+            analysisCacheFree(&cache);
+            if (store.base == NULL) adjCsrFree(&graph);
+            graphStoreDetach(&store);
+            return EXIT_FAILURE;
+        }
+
+        int status = tarjanRunCsr(&graph, &cache.part);
+        if (status != 0) {
+            fprintf(stderr, "Error: Tarjan algorithm failed (code %d).\n", status);
+            analysisCacheFree(&cache);
+            if (store.base == NULL) adjCsrFree(&graph);
+            graphStoreDetach(&store);
+            return EXIT_FAILURE;
+        }
+        profileEstimatedBytes((long long)(n + 1) * sizeof(int) + (long long)cache.part.count * sizeof(Class)
+                              + (long long)n * sizeof(int));
+        profileIterations(n);
+        profileEnd(stage);
+        cacheDirty = 1;
     }
+    Partition partition = cache.part;
 
+    stage = profileBegin("print_partition");
     printf("=== Strongly Connected Components (Tarjan) ===\n");
     printPartition(&partition);
 
@@ -69,42 +117,106 @@ int main(void)
         printf("  vertex %d -> C%d\n", v, partition.v2c[v] + 1);
     }
     printf("\n");
+    profileEnd(stage);
 
     /* Build Hasse links between classes and remove transitive edges. */
-    t_link_array links;
-    initLinkArray(&links);
-    buildLinksBetweenClasses(adj, &partition, &links);
-    removeTransitiveLinks(&links);
+    if (!cache.has_links) {
+        initLinkArray(&cache.links);
+        cache.has_links = 1;
+        stage = profileBegin("class_links");
+        buildLinksBetweenClassesCsr(&graph, &partition, &cache.links);
+        profileIterations(cache.links.size);
+        profileEnd(stage);
+
+        stage = profileBegin("transitive_reduction");
+        removeTransitiveLinks(&cache.links);
+        profileIterations(cache.links.size);
+        profileEnd(stage);
+        cacheDirty = 1;
+    }
+    t_link_array links = cache.links;
+
+    if (cacheDirty && analysisCacheEnabled()) {
+        stage = profileBegin("cache_save");
+        if (analysisCacheSave(cachePath, &cache) != 0) {
+            fprintf(stderr, "Warning: could not write the analysis cache %s\n", cachePath);
+        }
+        profileEnd(stage);
+    }
 
     /* Added by AI to make Mermaid file creation easier. Create the corresponding output file name
      "<name>_hasse.mmd" inside ../data/. */
 
     char outputPath[256];
+    int pathTooLong = fileStemPath(outputPath, sizeof(outputPath), "../output_files", filename, "_hasse.mmd");
+    int largest = 0;
+    for (int c = 0; c < partition.count; c++) {
+        if (partition.classes[c].size > largest) largest = partition.classes[c].size;
+    }
 
-    const char *base = filename;
-    const char *slash1 = strrchr(filename, '/');
-    const char *slash2 = strrchr(filename, '\\');
-    if (slash1 && slash1 > base) base = slash1 + 1;
-    if (slash2 && slash2 > base) base = slash2 + 1;
-
-    // we copy the name "example2.txt"
-    strcpy(outputPath, "../output_files/");
-    strcat(outputPath, base);
-
-    // we replace ".txt" by "_hasse.mmd"
-    char *dot = strrchr(outputPath, '.');
-    if (dot) {
-        strcpy(dot, "_hasse.mmd");
+    printf("\nSaving Mermaid diagram to %s...\n", outputPath);
+    stage = profileBegin("hasse_export");
+    if (pathTooLong) {
+        fprintf(stderr, "Error: output path too long for %s.\n", filename);
+    } else if (largest <= HASSE_INLINE_MAX) {
+        printHasseMermaidToFile(&partition, &links, outputPath);
     } else {
-        strcat(outputPath, "_hasse.mmd");
+        /* Big classes: short labels, full member lists in "<name>_classes.txt" */
+        char indexPath[256];
+        pathTooLong = fileStemPath(indexPath, sizeof(indexPath), "../output_files", filename, "_classes.txt");
+
+        t_hasse_options opt = hasseDefaultOptions();
+        opt.max_members = 5;
+        opt.show_size = 1;
+        opt.show_kind = 1;
+        opt.index_path = indexPath;
+
+        if (pathTooLong) {
+            fprintf(stderr, "Error: output path too long for %s.\n", filename);
+        } else if (writeHasseMermaid(&partition, &links, &opt, outputPath) != 0) {
+            fprintf(stderr, "Error: could not write the Hasse diagram.\n");
+        } else {
+            printf("Class members listed in %s\n", indexPath);
+        }
     }
-    printf("\nSaving Mermaid diagram to %s...\n", outputPath);
-    printHasseMermaidToFile(&partition, &links, outputPath);
+    profileEnd(stage);
     printf("Done.\n");
 
-    freeLinkArray(&links);
-    partitionFree(&partition);
-    adjFree(adj);
+    /* Reachability queries answered from the condensation, without DFS */
+    t_reach_index reach;
+    stage = profileBegin("reach_index");
+    int reachRc = reachIndexBuildCsr(&graph, &partition, -1, &reach);
+    if (reachRc == 0) profileEstimatedBytes(reachIndexSize(&reach));
+    profileEnd(stage);
+
+    if (reachRc == 0) {
+        printf("\nReachability index: %s, %ld bytes.\n",
+               reach.mode == REACH_BITSET ? "bitset closure" : "interval labels",
+               reachIndexSize(&reach));
+
+        int u, v;
+        printf("Can u reach v? Enter \"u v\" (0 0 to stop): ");
+        while (scanf("%d %d", &u, &v) == 2 && (u != 0 || v != 0)) {
+            stage = profileBegin("reach_query");
+            int r = reachQuery(&reach, u, v);
+            profileIterations(1);
+            profileEnd(stage);
+            if (r < 0) printf("  invalid states\n");
+            else printf("  %d %s %d\n", u, r ? "reaches" : "does not reach", v);
+            printf("Can u reach v? Enter \"u v\" (0 0 to stop): ");
+        }
+        printf("\n");
+
+        reachIndexFree(&reach);
+    }
+
+    if (storePartition) {
+        graphStorePartitionRelease(&cache.part);
+        cache.has_partition = 0;
+    }
+    analysisCacheFree(&cache);
+    if (store.base == NULL) adjCsrFree(&graph);
+    graphStoreDetach(&store);
 
     return EXIT_SUCCESS;
 }
@@ -1,57 +1,572 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <math.h>
+#include <string.h>
 
 #include "adj_list.h"
 #include "matrix.h"
 #include "tarjan.h"
 #include "partition.h"
+#include "stationary.h"
+#include "spectral.h"
+#include "hitting.h"
+#include "simulate.h"
+#include "profile.h"
+#include "analysis_cache.h"
+#include "graph_store.h"
+#include "stationary_update.h"
+
+/* Matrices and distributions larger than this are not printed */
+#define PRINT_MAX_STATES 30
+
+/* Stationary reports (global and per class): tolerance, iteration limit and
+   tolerance of the spectral estimate that predicts the number of steps */
+#define REPORT_EPSILON 0.01
+#define REPORT_MAX_ITER 1000
+#define REPORT_SPECTRAL_TOL 1e-6
+
+/* Layout of the report texts kept in the analysis cache: change it with them */
+#define REPORT_FORMAT 1
+
+/* Sparse M^k: entries below this are pruned after each product */
+#define POWER_DROP_TOL 1e-12
+
+/* Default memory budget for a sparse M^k, overridden by MARKOV_POWER_BUDGET_MB */
+#define POWER_BUDGET_MB 256
+
+/* Monte Carlo check: walks, steps and fixed seed (results do not depend on threads) */
+#define SIMULATION_WALKS 200000
+#define SIMULATION_STEPS 7
+#define SIMULATION_SEED 2526ULL
+
+/* Re-solves after probability edits (probabilities are floats: rows only sum to 1 within 1e-7) */
+#define EDIT_EPSILON 1e-6
+#define EDIT_MAX_ITER 10000
+
+/* Helper : append a distribution as a single matrix row */
+static void printDistribution(t_text_buffer *out, const double *pi, int n)
+{
+    textBufferPrintf(out, "| ");
+    for (int j = 0; j < n; j++) {
+        if (fabs(pi[j]) < 0.0001) textBufferPrintf(out, "  .   ");
+        else textBufferPrintf(out, "%5.2f ", pi[j]);
+    }
+    textBufferPrintf(out, "|\n\n");
+}
+
+/* Helper : memory budget for sparse matrix powers, in bytes */
+static long powerBudgetBytes(void)
+{
+    long mb = POWER_BUDGET_MB;
+    const char *env = getenv("MARKOV_POWER_BUDGET_MB");
+    if (env != NULL && atol(env) > 0) {
+        mb = atol(env);
+    }
+    return mb * 1024L * 1024L;
+}
+
+/* Helper : Monte Carlo check only on request: MARKOV_SIMULATE=1, or --simulate */
+static int simulationRequested(int argc, char **argv)
+{
+    const char *env = getenv("MARKOV_SIMULATE");
+    int on = env != NULL && env[0] != '\0' && strcmp(env, "0") != 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--simulate") == 0) on = 1;
+    }
+    return on;
+}
+
+/* Helper : append a sparse matrix power with its pruning report */
+static void printSparsePower(t_text_buffer *out, t_sparse_matrix P,
+                             const t_sparse_power_info *info)
+{
+    textBufferPrintf(out, "  %d non-zero entries (%.1f MB), %d products, drop tolerance %g\n",
+           P.nnz, sparseBytes(P) / (1024.0 * 1024.0), info->products, info->drop_tol);
+    if (info->capped_rows > 0) {
+        textBufferPrintf(out, "  Memory budget: %ld rows cut to their %d largest entries\n",
+               info->capped_rows, info->row_cap);
+    }
+    textBufferPrintf(out, "  Dropped probability mass: %g in total, %g per row\n",
+           info->dropped_mass, info->dropped_mass / P.rows);
+    if (P.rows <= PRINT_MAX_STATES) sparseFormat(out, P);
+}
+
+/* Helper : header of a stationary report with the spectral prediction */
+static void printEstimate(t_text_buffer *out, const char *label,
+                          const t_spectral_estimate *est, long steps)
+{
+    textBufferPrintf(out, "\n=== %s ===\n", label);
+    textBufferPrintf(out, "  Spectral estimate: rho = %.4f, |lambda2| = %.4f, ", est->rho, est->lambda2);
+    if (steps > 0) textBufferPrintf(out, "predicted steps = %ld\n", steps);
+    else textBufferPrintf(out, "M^n does not settle (periodic or reducible)\n");
+}
 
-/* Helper : compute stationary distribution of a matrix */
-static void compute_stationary_for_matrix(t_matrix M, double epsilon,
-                                          int max_iter, const char *label)
+/* Helper : compute stationary distribution of a matrix.
+   A spectral estimate predicts the number of steps; the cheaper of
+   vector iteration (steps * N^2) and repeated squaring (log2(steps) * N^3)
+   is then run with a cap derived from that prediction.
+   When it converges, the distribution is also copied to pi_out (may be NULL). */
+static void compute_stationary_for_matrix(t_text_buffer *out, t_matrix M, double epsilon,
+                                          int max_iter, const char *label, double *pi_out)
 {
     int n = M.size;
 
-    t_matrix powM  = matrixCreate(n);
-    t_matrix prevM = matrixCreate(n);
-    t_matrix tmp   = matrixCreate(n);
+    t_spectral_estimate est;
+    spectralEstimate(M, max_iter, REPORT_SPECTRAL_TOL, &est);
+    long steps = spectralStepsFor(&est, epsilon);
 
-    matrixCopy(powM, M);
+    t_stationary_options opt = stationaryDefaultOptions();
+    opt.epsilon = epsilon;
+    opt.max_iter = max_iter;
 
-    double diff = 1.0;
-    int iter = 1;
+    int squarings = 0;
+    while (steps > 0 && (1L << squarings) < steps) squarings++;
 
-    while (diff > epsilon && iter < max_iter) {
-        matrixCopy(prevM, powM);        // M^(k-1)
-        matrixMultiply(prevM, M, tmp);  // tmp = M^(k-1) * M
-        matrixCopy(powM, tmp);          // powM = M^k
+    if (steps > 0 && steps <= (long)squarings * n) {
+        opt.method = STATIONARY_POWER;
+        opt.max_iter = (int)(2 * steps + 10 < max_iter ? 2 * steps + 10 : max_iter);
+    } else if (steps > 0) {
+        opt.method = STATIONARY_SQUARING;
+        opt.max_iter = squarings + 2;
+    }
+
+    printEstimate(out, label, &est, steps);
+
+    t_stationary_info info;
 
-        diff = matrixDiff(powM, prevM);
-        iter++;
+    if (opt.method == STATIONARY_POWER) {
+        double *pi = malloc(n * sizeof(double));
+        if (!pi) {
+            perror("malloc");
+            return;
+        }
+        stationaryVector(M, opt, pi, &info);
+        profileIterations(est.iterations + info.iterations);
+
+        if (info.converged) {
+            textBufferPrintf(out, "  Convergence reached at n = %d by vector iteration "
+                   "(difference = %g, residual = %g)\n",
+                   info.iterations, info.diff, info.residual);
+            textBufferPrintf(out, "  Stationary distribution:\n");
+            printDistribution(out, pi, n);
+            if (pi_out) memcpy(pi_out, pi, n * sizeof(double));
+        } else {
+            textBufferPrintf(out, "  No convergence after %d vector products (residual = %g)\n",
+                   info.iterations, info.residual);
+        }
+        free(pi);
+        return;
     }
 
-    printf("\n=== %s ===\n", label);
+    t_matrix limit = matrixCreate(n);
+    stationaryLimitMatrix(M, opt, limit, &info);
+    profileIterations(est.iterations + info.iterations);
+
+    if (info.converged) {
+        textBufferPrintf(out, "  Convergence reached at n = %ld after %d products "
+               "(difference = %g, residual = %g)\n",
+               info.exponent, info.iterations, info.diff, info.residual);
+        textBufferPrintf(out, "  Candidate stationary distribution:\n");
+        matrixFormat(out, limit);
+        if (pi_out) memcpy(pi_out, limit.data[0], n * sizeof(double));
+    } else if (info.diff <= epsilon) {
+        textBufferPrintf(out, "  M^%ld is stable but not stationary (residual = %g): "
+               "the class is periodic\n", info.exponent, info.residual);
+    } else {
+        textBufferPrintf(out, "  No convergence after %d products (graph may be periodic, residual = %g)\n",
+               info.iterations, info.residual);
+    }
+
+    matrixFree(&limit);
+}
+
+/* Helper : stationary distribution of a sparse matrix (vector iteration,
+   capped by the spectral prediction); pi_out as for the dense version */
+static void compute_stationary_for_sparse(t_text_buffer *out, t_sparse_matrix M, double epsilon,
+                                          int max_iter, const char *label, double *pi_out)
+{
+    int n = M.rows;
+
+    t_spectral_estimate est;
+    spectralEstimateSparse(M, max_iter, REPORT_SPECTRAL_TOL, &est);
+    long steps = spectralStepsFor(&est, epsilon);
+
+    t_stationary_options opt = stationaryDefaultOptions();
+    opt.method = STATIONARY_POWER;
+    opt.epsilon = epsilon;
+    opt.max_iter = (steps > 0 && 2 * steps + 10 < max_iter) ? (int)(2 * steps + 10) : max_iter;
+
+    printEstimate(out, label, &est, steps);
 
-    if (iter >= max_iter) {
-        printf("  No convergence after %d iterations (graph may be periodic)\n",
-               max_iter);
+    double *pi = malloc(n * sizeof(double));
+    if (!pi) {
+        perror("malloc");
+        return;
+    }
+
+    t_stationary_info info;
+    stationaryVectorSparse(M, opt, pi, &info);
+    profileIterations(est.iterations + info.iterations);
+
+    if (info.converged) {
+        textBufferPrintf(out, "  Convergence reached at n = %d by sparse vector iteration "
+               "(difference = %g, residual = %g)\n",
+               info.iterations, info.diff, info.residual);
+        if (pi_out) memcpy(pi_out, pi, n * sizeof(double));
+        if (n <= PRINT_MAX_STATES) {
+            textBufferPrintf(out, "  Stationary distribution:\n");
+            printDistribution(out, pi, n);
+        }
     } else {
-        printf("  Convergence reached at n = %d (difference = %g)\n",
-               iter, diff);
-        printf("  Candidate stationary distribution:\n");
-        matrixPrint(powM);
+        textBufferPrintf(out, "  No convergence after %d vector products (residual = %g)\n",
+               info.iterations, info.residual);
     }
+    free(pi);
+}
 
-    matrixFree(&powM);
-    matrixFree(&prevM);
-    matrixFree(&tmp);
+/* Helper : empirical distribution after SIMULATION_STEPS steps from state 1,
+   compared with the exact row of M^steps (vector products on the CSR matrix) */
+static void compute_monte_carlo(const AdjList *adj, t_sparse_matrix S)
+{
+    int n = adj->n;
+    t_alias_chain chain;
+    t_simulation_result sim;
+    t_simulation_options opt = {SIMULATION_WALKS, SIMULATION_STEPS, 0, 1, SIMULATION_SEED};
+
+    if (aliasChainBuild(adj, &chain) != 0) {
+        fprintf(stderr, "Error: could not build alias tables\n");
+        return;
+    }
+    if (simulateWalks(&chain, &opt, &sim) != 0) {
+        fprintf(stderr, "Error: simulation failed\n");
+        aliasChainFree(&chain);
+        return;
+    }
+
+    double *x = calloc(n, sizeof(double));
+    double *y = malloc(n * sizeof(double));
+    double *est = malloc(n * sizeof(double));
+    if (!x || !y || !est) {
+        perror("malloc");
+        free(x);
+        free(y);
+        free(est);
+        simulationResultFree(&sim);
+        aliasChainFree(&chain);
+        return;
+    }
+
+    profileIterations((long long)SIMULATION_WALKS * SIMULATION_STEPS);
+
+    x[0] = 1.0;
+    for (int k = 0; k < SIMULATION_STEPS; k++) {
+        sparseVectorMultiply(x, S, y);
+        for (int j = 0; j < n; j++) x[j] = y[j];
+    }
+
+    double err = 0.0;
+    for (int j = 0; j < n; j++) {
+        est[j] = (double)sim.final[j] / (double)SIMULATION_WALKS;
+        err += fabs(est[j] - x[j]);
+    }
+
+    t_text_buffer out;
+    textBufferInit(&out);
+    textBufferPrintf(&out, "  %d walks of %d steps, seed %llu\n",
+                     SIMULATION_WALKS, SIMULATION_STEPS, SIMULATION_SEED);
+    if (n <= PRINT_MAX_STATES) {
+        textBufferPrintf(&out, "  Simulated:\n");
+        printDistribution(&out, est, n);
+        textBufferPrintf(&out, "  Exact (row 1 of M^%d):\n", SIMULATION_STEPS);
+        printDistribution(&out, x, n);
+    }
+    textBufferPrintf(&out, "  L1 distance to the exact row: %.4f\n", err);
+    textBufferFlush(&out, stdout);
+    textBufferFree(&out);
+
+    free(x);
+    free(y);
+    free(est);
+    simulationResultFree(&sim);
+    aliasChainFree(&chain);
+}
+
+/* Output of one class, filled by a worker and printed in class order */
+typedef struct {
+    t_text_buffer stationary;
+    t_text_buffer passage;
+    int period;
+    double *pi;         // class-size stationary distribution, NULL if no convergence
+} t_class_report;
+
+/* Helper : mean first passage table of a closed class (nothing for a transient one) */
+static void compute_passage_times(t_text_buffer *out, const AdjList *adj,
+                                  const Class *cls, int c)
+{
+    t_passage_solver solver;
+    int rc = passageSolverCreate(adj, cls, &solver);
+    if (rc == 3) return;   /* transient class */
+    if (rc != 0) {
+        fprintf(stderr, "Error: passage solver failed on class C%d (code %d)\n", c + 1, rc);
+        return;
+    }
+
+    int k = solver.size;
+    textBufferPrintf(out, "\n=== Class C%d: expected steps from row state to column state ===\n", c + 1);
+
+    if (k > 10) {
+        textBufferPrintf(out, "  (%d states, table omitted)\n", k);
+        passageSolverFree(&solver);
+        return;
+    }
+
+    double *m = malloc(k * k * sizeof(double));
+    if (!m) {
+        perror("malloc");
+        passageSolverFree(&solver);
+        return;
+    }
+
+    /* One solve per target, same factorization */
+    for (int j = 0; j < k; j++) {
+        passageTimesTo(&solver, j, m + j * k);
+    }
+
+    textBufferPrintf(out, "        ");
+    for (int j = 0; j < k; j++) textBufferPrintf(out, "%7d ", solver.vertices[j]);
+    textBufferPrintf(out, "\n");
+    for (int i = 0; i < k; i++) {
+        textBufferPrintf(out, "  %4d  ", solver.vertices[i]);
+        for (int j = 0; j < k; j++) textBufferPrintf(out, "%7.2f ", m[j * k + i]);
+        textBufferPrintf(out, "\n");
+    }
+
+    free(m);
+    passageSolverFree(&solver);
+}
+
+/* Helper : whole per-class analysis (one parallel task) */
+static void analyseClass(const AdjList *adj, const Partition *part, const t_class_blocks *blocks,
+                         int sparse, int c, t_class_report *rep)
+{
+    char label[64];
+    snprintf(label, sizeof(label), "Class C%d", c + 1);
+
+    /* NaN marks "not converged": compute_stationary_* only write on convergence */
+    int k = part->classes[c].size;
+    rep->pi = malloc(k * sizeof(double));
+    if (rep->pi) rep->pi[0] = NAN;
+
+    if (sparse) {
+        t_sparse_matrix sub = blocks->blocks[c];   /* view, not freed */
+        compute_stationary_for_sparse(&rep->stationary, sub, REPORT_EPSILON, REPORT_MAX_ITER,
+                                      label, rep->pi);
+        rep->period = sparsePeriod(sub);
+    } else {
+        t_matrix sub = sparseToDense(blocks->blocks[c]);
+        compute_stationary_for_matrix(&rep->stationary, sub, REPORT_EPSILON, REPORT_MAX_ITER,
+                                      label, rep->pi);
+        rep->period = getPeriod(sub);
+        matrixFree(&sub);
+    }
+    textBufferPrintf(&rep->stationary, "  Period of %s = %d\n\n", label, rep->period);
+
+    if (rep->pi && isnan(rep->pi[0])) {
+        free(rep->pi);
+        rep->pi = NULL;
+    }
+
+    compute_passage_times(&rep->passage, adj, &part->classes[c], c);
+}
+
+/* Helper : what the cached reports depend on besides the graph: their layout
+   and every setting that changes their numbers or what they print */
+static uint64_t reportSettings(void)
+{
+    char description[256];
+    snprintf(description, sizeof(description),
+             "part3 reports %d: epsilon %.17g, max_iter %d, spectral_tol %.17g, print_max_states %d",
+             REPORT_FORMAT, REPORT_EPSILON, REPORT_MAX_ITER, REPORT_SPECTRAL_TOL, PRINT_MAX_STATES);
+    return analysisSettingsHash(description);
+}
+
+/* Helper : write a report block without consuming it */
+static void printText(const t_text_buffer *b)
+{
+    if (b->len > 0) fwrite(b->data, 1, b->len, stdout);
+}
+
+/* Helper : move the global and per-class reports into the cache, with the
+   periods and the stationary vectors, then save it (when caching is enabled).
+   Every report buffer and pi vector is released here. */
+static void saveClassReports(t_analysis_cache *cache, t_text_buffer *global,
+                             t_class_report *reports, const char *path)
+{
+    const Partition *part = &cache->part;
+    int count = part->count;
+
+    for (int i = 0; i < cache->text_count; i++) textBufferFree(&cache->texts[i]);
+    free(cache->texts);
+    free(cache->period);
+    free(cache->stationary);
+    cache->text_count = 0;
+    cache->texts = malloc((1 + 2 * count) * sizeof(t_text_buffer));
+    cache->period = malloc((count > 0 ? count : 1) * sizeof(int));
+    cache->stationary = calloc(cache->n > 0 ? cache->n : 1, sizeof(double));
+
+    int ok = cache->texts && cache->period && cache->stationary;
+    if (ok) {
+        cache->texts[0] = *global;
+        textBufferInit(global);
+        cache->text_count = 1 + 2 * count;
+    }
+
+    for (int c = 0; c < count; c++) {
+        const Class *cls = &part->classes[c];
+        if (ok) {
+            cache->texts[1 + 2 * c] = reports[c].stationary;
+            cache->texts[2 + 2 * c] = reports[c].passage;
+            cache->period[c] = reports[c].period;
+            for (int i = 0; reports[c].pi && i < cls->size; i++) {
+                cache->stationary[cls->vertices[i] - 1] = reports[c].pi[i];
+            }
+        } else {
+            textBufferFree(&reports[c].stationary);
+            textBufferFree(&reports[c].passage);
+        }
+        free(reports[c].pi);
+        reports[c].pi = NULL;
+    }
+
+    if (!ok) {
+        free(cache->texts);
+        free(cache->period);
+        free(cache->stationary);
+        cache->texts = NULL;
+        cache->period = NULL;
+        cache->stationary = NULL;
+        return;
+    }
+
+    if (analysisCacheEnabled() && analysisCacheSave(path, cache) != 0) {
+        fprintf(stderr, "Warning: could not write the analysis cache %s\n", path);
+    }
 }
 
+/* Helper : summary of an init or an update of the edit state */
+static void printUpdate(const char *what, const t_stationary_update_info *info)
+{
+    printf("  %s: %d closed classes solved (%d converged) in %d vector products, %d kept%s\n",
+           what, info->solved, info->converged, info->iterations, info->kept,
+           info->structural ? ", classes recomputed" : "");
+}
+
+/* Helper : batches of "u v p" edits read from stdin ("0 0 0" applies the
+   batch, an empty batch stops). The first batch sets up the closed classes
+   from pi0 (the per-class vectors found above, may be NULL); each batch then
+   re-solves only the classes it touches, from their previous vectors. */
+static void edit_probabilities(AdjList *adj, const double *pi0)
+{
+    t_stationary_state st;
+    int ready = 0;
+    t_prob_update *batch = NULL;
+    int count = 0, cap = 0;
+
+    t_stationary_options opt = stationaryDefaultOptions();
+    opt.method = STATIONARY_POWER;
+    opt.epsilon = EDIT_EPSILON;
+    opt.max_iter = EDIT_MAX_ITER;
+    opt.lazy = 1;
+
+    printf("Edit \"u v p\" (0 0 0 applies the batch, an empty batch stops): ");
+    for (;;) {
+        t_prob_update up;
+        int got = scanf("%d %d %lf", &up.u, &up.v, &up.p);
+        if (got == 3 && (up.u != 0 || up.v != 0)) {
+            if (count == cap) {
+                int grown = cap > 0 ? 2 * cap : 16;
+                t_prob_update *bigger = realloc(batch, grown * sizeof(t_prob_update));
+                if (!bigger) break;
+                batch = bigger;
+                cap = grown;
+            }
+            batch[count++] = up;
+            continue;
+        }
+        if (count == 0) break;
+
+        int stage = profileBegin("probability_edits");
+        t_stationary_update_info info;
+        int rc = 0;
+        if (!ready) {
+            rc = stationaryStateInit(adj, pi0, opt, &st, &info);
+            ready = rc == 0;
+            if (ready) printUpdate("Starting vectors", &info);
+        }
+        if (rc == 0) {
+            rc = stationaryStateUpdate(&st, batch, count, &info);
+            profileIterations(info.iterations);
+        }
+        profileEnd(stage);
+
+        if (rc == 1) {
+            printf("  Batch refused: states must be in 1..%d and p in [0, 1]\n", adj->n);
+        } else if (rc != 0) {
+            printf("  Re-solve failed (code %d)\n", rc);
+            break;
+        } else {
+            printf("  %d edit(s) applied\n", count);
+            printUpdate("Re-solve", &info);
+            if (adj->n <= PRINT_MAX_STATES) {
+                t_text_buffer out;
+                textBufferInit(&out);
+                textBufferPrintf(&out, "  Stationary probabilities inside each closed class:\n");
+                printDistribution(&out, st.pi, adj->n);
+                textBufferFlush(&out, stdout);
+                textBufferFree(&out);
+            }
+        }
+        count = 0;
+
+        if (got != 3) break;
+        printf("Edit \"u v p\" (0 0 0 applies the batch, an empty batch stops): ");
+    }
+    printf("\n");
 
-int main(void)
+    free(batch);
+    if (ready) stationaryStateFree(&st);
+}
+
+/* Helper : class indices sorted by decreasing size (stable) */
+static void classesBySizeDesc(const Partition *part, int *order)
+{
+    for (int c = 0; c < part->count; c++) order[c] = c;
+
+    /* Counting sort on the size keeps it O(N) */
+    int maxSize = 0;
+    for (int c = 0; c < part->count; c++) {
+        if (part->classes[c].size > maxSize) maxSize = part->classes[c].size;
+    }
+
+    int *start = calloc(maxSize + 2, sizeof(int));
+    if (!start) return;   /* keep class order */
+
+    for (int c = 0; c < part->count; c++) start[maxSize - part->classes[c].size + 1]++;
+    for (int s = 0; s <= maxSize; s++) start[s + 1] += start[s];
+    for (int c = 0; c < part->count; c++) {
+        order[start[maxSize - part->classes[c].size]++] = c;
+    }
+
+    free(start);
+}
+
+
+int main(int argc, char **argv)
 {
     char filename[256];
 
+    profileInit(argc, argv, "part3");
+
     /* 1. Ask user for graph file */
     printf("Enter graph file path: ");
     if (scanf("%255s", filename) != 1) {
@@ -60,64 +575,157 @@ int main(void)
     }
 
     printf("\n--- LOADING GRAPH: %s ---\n", filename);
-    AdjList *adj = adjReadFile(filename);
+    int stage = profileBegin("load");
+    t_graph_store store;
+    AdjList *adj = graphOpen(filename, &store);
 
     if (!adj) {
         fprintf(stderr, "Error: unable to read file or invalid graph.\n");
         return EXIT_FAILURE;
     }
+    if (profile_active) profileEstimatedBytes(adjBytes(adj));
+    profileEnd(stage);
 
-    /* 2. Build transition matrix M */
+    /* 2. Build transition matrix M (CSR when the graph is large and sparse) */
     printf("\n--- 1. TRANSITION MATRIX M ---\n");
-    t_matrix M = adjToMatrix(adj);
-    matrixPrint(M);
+    stage = profileBegin("transition_matrix");
+    /* A published store already holds M in CSR: S then aliases it and is never freed */
+    t_sparse_matrix S = store.base != NULL ? graphStoreMatrix(&store) : adjToSparse(adj);
+    int sparse = matrixPreferSparse(S.rows, S.nnz);
+    if (store.base == NULL) profileEstimatedBytes(sparseBytes(S));
+
+    int n = adj->n;
+    t_matrix M = {0, NULL};
+
+    if (sparse) {
+        printf("Sparse storage: %d states, %d transitions\n", S.rows, S.nnz);
+        if (n <= PRINT_MAX_STATES) sparsePrint(S);
+    } else {
+        M = adjToMatrix(adj);
+        profileEstimatedBytes((long long)n * n * sizeof(double));
+        matrixPrint(M);
+    }
+    profileEnd(stage);
 
-    int n = M.size;
+    stage = profileBegin("matrix_powers");
+    t_matrix res  = matrixCreate(sparse ? 0 : n);
+    t_matrix powM = matrixCreate(sparse ? 0 : n);
 
-    t_matrix res  = matrixCreate(n);
-    t_matrix powM = matrixCreate(n);
+    if (!sparse) {
+        profileEstimatedBytes(2LL * n * n * sizeof(double));
+        int products = 0;
+        matrixCopy(powM, M);
 
-    matrixCopy(powM, M);
+        /* 3. Compute M^3 (2 more multiplications) */
+        for (int k = 0; k < 2; k++, products++) {
+            matrixMultiply(powM, M, res);
+            matrixCopy(powM, res);
+        }
 
-    /* 3. Compute M^3 (2 more multiplications) */
-    for (int k = 0; k < 2; k++) {
-        matrixMultiply(powM, M, res);
-        matrixCopy(powM, res);
-    }
+        printf("\n--- 2. MATRIX M^3 (3-step transition) ---\n");
+        matrixPrint(powM);
 
-    printf("\n--- 2. MATRIX M^3 (3-step transition) ---\n");
-    matrixPrint(powM);
+        /* 4. Compute M^7 (continue from M^3) */
+        for (int k = 0; k < 4; k++, products++) {
+            matrixMultiply(powM, M, res);
+            matrixCopy(powM, res);
+        }
+        profileIterations(products);
 
-    /* 4. Compute M^7 (continue from M^3) */
-    for (int k = 0; k < 4; k++) {
-        matrixMultiply(powM, M, res);
-        matrixCopy(powM, res);
+        printf("\n--- 3. MATRIX M^7 (7-step transition) ---\n");
+        matrixPrint(powM);
+    } else {
+        /* 3-4. Sparse M^3 and M^7 with threshold pruning, within the memory budget */
+        long budget = powerBudgetBytes();
+        t_sparse_power_info info3, info7;
+
+        t_text_buffer out;
+        textBufferInit(&out);
+
+        t_sparse_matrix pow3 = sparseAdvance(S, S, 2, POWER_DROP_TOL, budget, &info3);
+        printf("\n--- 2. MATRIX M^3 (3-step transition) ---\n");
+        printSparsePower(&out, pow3, &info3);
+        textBufferFlush(&out, stdout);
+
+        t_sparse_matrix pow7 = sparseAdvance(pow3, S, 4, info3.drop_tol, budget, &info7);
+        info7.dropped_mass += info3.dropped_mass;
+        profileEstimatedBytes(info3.peak_bytes > info7.peak_bytes ? info3.peak_bytes : info7.peak_bytes);
+        profileIterations(info3.products + info7.products);
+        printf("\n--- 3. MATRIX M^7 (7-step transition) ---\n");
+        printSparsePower(&out, pow7, &info7);
+        textBufferFlush(&out, stdout);
+
+        textBufferFree(&out);
+        sparseFree(&pow3);
+        sparseFree(&pow7);
     }
-
-    printf("\n--- 3. MATRIX M^7 (7-step transition) ---\n");
-    matrixPrint(powM);
+    profileEnd(stage);
+
+    /* Results of an unchanged graph (reports, partition, periods, stationary vectors)
+       come from the analysis cache, which owns the partition in any case */
+    char cachePath[256];
+    analysisCachePath(cachePath, sizeof(cachePath), "../output_files", filename);
+
+    stage = profileBegin("cache_load");
+    t_analysis_cache cache;
+    analysisCacheInit(&cache, adj);
+    if (analysisCacheEnabled()) analysisCacheLoad(cachePath, &cache);
+    /* Reports made with another format or other solver settings are recomputed */
+    uint64_t settings = reportSettings();
+    int cached = cache.has_partition && cache.period != NULL && cache.settings == settings
+                 && cache.text_count == 1 + 2 * cache.part.count;
+    profileEnd(stage);
 
     /* 5. Global convergence on the full matrix */
     printf("\n--- 4. GLOBAL CONVERGENCE TEST ---\n");
-    compute_stationary_for_matrix(M, 0.01, 1000, "Full Matrix M");
+    t_text_buffer globalReport;
+    textBufferInit(&globalReport);
+    if (cached) {
+        printText(&cache.texts[0]);
+    } else {
+        stage = profileBegin("global_stationary");
+        if (sparse) {
+            compute_stationary_for_sparse(&globalReport, S, REPORT_EPSILON, REPORT_MAX_ITER,
+                                          "Full Matrix M", NULL);
+        } else {
+            compute_stationary_for_matrix(&globalReport, M, REPORT_EPSILON, REPORT_MAX_ITER,
+                                          "Full Matrix M", NULL);
+        }
+        profileEnd(stage);
+        printText(&globalReport);
+    }
 
     /* 6. Compute partition with Tarjan */
     printf("\n--- 5. TARJAN PARTITION (STRONGLY CONNECTED COMPONENTS) ---\n");
 
-    Partition part = partitionCreate(adj->n);
-    int err = tarjanRun(adj, &part);
-
-    if (err != 0) {
-        fprintf(stderr, "Error: tarjanRun failed with code %d\n", err);
-
-        matrixFree(&M);
-        matrixFree(&res);
-        matrixFree(&powM);
-        adjFree(adj);
-        partitionFree(&part);
-
-        return EXIT_FAILURE;
+    /* A partition published with the store is used in place (not freed by the cache) */
+    int storePartition = !cache.has_partition && graphStorePartition(&store, &cache.part) == 0;
+    if (storePartition) cache.has_partition = 1;
+
+    if (!cache.has_partition) {
+        stage = profileBegin("tarjan");
+        cache.part = partitionCreate(adj->n);
+        cache.has_partition = 1;
+        int err = tarjanRun(adj, &cache.part);
+        profileIterations(n);
+        profileEnd(stage);
+
+        if (err != 0) {
+            fprintf(stderr, "Error: tarjanRun failed with code %d\n", err);
+
+            textBufferFree(&globalReport);
+            analysisCacheFree(&cache);
+            matrixFree(&M);
+            if (store.base == NULL) sparseFree(&S);
+            matrixFree(&res);
+            matrixFree(&powM);
+            adjFree(adj);
+            graphStoreDetach(&store);
+
+            return EXIT_FAILURE;
+        }
     }
+    Partition part = cache.part;
 
     printf("Number of classes: %d\n", part.count);
     for (int c = 0; c < part.count; c++) {
@@ -132,29 +740,103 @@ int main(void)
         printf(" }\n");
     }
 
-    /* 7. Stationary distribution per class */
-    printf("\n--- 6. STATIONARY DISTRIBUTION PER CLASS ---\n");
+    if (cached) {
+        printf("\n--- 6. STATIONARY DISTRIBUTION PER CLASS ---\n");
+        for (int c = 0; c < part.count; c++) printText(&cache.texts[1 + 2 * c]);
 
-    for (int c = 0; c < part.count; c++) {
-        t_matrix sub = subMatrix(M, part, c);
+        printf("\n--- 7. MEAN FIRST PASSAGE TIMES (RECURRENT CLASSES) ---\n");
+        for (int c = 0; c < part.count; c++) printText(&cache.texts[2 + 2 * c]);
+    } else {
+        /* 7. Stationary distribution, period and passage times per class.
+           Classes are independent: they run in parallel, largest first, and
+           each writes into its own report, printed afterwards in class order. */
+        t_class_blocks blocks;
+        t_class_report *reports = calloc(part.count, sizeof(t_class_report));
+        int *order = malloc(part.count * sizeof(int));
+
+        stage = profileBegin("class_blocks");
+        int blocksRc = classBlocksBuildSparse(S, &part, &blocks);
+        if (blocksRc == 0) profileEstimatedBytes(sparseBytes(blocks.diag) + sparseBytes(blocks.offdiag));
+        profileEnd(stage);
+
+        if (!reports || !order || blocksRc != 0) {
+            fprintf(stderr, "Error: could not extract class blocks\n");
+
+            free(reports);
+            free(order);
+            if (blocksRc == 0) classBlocksFree(&blocks);
+            textBufferFree(&globalReport);
+            if (storePartition) {
+                graphStorePartitionRelease(&cache.part);
+                cache.has_partition = 0;
+            }
+            analysisCacheFree(&cache);
+            matrixFree(&M);
+            if (store.base == NULL) sparseFree(&S);
+            matrixFree(&res);
+            matrixFree(&powM);
+            adjFree(adj);
+            graphStoreDetach(&store);
+
+            return EXIT_FAILURE;
+        }
 
-        char label[64];
-        snprintf(label, sizeof(label), "Class C%d", c + 1);
+        classesBySizeDesc(&part, order);
 
-        compute_stationary_for_matrix(sub, 0.01, 1000, label);
+        /* Workers charge their iterations to this stage */
+        stage = profileBegin("class_analysis");
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int t = 0; t < part.count; t++) {
+            int c = order[t];
+            textBufferInit(&reports[c].stationary);
+            textBufferInit(&reports[c].passage);
+            analyseClass(adj, &part, &blocks, sparse, c, &reports[c]);
+        }
+        profileEnd(stage);
 
-        int period = getPeriod(sub);
-        printf("  Period of %s = %d\n\n", label, period);
+        printf("\n--- 6. STATIONARY DISTRIBUTION PER CLASS ---\n");
+        for (int c = 0; c < part.count; c++) printText(&reports[c].stationary);
 
-        matrixFree(&sub);
+        printf("\n--- 7. MEAN FIRST PASSAGE TIMES (RECURRENT CLASSES) ---\n");
+        for (int c = 0; c < part.count; c++) printText(&reports[c].passage);
+
+        /* The reports move into the cache, with the periods and the stationary vectors */
+        stage = profileBegin("cache_save");
+        cache.settings = settings;
+        saveClassReports(&cache, &globalReport, reports, cachePath);
+        profileEnd(stage);
+
+        free(reports);
+        free(order);
+        classBlocksFree(&blocks);
     }
 
+    /* 8. Sampled M^7 row from the alias-table random walks (a check of the
+       simulator, off by default: 200000 walks on every run are not free) */
+    if (simulationRequested(argc, argv)) {
+        printf("\n--- 8. MONTE CARLO ESTIMATE (FROM STATE 1) ---\n");
+        stage = profileBegin("monte_carlo");
+        compute_monte_carlo(adj, S);
+        profileEnd(stage);
+    }
+
+    /* 9. Probability edits, re-solved incrementally (the lists are edited in place) */
+    printf("\n--- 9. PROBABILITY EDITS ---\n");
+    edit_probabilities(adj, cache.stationary);
+
     /* Cleanup */
+    textBufferFree(&globalReport);
+    if (storePartition) {
+        graphStorePartitionRelease(&cache.part);
+        cache.has_partition = 0;
+    }
+    analysisCacheFree(&cache);
     matrixFree(&M);
+    if (store.base == NULL) sparseFree(&S);
     matrixFree(&res);
     matrixFree(&powM);
     adjFree(adj);
-    partitionFree(&part);
+    graphStoreDetach(&store);
 
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,579 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+
+#include "adj_list.h"
+#include "matrix.h"
+#include "tarjan.h"
+#include "partition.h"
+#include "hasse.h"
+#include "reach.h"
+#include "stationary.h"
+#include "text_buffer.h"
+#include "graph_store.h"
+
+/* Longest request line, and most clients served at the same time */
+#define SERVE_LINE_MAX 256
+#define SERVE_MAX_CLIENTS 64
+
+/* DIST/PROB: step limit, and entries below this are not listed */
+#define SERVE_MAX_STEPS 1000000
+#define SERVE_PRINT_MIN 1e-12
+
+/* Result cache of DIST and PROB: direct-mapped slots, distributions above the size limit are not kept */
+#define SERVE_CACHE_SLOTS 4096
+#define SERVE_CACHE_ENTRY_MAX (1L << 20)
+
+/* Stationary solve of each closed class (as markov_batch) */
+#define SERVE_STATIONARY_EPSILON 1e-6
+#define SERVE_STATIONARY_MAX_ITER 10000
+
+/* Everything derived from the graph, built once and then only read */
+typedef struct {
+    AdjCsr graph;             // compact graph, aliases the store if any
+    long long edges;
+    t_graph_store store;      // attached store, base NULL when read from a file
+    t_sparse_matrix S;        // transition matrix (CSR), aliases the store if any
+    Partition part;           // aliases the store if it was published with one
+    int store_part;
+    t_link_array links;       // Hasse links (transitive ones removed)
+    t_reach_index reach;
+    char *closed;             // closed[c] = 1 if class c is recurrent
+    int *period;              // period of each closed class, 0 for transient ones
+    double *pi;               // stationary probability of each state inside its closed class, 0 if transient
+} t_serve_graph;
+
+/* An n-step distribution: the states listed (>= SERVE_PRINT_MIN), in increasing order */
+typedef struct {
+    int count;
+    int *state;               // 1-based
+    double *prob;
+} t_distribution;
+
+/* One cached n-step distribution */
+typedef struct {
+    int start;                // 0 if the slot is empty
+    int steps;
+    t_distribution d;
+} t_cache_entry;
+
+typedef struct {
+    t_cache_entry slots[SERVE_CACHE_SLOTS];
+    long hits, misses;
+    pthread_mutex_t lock;
+} t_serve_cache;
+
+/* Shared by every client thread */
+typedef struct {
+    t_serve_graph g;
+    t_serve_cache cache;
+    int clients;              // connected now (under cache.lock)
+    long served;              // requests answered (under cache.lock)
+} t_server;
+
+/* One connection */
+typedef struct {
+    t_server *server;
+    int fd;
+} t_client;
+
+static volatile sig_atomic_t stopping = 0;
+
+static void onSignal(int sig)
+{
+    (void)sig;
+    stopping = 1;
+}
+
+/* ---------- Startup ---------- */
+
+/* Helper : closed classes, their period and stationary vector */
+static int buildStationary(t_serve_graph *g)
+{
+    int n = g->graph.n, count = g->part.count;
+
+    g->closed = calloc(count > 0 ? count : 1, 1);
+    g->period = calloc(count > 0 ? count : 1, sizeof(int));
+    g->pi = calloc(n, sizeof(double));
+    if (!g->closed || !g->period || !g->pi) return 2;
+
+    for (int c = 0; c < count; c++) g->closed[c] = 1;
+    for (int i = 0; i < g->links.size; i++) g->closed[g->links.data[i].from_class] = 0;
+
+    t_class_blocks blocks;
+    if (classBlocksBuildSparse(g->S, &g->part, &blocks) != 0) return 2;
+
+    t_stationary_options opt = stationaryDefaultOptions();
+    opt.method = STATIONARY_AITKEN;
+    opt.epsilon = SERVE_STATIONARY_EPSILON;
+    opt.max_iter = SERVE_STATIONARY_MAX_ITER;
+
+    int rc = 0;
+    for (int c = 0; c < count && rc == 0; c++) {
+        if (!g->closed[c]) continue;
+
+        const Class *cl = &g->part.classes[c];
+        g->period[c] = sparsePeriod(blocks.blocks[c]);
+
+        double *x = malloc(cl->size * sizeof(double));
+        if (x == NULL) {
+            rc = 2;
+            break;
+        }
+        t_stationary_info info;
+        stationaryVectorSparse(blocks.blocks[c], opt, x, &info);
+        if (!info.converged) {
+            fprintf(stderr, "Warning: stationary vector of C%d did not converge (residual %g)\n",
+                    c + 1, info.residual);
+        }
+        for (int i = 0; i < cl->size; i++) g->pi[cl->vertices[i] - 1] = x[i];
+        free(x);
+    }
+
+    classBlocksFree(&blocks);
+    return rc;
+}
+
+static void serveGraphFree(t_serve_graph *g)
+{
+    free(g->closed);
+    free(g->period);
+    free(g->pi);
+    reachIndexFree(&g->reach);
+    freeLinkArray(&g->links);
+    if (g->store_part) graphStorePartitionRelease(&g->part);
+    else partitionFree(&g->part);
+    if (g->store.base == NULL) {
+        sparseFree(&g->S);
+        adjCsrFree(&g->graph);
+    }
+    graphStoreDetach(&g->store);
+}
+
+/* Load the graph and every derived structure; 0 on success */
+static int serveGraphLoad(const char *filename, t_serve_graph *g)
+{
+    memset(g, 0, sizeof(*g));
+    initLinkArray(&g->links);
+
+    /* A store is used in place: no adjacency list is ever built */
+    int rc = graphOpenCsr(filename, &g->store, &g->graph);
+    if (rc != 0) return rc;
+
+    int n = g->graph.n;
+    g->edges = g->graph.nnz;
+
+    if (g->store.base != NULL) {
+        g->S = graphStoreMatrix(&g->store);
+        g->store_part = graphStorePartition(&g->store, &g->part) == 0;
+    } else {
+        g->S = csrToSparse(&g->graph);
+    }
+    if (!g->store_part) {
+        g->part = partitionCreate(n);
+        if (g->part.v2c == NULL || tarjanRunCsr(&g->graph, &g->part) != 0) return 2;
+    }
+
+    buildLinksBetweenClassesCsr(&g->graph, &g->part, &g->links);
+    removeTransitiveLinks(&g->links);
+
+    if (reachIndexBuildCsr(&g->graph, &g->part, -1, &g->reach) != 0) return 2;
+    return buildStationary(g);
+}
+
+/* ---------- Requests ---------- */
+
+/* Helper : send the whole buffer, retrying on partial writes */
+static int sendAll(int fd, const char *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t w = write(fd, data, len);
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            return 1;
+        }
+        data += w;
+        len -= (size_t)w;
+    }
+    return 0;
+}
+
+static void distributionFree(t_distribution *d)
+{
+    free(d->state);
+    free(d->prob);
+    d->state = NULL;
+    d->prob = NULL;
+    d->count = 0;
+}
+
+/* Helper : copy of src into dst (0, or 2 on allocation failure) */
+static int distributionCopy(const t_distribution *src, t_distribution *dst)
+{
+    size_t count = src->count > 0 ? (size_t)src->count : 1;
+    dst->count = src->count;
+    dst->state = malloc(count * sizeof(int));
+    dst->prob = malloc(count * sizeof(double));
+    if (!dst->state || !dst->prob) {
+        distributionFree(dst);
+        return 2;
+    }
+    memcpy(dst->state, src->state, src->count * sizeof(int));
+    memcpy(dst->prob, src->prob, src->count * sizeof(double));
+    return 0;
+}
+
+/* Helper : the distribution after steps steps from start */
+static int computeDistribution(const t_serve_graph *g, int start, int steps, t_distribution *d)
+{
+    int n = g->graph.n;
+    double *x = calloc(n, sizeof(double));
+    double *y = malloc(n * sizeof(double));
+    if (!x || !y) {
+        free(x);
+        free(y);
+        return 2;
+    }
+
+    x[start - 1] = 1.0;
+    for (int k = 0; k < steps; k++) {
+        sparseVectorMultiply(x, g->S, y);
+        double *t = x;
+        x = y;
+        y = t;
+    }
+
+    int count = 0;
+    for (int j = 0; j < n; j++) {
+        if (x[j] >= SERVE_PRINT_MIN) count++;
+    }
+
+    d->count = count;
+    d->state = malloc((count > 0 ? count : 1) * sizeof(int));
+    d->prob = malloc((count > 0 ? count : 1) * sizeof(double));
+    int rc = 0;
+    if (!d->state || !d->prob) {
+        distributionFree(d);
+        rc = 2;
+    } else {
+        count = 0;
+        for (int j = 0; j < n; j++) {
+            if (x[j] < SERVE_PRINT_MIN) continue;
+            d->state[count] = j + 1;
+            d->prob[count++] = x[j];
+        }
+    }
+
+    free(x);
+    free(y);
+    return rc;
+}
+
+/* Helper : "OK <count> s1:p1 s2:p2 ...\n" */
+static int formatDistribution(const t_distribution *d, t_text_buffer *out)
+{
+    textBufferPrintf(out, "OK %d", d->count);
+    for (int i = 0; i < d->count; i++) {
+        textBufferPrintf(out, " %d:%.9g", d->state[i], d->prob[i]);
+    }
+    return textBufferAppend(out, "\n", 1);
+}
+
+/* Helper : probability of state v in d (0 if not listed), by binary search */
+static double distributionProbability(const t_distribution *d, int v)
+{
+    int lo = 0, hi = d->count - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (d->state[mid] == v) return d->prob[mid];
+        if (d->state[mid] < v) lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return 0.0;
+}
+
+/* Helper : cached distribution of (start, steps), copied into d (the caller frees it) */
+static int cachedDistribution(t_server *s, int start, int steps, t_distribution *d)
+{
+    t_serve_cache *cache = &s->cache;
+    size_t slot = ((size_t)start * 2654435761u + (size_t)steps * 40503u) % SERVE_CACHE_SLOTS;
+
+    pthread_mutex_lock(&cache->lock);
+    t_cache_entry *e = &cache->slots[slot];
+    if (e->start == start && e->steps == steps) {
+        int rc = distributionCopy(&e->d, d);
+        cache->hits++;
+        pthread_mutex_unlock(&cache->lock);
+        return rc;
+    }
+    cache->misses++;
+    pthread_mutex_unlock(&cache->lock);
+
+    /* Computed outside the lock: other clients keep being served */
+    int rc = computeDistribution(&s->g, start, steps, d);
+    if (rc != 0 || (long)d->count * (long)(sizeof(int) + sizeof(double)) > SERVE_CACHE_ENTRY_MAX) {
+        return rc;
+    }
+
+    t_distribution kept;
+    if (distributionCopy(d, &kept) != 0) return 0;
+
+    pthread_mutex_lock(&cache->lock);
+    e = &cache->slots[slot];
+    distributionFree(&e->d);
+    e->start = start;
+    e->steps = steps;
+    e->d = kept;
+    pthread_mutex_unlock(&cache->lock);
+    return 0;
+}
+
+/* Answer one request line into out (always a single line, "OK ..." or "ERR ...") */
+static void answer(t_server *s, const char *line, t_text_buffer *out)
+{
+    const t_serve_graph *g = &s->g;
+    int n = g->graph.n;
+    char cmd[16];
+    int a = 0, b = 0, k = 0;
+    int args = sscanf(line, "%15s %d %d %d", cmd, &a, &b, &k) - 1;
+
+    if (args < 0) {
+        textBufferPrintf(out, "ERR empty request\n");
+    } else if (strcmp(cmd, "INFO") == 0) {
+        int closed = 0;
+        for (int c = 0; c < g->part.count; c++) closed += g->closed[c];
+        textBufferPrintf(out, "OK states %d edges %lld classes %d closed %d\n",
+                         n, g->edges, g->part.count, closed);
+    } else if (strcmp(cmd, "CLASS") == 0 && args == 1 && a >= 1 && a <= n) {
+        int c = g->part.v2c[a];
+        textBufferPrintf(out, "OK C%d size %d %s period %d\n", c + 1, g->part.classes[c].size,
+                         g->closed[c] ? "recurrent" : "transient", g->period[c]);
+    } else if (strcmp(cmd, "REACH") == 0 && args == 2) {
+        int r = reachQuery(&g->reach, a, b);
+        if (r < 0) textBufferPrintf(out, "ERR invalid states\n");
+        else textBufferPrintf(out, "OK %d\n", r);
+    } else if (strcmp(cmd, "STATIONARY") == 0 && args == 1 && a >= 1 && a <= n) {
+        textBufferPrintf(out, "OK %.9g\n", g->pi[a - 1]);
+    } else if (strcmp(cmd, "DIST") == 0 && args == 2 && a >= 1 && a <= n
+               && b >= 0 && b <= SERVE_MAX_STEPS) {
+        t_distribution d;
+        if (cachedDistribution(s, a, b, &d) != 0) {
+            textBufferPrintf(out, "ERR out of memory\n");
+        } else {
+            formatDistribution(&d, out);
+            distributionFree(&d);
+        }
+    } else if (strcmp(cmd, "PROB") == 0 && args == 3 && a >= 1 && a <= n && b >= 1 && b <= n
+               && k >= 0 && k <= SERVE_MAX_STEPS) {
+        /* Looked up in the cached distribution of (a, k) */
+        t_distribution d;
+        if (cachedDistribution(s, a, k, &d) != 0) {
+            textBufferPrintf(out, "ERR out of memory\n");
+        } else {
+            textBufferPrintf(out, "OK %.9g\n", distributionProbability(&d, b));
+            distributionFree(&d);
+        }
+    } else if (strcmp(cmd, "STATS") == 0) {
+        pthread_mutex_lock(&s->cache.lock);
+        textBufferPrintf(out, "OK clients %d requests %ld cache_hits %ld cache_misses %ld\n",
+                         s->clients, s->served, s->cache.hits, s->cache.misses);
+        pthread_mutex_unlock(&s->cache.lock);
+    } else {
+        textBufferPrintf(out, "ERR usage: INFO | CLASS v | REACH u v | STATIONARY v | DIST v k"
+                              " | PROB u v k | STATS | QUIT\n");
+    }
+}
+
+/* ---------- Connections ---------- */
+
+/* Helper : 1 if the first token of the line is QUIT, matched as answer() matches commands */
+static int isQuit(const char *line)
+{
+    char cmd[16];
+    return sscanf(line, "%15s", cmd) == 1 && strcmp(cmd, "QUIT") == 0;
+}
+
+/* Client thread : one response line per request line, until QUIT or EOF */
+static void *serveClient(void *arg)
+{
+    t_client *client = arg;
+    t_server *s = client->server;
+    FILE *in = fdopen(client->fd, "r");
+    char line[SERVE_LINE_MAX];
+
+    t_text_buffer out;
+    textBufferInit(&out);
+
+    while (in != NULL && fgets(line, sizeof(line), in) != NULL) {
+        /* A longer line would be read as several requests: drop the rest of it */
+        size_t len = strlen(line);
+        int tooLong = (len == sizeof(line) - 1 && line[len - 1] != '\n');
+        if (tooLong) {
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n') {}
+        } else if (isQuit(line)) {
+            break;
+        }
+
+        out.len = 0;
+        if (tooLong) textBufferPrintf(&out, "ERR request longer than %d bytes\n", SERVE_LINE_MAX - 2);
+        else answer(s, line, &out);
+        if (sendAll(client->fd, out.data, out.len) != 0) break;
+
+        pthread_mutex_lock(&s->cache.lock);
+        s->served++;
+        pthread_mutex_unlock(&s->cache.lock);
+    }
+
+    textBufferFree(&out);
+    if (in != NULL) fclose(in);   /* closes client->fd */
+    else close(client->fd);
+
+    pthread_mutex_lock(&s->cache.lock);
+    s->clients--;
+    pthread_mutex_unlock(&s->cache.lock);
+
+    free(client);
+    return NULL;
+}
+
+/* Helper : listening socket bound to path. A stale socket file is replaced;
+   any other file there is left alone and the server does not start. */
+static int listenOn(const char *path)
+{
+    struct sockaddr_un addr;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Error: socket path too long\n");
+        return -1;
+    }
+
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "Error: %s exists and is not a socket\n", path);
+            return -1;
+        }
+        unlink(path);
+    } else if (errno != ENOENT) {
+        perror(path);
+        return -1;
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SERVE_MAX_CLIENTS) != 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s graph_file socket_path\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    t_server *s = calloc(1, sizeof(t_server));
+    if (s == NULL) {
+        perror("calloc");
+        return EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "Loading %s...\n", argv[1]);
+    int rc = serveGraphLoad(argv[1], &s->g);
+    if (rc != 0) {
+        fprintf(stderr, "Error: could not load the graph (code %d)\n", rc);
+        if (s->g.graph.row_ptr != NULL) serveGraphFree(&s->g);
+        free(s);
+        return EXIT_FAILURE;
+    }
+    pthread_mutex_init(&s->cache.lock, NULL);
+
+    int listener = listenOn(argv[2]);
+    if (listener < 0) {
+        serveGraphFree(&s->g);
+        free(s);
+        return EXIT_FAILURE;
+    }
+
+    /* accept() is interrupted (no SA_RESTART) so that the socket file is removed on exit */
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onSignal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Client threads start with these blocked, so the signal always reaches accept() */
+    sigset_t stopSignals, mainMask;
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+
+    fprintf(stderr, "%d states, %d classes: listening on %s\n",
+            s->g.graph.n, s->g.part.count, argv[2]);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    while (!stopping) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            perror("accept");
+            break;
+        }
+
+        pthread_mutex_lock(&s->cache.lock);
+        int full = s->clients >= SERVE_MAX_CLIENTS;
+        if (!full) s->clients++;
+        pthread_mutex_unlock(&s->cache.lock);
+
+        t_client *client = full ? NULL : malloc(sizeof(t_client));
+        pthread_t thread;
+        if (client != NULL) {
+            client->server = s;
+            client->fd = fd;
+            pthread_sigmask(SIG_BLOCK, &stopSignals, &mainMask);
+            int created = pthread_create(&thread, &attr, serveClient, client);
+            pthread_sigmask(SIG_SETMASK, &mainMask, NULL);
+            if (created == 0) continue;
+            free(client);
+        }
+
+        /* Refused: too many clients, or no thread */
+        sendAll(fd, "ERR server busy\n", 16);
+        close(fd);
+        if (!full) {
+            pthread_mutex_lock(&s->cache.lock);
+            s->clients--;
+            pthread_mutex_unlock(&s->cache.lock);
+        }
+    }
+
+    /* Client threads may still read the graph: it is left to the OS */
+    fprintf(stderr, "Stopping.\n");
+    pthread_attr_destroy(&attr);
+    close(listener);
+    unlink(argv[2]);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adj_list.h"
+#include "partition.h"
+#include "tarjan.h"
+#include "graph_store.h"
+
+/* Print the command line help */
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s publish [-partition] <graph> <store>\n"
+            "       %s info <store>\n"
+            "       %s unlink <store>\n"
+            "  <store> is \"%s/name\" for POSIX shared memory, a file path otherwise.\n"
+            "  Every tool accepts a store wherever it asks for a graph file.\n",
+            prog, prog, prog, GRAPH_STORE_SHM_PREFIX);
+}
+
+/* Read the graph (and its classes) and publish it under name */
+static int publish(const char *graph, const char *name, int withPartition)
+{
+    AdjList *adj = adjReadFile(graph);
+    if (adj == NULL) {
+        fprintf(stderr, "Error: could not read graph from file %s.\n", graph);
+        return EXIT_FAILURE;
+    }
+
+    Partition part = partitionCreate(adj->n);
+    if (withPartition && (part.v2c == NULL || tarjanRun(adj, &part) != 0)) {
+        fprintf(stderr, "Error: Tarjan algorithm failed.\n");
+        partitionFree(&part);
+        adjFree(adj);
+        return EXIT_FAILURE;
+    }
+
+    int rc = graphStorePublish(name, adj, withPartition ? &part : NULL);
+    if (rc == 3) perror(name);
+    else if (rc != 0) fprintf(stderr, "Error: could not publish %s (code %d).\n", name, rc);
+    else if (withPartition) printf("%s: %d states, %d classes published.\n", name, adj->n, part.count);
+    else printf("%s: %d states published.\n", name, adj->n);
+
+    partitionFree(&part);
+    adjFree(adj);
+    return rc == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/* Attach and describe a store */
+static int info(const char *name)
+{
+    t_graph_store gs;
+    if (graphStoreAttach(name, &gs) != 0) {
+        fprintf(stderr, "Error: %s is not a valid graph store.\n", name);
+        return EXIT_FAILURE;
+    }
+
+    printf("%s: %d states, %d transitions, %.2f MB\n",
+           name, gs.n, gs.nnz, gs.size / (1024.0 * 1024.0));
+    if (gs.class_count >= 0) printf("partition: %d classes\n", gs.class_count);
+    else printf("partition: not published\n");
+
+    graphStoreDetach(&gs);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc >= 3 && strcmp(argv[1], "publish") == 0) {
+        int withPartition = strcmp(argv[2], "-partition") == 0;
+        if (argc == 4 + withPartition) {
+            return publish(argv[2 + withPartition], argv[3 + withPartition], withPartition);
+        }
+    } else if (argc == 3 && strcmp(argv[1], "info") == 0) {
+        return info(argv[2]);
+    } else if (argc == 3 && strcmp(argv[1], "unlink") == 0) {
+        if (graphStoreUnlink(argv[2]) != 0) {
+            perror(argv[2]);
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    usage(argv[0]);
+    return EXIT_FAILURE;
+}
@@ -1,65 +1,339 @@
 #include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 #include "markov_check.h"
 
-MarkovResult markovIsValid(const AdjList *adj, float lo, float hi) {
-    // Initialize the result assuming the graph is valid
-    MarkovResult res = {1, 0};
+// Compensated (Neumaier) sum of the outgoing probabilities of one vertex
+static double rowSum(const EdgeCell *cur) {
+    double sum = 0.0, comp = 0.0;
+
+    while (cur != NULL) {
+        double p = cur->p;
+        double t = sum + p;
+        if (fabs(sum) >= fabs(p)) comp += (sum - t) + p;
+        else comp += (p - t) + sum;
+        sum = t;
+        cur = cur->next;
+    }
+
+    return sum + comp;
+}
+
+// The stored probabilities are floats: compare at that precision so that
+// rounding noise below the input resolution never flips the verdict
+static int sumIsValid(double sum, float lo, float hi) {
+    float s = (float)sum;
+    return s >= lo && s <= hi;
+}
+
+// Count the vertices whose sum is out of range
+static void countBad(MarkovReport *rep) {
+    int bad = 0;
+
+    #pragma omp parallel for reduction(+:bad) schedule(static)
+    for (int i = 0; i < rep->n; ++i) {
+        if (!sumIsValid(rep->sum[i], rep->lo, rep->hi)) bad++;
+    }
+
+    rep->bad_count = bad;
+}
+
+int markovCompute(const AdjList *adj, float lo, float hi, MarkovReport *rep) {
+    if (rep == NULL) return 1;
+    rep->n = 0;
+    rep->sum = NULL;
+    rep->bad_count = 0;
+    rep->duplicates = 0;
 
     // Input validation
     if (adj == NULL || adj->n <= 0 || lo > hi) {
-        res.is_markov = 0;
-        return res;
+        return 1;
+    }
+
+    rep->sum = malloc(adj->n * sizeof(double));
+    if (!rep->sum) {
+        perror("malloc");
+        return 2;
     }
 
-    // Iterate over all vertices
+    rep->n = adj->n;
+    rep->lo = lo;
+    rep->hi = hi;
+
+    // Rows are independent: one pass, split across threads
+    #pragma omp parallel for schedule(dynamic, 1024)
     for (int i = 0; i < adj->n; ++i) {
-        float sum = 0.0f;
-        EdgeCell *cur = adj->L[i].head;
+        rep->sum[i] = rowSum(adj->L[i].head);
+    }
 
-        // Accumulate outgoing probabilities for vertex i
-        while (cur != NULL) {
-            sum += cur->p;
-            cur = cur->next;
-        }
+    countBad(rep);
+    return 0;
+}
 
-        // Check if the total sum is within the allowed tolerance
-        if (sum < lo || sum > hi) {
-            res.is_markov = 0;
-            res.bad_count++;
-        }
+AdjList *markovReadFile(const char *filename, float lo, float hi, DuplicatePolicy policy,
+                        MarkovReport *rep) {
+    if (rep == NULL || lo > hi) return NULL;
+    rep->n = 0;
+    rep->sum = NULL;
+    rep->bad_count = 0;
+    rep->duplicates = 0;
+
+    // Sums are accumulated by the loader as edges are merged
+    AdjList *adj = adjReadFileMerged(filename, policy, &rep->sum, &rep->duplicates);
+    if (adj == NULL) return NULL;
+
+    rep->n = adj->n;
+    rep->lo = lo;
+    rep->hi = hi;
+    countBad(rep);
+
+    return adj;
+}
+
+MarkovResult markovResultOf(const MarkovReport *rep) {
+    MarkovResult res = {0, 0};
+
+    if (rep == NULL || rep->sum == NULL) {
+        return res;
     }
 
+    res.is_markov = (rep->bad_count == 0);
+    res.bad_count = rep->bad_count;
     return res;
 }
 
-void markovReport(const AdjList *adj, float lo, float hi) {
-    // Basic input validation
-    if (adj == NULL || adj->n <= 0 || lo > hi) {
+void markovReportPrint(const MarkovReport *rep) {
+    if (rep == NULL || rep->sum == NULL) {
         printf("[markov_report] Invalid arguments.\n");
         return;
     }
 
     // Report header
     printf("---- Markov Verification Report ----\n");
-    printf("Tolerance: [%.3f, %.3f]\n", lo, hi);
+    printf("Tolerance: [%.3f, %.3f]\n", rep->lo, rep->hi);
 
-    // Iterate over all vertices
-    for (int i = 0; i < adj->n; ++i) {
-        float sum = 0.0f;                // accumulator for outgoing probabilities
-        EdgeCell *cur = adj->L[i].head;  // pointer to the first edge of vertex i
+    for (int i = 0; i < rep->n; ++i) {
+        if (!sumIsValid(rep->sum[i], rep->lo, rep->hi)) {
+            printf("Vertex %d: sum = %.3f  --> NOT OK\n", i + 1, rep->sum[i]);
+        } else {
+            printf("Vertex %d: sum = %.3f  --> OK\n", i + 1, rep->sum[i]);
+        }
+    }
+}
+
+void markovReportFree(MarkovReport *rep) {
+    if (rep == NULL) return;
+    free(rep->sum);
+    rep->sum = NULL;
+    rep->n = 0;
+}
+
+MarkovResult markovIsValid(const AdjList *adj, float lo, float hi) {
+    MarkovReport rep;
+    if (markovCompute(adj, lo, hi, &rep) != 0) {
+        MarkovResult res = {0, 0};
+        return res;
+    }
+
+    MarkovResult res = markovResultOf(&rep);
+    markovReportFree(&rep);
+    return res;
+}
+
+void markovReport(const AdjList *adj, float lo, float hi) {
+    MarkovReport rep;
+    if (markovCompute(adj, lo, hi, &rep) != 0) {
+        printf("[markov_report] Invalid arguments.\n");
+        return;
+    }
+
+    markovReportPrint(&rep);
+    markovReportFree(&rep);
+}
+
+// Multiply every probability of a row by factor
+static void scaleRow(EdgeCell *cur, double factor) {
+    for (; cur != NULL; cur = cur->next) {
+        cur->p = (float)(cur->p * factor);
+    }
+}
 
-        // Traverse adjacency list and accumulate probabilities
-        while (cur != NULL) {
-            sum += cur->p;
-            cur = cur->next;
+// Add mass to the self-loop of vertex u, creating it if needed; returns 1 if a cell was created
+static int addSelfLoop(AdjList *adj, int u, double mass) {
+    for (EdgeCell *cur = adj->L[u].head; cur != NULL; cur = cur->next) {
+        if (cur->v == u) {
+            cur->p = (float)(cur->p + mass);
+            return 0;
         }
+    }
+
+    EdgeCell *cell = malloc(sizeof(EdgeCell));
+    if (!cell) {
+        perror("malloc");
+        exit(EXIT_FAILURE);
+    }
 
-        // Check if the sum is within the valid tolerance range
-        if (sum < lo || sum > hi) {
-            printf("Vertex %d: sum = %.3f  --> NOT OK\n", i + 1, sum);
+    cell->v = u;
+    cell->p = (float)mass;
+    cell->next = adj->L[u].head;
+    adj->L[u].head = cell;
+    return 1;
+}
+
+// Scale and self-loop policies: rows are independent, no renumbering
+static void repairRows(AdjList *adj, float lo, float hi, MarkovRepairPolicy policy,
+                       MarkovRepairStats *stats) {
+    int scaled = 0, loops = 0, left = 0;
+
+    #pragma omp parallel for reduction(+:scaled, loops, left) schedule(dynamic, 1024)
+    for (int i = 0; i < adj->n; ++i) {
+        double sum = rowSum(adj->L[i].head);
+        if (sumIsValid(sum, lo, hi)) continue;
+
+        if (policy == MARKOV_REPAIR_SELF_LOOP && sum < 1.0) {
+            loops += addSelfLoop(adj, i, 1.0 - sum);
+        } else if (sum > 0.0) {
+            scaleRow(adj->L[i].head, 1.0 / sum);
+            scaled++;
         } else {
-            printf("Vertex %d: sum = %.3f  --> OK\n", i + 1, sum);
+            left++;
+        }
+    }
+
+    stats->rows_scaled = scaled;
+    stats->loops_added = loops;
+    stats->rows_left = left;
+}
+
+// Mass of row i that goes to kept vertices
+static double keptMass(const EdgeCell *cur, const unsigned char *keep) {
+    double sum = 0.0;
+    for (; cur != NULL; cur = cur->next) {
+        if (keep[cur->v]) sum += cur->p;
+    }
+    return sum;
+}
+
+// Drop policy: remove vertices without outgoing mass (and, in cascade, those whose
+// whole mass went to removed vertices), then compact and renumber in place
+static int dropZeroRows(AdjList *adj, float lo, float hi, MarkovRepairStats *stats) {
+    int n = adj->n;
+    unsigned char *keep = malloc(n);
+    unsigned char *next = malloc(n);
+    int *newId = malloc(n * sizeof(int));
+    if (!keep || !next || !newId) {
+        perror("malloc");
+        free(keep);
+        free(next);
+        free(newId);
+        return 2;
+    }
+
+    for (int i = 0; i < n; ++i) keep[i] = 1;
+
+    /* Rounds until no vertex loses its last kept edge (double buffered, no races) */
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+
+        #pragma omp parallel for reduction(|:changed) schedule(dynamic, 1024)
+        for (int i = 0; i < n; ++i) {
+            next[i] = keep[i] && keptMass(adj->L[i].head, keep) > 0.0;
+            if (next[i] != keep[i]) changed = 1;
+        }
+
+        unsigned char *t = keep;
+        keep = next;
+        next = t;
+    }
+
+    int count = 0;
+    for (int i = 0; i < n; ++i) {
+        newId[i] = keep[i] ? count++ : -1;
+    }
+
+    if (count == 0) {
+        free(keep);
+        free(next);
+        free(newId);
+        return 3;
+    }
+
+    int scaled = 0;
+
+    #pragma omp parallel for reduction(+:scaled) schedule(dynamic, 1024)
+    for (int i = 0; i < n; ++i) {
+        EdgeCell **link = &adj->L[i].head;
+
+        /* Removed vertex: free its whole list */
+        if (!keep[i]) {
+            while (*link) {
+                EdgeCell *dead = *link;
+                *link = dead->next;
+                free(dead);
+            }
+            continue;
+        }
+
+        /* Kept vertex: unlink edges to removed vertices, renumber the others */
+        double sum = 0.0;
+        int removed = 0;
+        while (*link) {
+            EdgeCell *cur = *link;
+            if (newId[cur->v] < 0) {
+                *link = cur->next;
+                free(cur);
+                removed = 1;
+            } else {
+                cur->v = newId[cur->v];
+                sum += cur->p;
+                link = &cur->next;
+            }
+        }
+
+        if (removed || !sumIsValid(sum, lo, hi)) {
+            scaleRow(adj->L[i].head, 1.0 / sum);
+            scaled++;
         }
     }
-}
\ No newline at end of file
+
+    /* Compact the list heads, keeping the relative order */
+    for (int i = 0; i < n; ++i) {
+        if (keep[i]) adj->L[newId[i]] = adj->L[i];
+    }
+
+    adj->n = count;
+    stats->rows_scaled = scaled;
+    stats->rows_dropped = n - count;
+
+    free(keep);
+    free(next);
+    free(newId);
+    return 0;
+}
+
+int markovRepair(AdjList *adj, float lo, float hi, MarkovRepairPolicy policy,
+                 MarkovRepairStats *stats) {
+    MarkovRepairStats local;
+    if (stats == NULL) stats = &local;
+    stats->rows_scaled = 0;
+    stats->loops_added = 0;
+    stats->rows_dropped = 0;
+    stats->rows_left = 0;
+
+    if (adj == NULL || adj->n <= 0 || lo > hi) {
+        return 1;
+    }
+
+    switch (policy) {
+        case MARKOV_REPAIR_SCALE:
+        case MARKOV_REPAIR_SELF_LOOP:
+            repairRows(adj, lo, hi, policy, stats);
+            return 0;
+        case MARKOV_REPAIR_DROP_ZERO:
+            return dropZeroRows(adj, lo, hi, stats);
+        default:
+            return 1;
+    }
+}
@@ -59,7 +59,7 @@ t_matrix adjToMatrix(const AdjList *adj) {
             int j = curr->v;      /* 0-based destination */
             float p = curr->p;
             if (j >= 0 && j < n) {
-                mat.data[i][j] = p;
+                mat.data[i][j] += p;   /* duplicate edges add up, as in markovIsValid */
             }
             curr = curr->next;
         }
@@ -119,19 +119,59 @@ double matrixDiff(t_matrix A, t_matrix B) {
     return diff;
 }
 
-/* Print matrix */
-void matrixPrint(t_matrix mat) {
+/* y = x * M, where x is a row vector (probability distribution) */
+void vectorMatrixMultiply(const double *x, t_matrix M, double *y) {
+    int n = M.size;
+
+    for (int j = 0; j < n; j++) y[j] = 0.0;
+
+    /* Row-oriented loop: skips zero entries of x and reads M row by row */
+    for (int i = 0; i < n; i++) {
+        double xi = x[i];
+        if (xi == 0.0) continue;
+        const double *row = M.data[i];
+        for (int j = 0; j < n; j++) {
+            y[j] += xi * row[j];
+        }
+    }
+}
+
+/* y = M * x, where x is a column vector */
+void matrixVectorMultiply(t_matrix M, const double *x, double *y) {
+    int n = M.size;
+
+    for (int i = 0; i < n; i++) {
+        const double *row = M.data[i];
+        double sum = 0.0;
+        for (int j = 0; j < n; j++) {
+            sum += row[j] * x[j];
+        }
+        y[i] = sum;
+    }
+}
+
+/* Append matrix to a text buffer */
+void matrixFormat(t_text_buffer *out, t_matrix mat) {
     if (!mat.data) return;
 
     for (int i = 0; i < mat.size; i++) {
-        printf("| ");
+        textBufferAppend(out, "| ", 2);
         for (int j = 0; j < mat.size; j++) {
-            if (fabs(mat.data[i][j]) < 0.0001) printf("  .   ");
-            else printf("%5.2f ", mat.data[i][j]);
+            if (fabs(mat.data[i][j]) < 0.0001) textBufferAppend(out, "  .   ", 6);
+            else textBufferPrintf(out, "%5.2f ", mat.data[i][j]);
         }
-        printf("|\n");
+        textBufferAppend(out, "|\n", 2);
     }
-    printf("\n");
+    textBufferAppend(out, "\n", 1);
+}
+
+/* Print matrix */
+void matrixPrint(t_matrix mat) {
+    t_text_buffer out;
+    textBufferInit(&out);
+    matrixFormat(&out, mat);
+    textBufferFlush(&out, stdout);
+    textBufferFree(&out);
 }
 
 /* Extract submatrix for class index */
@@ -216,3 +256,788 @@ int getPeriod(t_matrix sub_matrix) {
 
     return period;
 }
+
+/* ---------- Sparse (CSR) matrices ---------- */
+
+/* Graphs larger than this, with at most 1 / SPARSE_DENSITY_DIV of the entries set, go sparse */
+#define SPARSE_MIN_SIZE 64
+#define SPARSE_DENSITY_DIV 10
+
+/* Create rows×cols CSR matrix with room for nnz entries */
+t_sparse_matrix sparseCreate(int rows, int cols, int nnz) {
+    t_sparse_matrix mat;
+    mat.rows = rows;
+    mat.cols = cols;
+    mat.nnz = 0;
+    mat.row_ptr = NULL;
+    mat.col_idx = NULL;
+    mat.values = NULL;
+
+    if (rows <= 0 || cols <= 0 || nnz < 0) {
+        return mat;
+    }
+
+    mat.row_ptr = (int *)calloc(rows + 1, sizeof(int));
+    mat.col_idx = (int *)malloc((nnz > 0 ? nnz : 1) * sizeof(int));
+    mat.values = (double *)malloc((nnz > 0 ? nnz : 1) * sizeof(double));
+    if (!mat.row_ptr || !mat.col_idx || !mat.values) {
+        perror("alloc sparse");
+        exit(EXIT_FAILURE);
+    }
+    mat.nnz = nnz;
+    return mat;
+}
+
+/* Free sparse matrix memory */
+void sparseFree(t_sparse_matrix *mat) {
+    if (!mat) return;
+
+    free(mat->row_ptr);
+    free(mat->col_idx);
+    free(mat->values);
+
+    mat->row_ptr = NULL;
+    mat->col_idx = NULL;
+    mat->values = NULL;
+    mat->rows = 0;
+    mat->cols = 0;
+    mat->nnz = 0;
+}
+
+/* Entry of a row being sorted */
+typedef struct {
+    int col;
+    double val;
+} t_sparse_entry;
+
+static int compareEntries(const void *a, const void *b) {
+    int ca = ((const t_sparse_entry *)a)->col;
+    int cb = ((const t_sparse_entry *)b)->col;
+    return (ca > cb) - (ca < cb);
+}
+
+/* Sort each row of M by column (rows are usually short: insertion sort, qsort otherwise) */
+static void sparseSortRows(t_sparse_matrix M) {
+    t_sparse_entry *tmp = NULL;
+    int tmpCap = 0;
+
+    for (int i = 0; i < M.rows; i++) {
+        int b = M.row_ptr[i], e = M.row_ptr[i + 1];
+        int len = e - b;
+
+        if (len <= 16) {
+            for (int a = b + 1; a < e; a++) {
+                int c = M.col_idx[a];
+                double v = M.values[a];
+                int k = a - 1;
+                while (k >= b && M.col_idx[k] > c) {
+                    M.col_idx[k + 1] = M.col_idx[k];
+                    M.values[k + 1] = M.values[k];
+                    k--;
+                }
+                M.col_idx[k + 1] = c;
+                M.values[k + 1] = v;
+            }
+            continue;
+        }
+
+        if (len > tmpCap) {
+            t_sparse_entry *grown = realloc(tmp, len * sizeof(t_sparse_entry));
+            if (!grown) {
+                perror("alloc sort");
+                exit(EXIT_FAILURE);
+            }
+            tmp = grown;
+            tmpCap = len;
+        }
+        for (int k = 0; k < len; k++) {
+            tmp[k].col = M.col_idx[b + k];
+            tmp[k].val = M.values[b + k];
+        }
+        qsort(tmp, len, sizeof(t_sparse_entry), compareEntries);
+        for (int k = 0; k < len; k++) {
+            M.col_idx[b + k] = tmp[k].col;
+            M.values[b + k] = tmp[k].val;
+        }
+    }
+    free(tmp);
+}
+
+/* Build CSR transition matrix from adjacency list */
+t_sparse_matrix adjToSparse(const AdjList *adj) {
+    if (!adj || adj->n <= 0) {
+        t_sparse_matrix empty = {0, 0, 0, NULL, NULL, NULL};
+        return empty;
+    }
+
+    int n = adj->n;
+    int nnz = 0;
+    for (int i = 0; i < n; i++) {
+        for (EdgeCell *curr = adj->L[i].head; curr; curr = curr->next) {
+            if (curr->v >= 0 && curr->v < n) nnz++;
+        }
+    }
+
+    t_sparse_matrix S = sparseCreate(n, n, nnz);
+
+    /* slot[j]: position of column j in the current row, to merge duplicates
+       the way adjToMatrix does (their probabilities add up) */
+    int *slot = (int *)malloc(n * sizeof(int));
+    if (!slot) {
+        perror("alloc slot");
+        exit(EXIT_FAILURE);
+    }
+    for (int j = 0; j < n; j++) slot[j] = -1;
+
+    int pos = 0;
+    for (int i = 0; i < n; i++) {
+        S.row_ptr[i] = pos;
+        for (EdgeCell *curr = adj->L[i].head; curr; curr = curr->next) {
+            int j = curr->v;
+            if (j < 0 || j >= n) continue;
+            if (slot[j] >= S.row_ptr[i]) {
+                S.values[slot[j]] += curr->p;
+            } else {
+                slot[j] = pos;
+                S.col_idx[pos] = j;
+                S.values[pos] = curr->p;
+                pos++;
+            }
+        }
+    }
+    S.row_ptr[n] = pos;
+    S.nnz = pos;
+
+    free(slot);
+    sparseSortRows(S);
+    return S;
+}
+
+t_sparse_matrix csrToSparse(const AdjCsr *g) {
+    if (!g || !g->row_ptr || g->n <= 0) {
+        t_sparse_matrix empty = {0, 0, 0, NULL, NULL, NULL};
+        return empty;
+    }
+
+    int n = g->n;
+    t_sparse_matrix S = sparseCreate(n, n, g->nnz);
+
+    int *slot = (int *)malloc(n * sizeof(int));
+    if (!slot) {
+        perror("alloc slot");
+        exit(EXIT_FAILURE);
+    }
+    for (int j = 0; j < n; j++) slot[j] = -1;
+
+    int pos = 0;
+    for (int i = 0; i < n; i++) {
+        S.row_ptr[i] = pos;
+        for (int e = g->row_ptr[i]; e < g->row_ptr[i + 1]; e++) {
+            int j = g->v[e];
+            if (j < 0 || j >= n) continue;
+            if (slot[j] >= S.row_ptr[i]) {
+                S.values[slot[j]] += g->p[e];
+            } else {
+                slot[j] = pos;
+                S.col_idx[pos] = j;
+                S.values[pos] = g->p[e];
+                pos++;
+            }
+        }
+    }
+    S.row_ptr[n] = pos;
+    S.nnz = pos;
+
+    free(slot);
+    sparseSortRows(S);
+    return S;
+}
+
+/* Sparse storage pays off on large graphs that are far from complete */
+int matrixPreferSparse(int n, long nnz) {
+    if (n < SPARSE_MIN_SIZE) return 0;
+    return nnz <= (long)n * n / SPARSE_DENSITY_DIV;
+}
+
+/* Expand S into a dense matrix */
+t_matrix sparseToDense(t_sparse_matrix S) {
+    t_matrix mat = matrixCreate(S.rows);
+    for (int i = 0; i < S.rows; i++) {
+        for (int e = S.row_ptr[i]; e < S.row_ptr[i + 1]; e++) {
+            mat.data[i][S.col_idx[e]] = S.values[e];
+        }
+    }
+    return mat;
+}
+
+/* Append sparse matrix to a text buffer, matrixPrint layout */
+void sparseFormat(t_text_buffer *out, t_sparse_matrix mat) {
+    if (!mat.row_ptr) return;
+
+    for (int i = 0; i < mat.rows; i++) {
+        textBufferAppend(out, "| ", 2);
+        int e = mat.row_ptr[i];
+        for (int j = 0; j < mat.cols; j++) {
+            double v = 0.0;
+            if (e < mat.row_ptr[i + 1] && mat.col_idx[e] == j) {
+                v = mat.values[e++];
+            }
+            if (fabs(v) < 0.0001) textBufferAppend(out, "  .   ", 6);
+            else textBufferPrintf(out, "%5.2f ", v);
+        }
+        textBufferAppend(out, "|\n", 2);
+    }
+    textBufferAppend(out, "\n", 1);
+}
+
+/* Print sparse matrix with the matrixPrint layout */
+void sparsePrint(t_sparse_matrix mat) {
+    t_text_buffer out;
+    textBufferInit(&out);
+    sparseFormat(&out, mat);
+    textBufferFlush(&out, stdout);
+    textBufferFree(&out);
+}
+
+/* y = x * M */
+void sparseVectorMultiply(const double *x, t_sparse_matrix M, double *y) {
+    for (int j = 0; j < M.cols; j++) y[j] = 0.0;
+
+    for (int i = 0; i < M.rows; i++) {
+        double xi = x[i];
+        if (xi == 0.0) continue;
+        for (int e = M.row_ptr[i]; e < M.row_ptr[i + 1]; e++) {
+            y[M.col_idx[e]] += xi * M.values[e];
+        }
+    }
+}
+
+/* y = M * x */
+void sparseMatrixVectorMultiply(t_sparse_matrix M, const double *x, double *y) {
+    for (int i = 0; i < M.rows; i++) {
+        double sum = 0.0;
+        for (int e = M.row_ptr[i]; e < M.row_ptr[i + 1]; e++) {
+            sum += M.values[e] * x[M.col_idx[e]];
+        }
+        y[i] = sum;
+    }
+}
+
+/* Transpose by counting sort on the columns (keeps rows sorted) */
+t_sparse_matrix sparseTranspose(t_sparse_matrix M) {
+    t_sparse_matrix T = sparseCreate(M.cols, M.rows, M.nnz);
+    if (!T.row_ptr) return T;
+
+    for (int i = 0; i < M.rows; i++) {
+        for (int e = M.row_ptr[i]; e < M.row_ptr[i + 1]; e++) {
+            T.row_ptr[M.col_idx[e] + 1]++;
+        }
+    }
+    for (int j = 0; j < M.cols; j++) T.row_ptr[j + 1] += T.row_ptr[j];
+
+    int *fill = (int *)malloc(M.cols * sizeof(int));
+    if (!fill) {
+        perror("alloc transpose");
+        exit(EXIT_FAILURE);
+    }
+    for (int j = 0; j < M.cols; j++) fill[j] = T.row_ptr[j];
+
+    for (int i = 0; i < M.rows; i++) {
+        for (int e = M.row_ptr[i]; e < M.row_ptr[i + 1]; e++) {
+            int p = fill[M.col_idx[e]]++;
+            T.col_idx[p] = i;
+            T.values[p] = M.values[e];
+        }
+    }
+
+    free(fill);
+    return T;
+}
+
+/* Sum of each row */
+void sparseRowSums(t_sparse_matrix M, double *sums) {
+    for (int i = 0; i < M.rows; i++) {
+        double s = 0.0;
+        for (int e = M.row_ptr[i]; e < M.row_ptr[i + 1]; e++) {
+            s += M.values[e];
+        }
+        sums[i] = s;
+    }
+}
+
+/* Period: gcd of level[u] + 1 - level[v] over all edges u -> v of a BFS from state 0 */
+int sparsePeriod(t_sparse_matrix sub_matrix) {
+    int n = sub_matrix.rows;
+    if (n <= 0) return 0;
+
+    int *level = (int *)malloc(n * sizeof(int));
+    int *queue = (int *)malloc(n * sizeof(int));
+    if (!level || !queue) {
+        perror("malloc");
+        free(level);
+        free(queue);
+        return 0;
+    }
+    for (int i = 0; i < n; i++) level[i] = -1;
+
+    int head = 0, tail = 0;
+    level[0] = 0;
+    queue[tail++] = 0;
+
+    int period = 0;
+    while (head < tail) {
+        int u = queue[head++];
+        for (int e = sub_matrix.row_ptr[u]; e < sub_matrix.row_ptr[u + 1]; e++) {
+            if (sub_matrix.values[e] <= 0.0) continue;
+            int v = sub_matrix.col_idx[e];
+            if (level[v] < 0) {
+                level[v] = level[u] + 1;
+                queue[tail++] = v;
+            } else {
+                int d = level[u] + 1 - level[v];
+                if (d < 0) d = -d;
+                period = gcd_int(period, d);
+            }
+        }
+    }
+
+    free(level);
+    free(queue);
+    return period;
+}
+
+/* Dimension of a dense or sparse transition matrix */
+int matrixRefSize(t_matrix_ref M) {
+    if (M.dense) return M.dense->size;
+    if (M.sparse) return M.sparse->rows;
+    return 0;
+}
+
+/* y = x * M on either storage */
+void matrixRefVectorMultiply(const double *x, t_matrix_ref M, double *y) {
+    if (M.dense) vectorMatrixMultiply(x, *M.dense, y);
+    else if (M.sparse) sparseVectorMultiply(x, *M.sparse, y);
+}
+
+/* y = M * x on either storage */
+void matrixRefMatrixVectorMultiply(t_matrix_ref M, const double *x, double *y) {
+    if (M.dense) matrixVectorMultiply(*M.dense, x, y);
+    else if (M.sparse) sparseMatrixVectorMultiply(*M.sparse, x, y);
+}
+
+/* ---------- Sparse products (multi-step transitions) ---------- */
+
+/* Rows handled by one SpGEMM task */
+#define SPGEMM_CHUNK_ROWS 256
+
+/* Bytes held by a CSR matrix */
+long sparseBytes(t_sparse_matrix M) {
+    return (long)(M.rows + 1) * (long)sizeof(int)
+         + (long)M.nnz * (long)(sizeof(int) + sizeof(double));
+}
+
+static int compareInts(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+/* Helper : 1 if column x ranks before column y (larger |acc| first, then smaller column) */
+static int ranksBefore(const double *acc, int x, int y) {
+    double ax = fabs(acc[x]), ay = fabs(acc[y]);
+    return ax > ay || (ax == ay && x < y);
+}
+
+/* Helper : move the cap best ranked columns of pattern[0 .. np) to the front (quickselect) */
+static void selectLargest(int *pattern, int np, int cap, const double *acc) {
+    int lo = 0, hi = np - 1;
+    while (lo < hi) {
+        int pivot = pattern[lo + (hi - lo) / 2];
+        int i = lo, j = hi;
+        while (i <= j) {
+            while (ranksBefore(acc, pattern[i], pivot)) i++;
+            while (ranksBefore(acc, pivot, pattern[j])) j--;
+            if (i <= j) {
+                int t = pattern[i];
+                pattern[i] = pattern[j];
+                pattern[j] = t;
+                i++;
+                j--;
+            }
+        }
+        if (cap - 1 <= j) hi = j;
+        else if (cap - 1 >= i) lo = i;
+        else break;
+    }
+}
+
+/* Gustavson row-by-row product with a dense accumulator per thread, in two passes:
+   a symbolic one sizes every row (at most row_cap entries), then C is allocated once
+   and the numeric pass writes each row in place. Nothing larger than C is ever held.
+   Rows are split in fixed chunks, so the result does not depend on the thread count. */
+t_sparse_matrix sparseMultiplyCapped(t_sparse_matrix A, t_sparse_matrix B, double drop_tol,
+                                     int row_cap, double *dropped, long *capped) {
+    if (A.cols != B.rows || A.rows <= 0 || B.cols <= 0) {
+        fprintf(stderr, "size mismatch sparse mult\n");
+        t_sparse_matrix empty = {0, 0, 0, NULL, NULL, NULL};
+        return empty;
+    }
+
+    int rows = A.rows, cols = B.cols;
+    int chunks = (rows + SPGEMM_CHUNK_ROWS - 1) / SPGEMM_CHUNK_ROWS;
+
+    int *rowLen = (int *)malloc(rows * sizeof(int));
+    double *chunkLost = (double *)calloc(chunks, sizeof(double));
+    long *chunkCapped = (long *)calloc(chunks, sizeof(long));
+    if (!rowLen || !chunkLost || !chunkCapped) {
+        perror("alloc spgemm");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Symbolic pass: distinct columns of every row, capped */
+    #pragma omp parallel
+    {
+        int *mark = (int *)malloc(cols * sizeof(int));
+        if (!mark) {
+            perror("alloc spgemm");
+            exit(EXIT_FAILURE);
+        }
+        for (int j = 0; j < cols; j++) mark[j] = -1;
+
+        #pragma omp for schedule(dynamic, 1)
+        for (int ch = 0; ch < chunks; ch++) {
+            int first = ch * SPGEMM_CHUNK_ROWS;
+            int last = first + SPGEMM_CHUNK_ROWS < rows ? first + SPGEMM_CHUNK_ROWS : rows;
+
+            for (int i = first; i < last; i++) {
+                int np = 0;
+                for (int ea = A.row_ptr[i]; ea < A.row_ptr[i + 1]; ea++) {
+                    int k = A.col_idx[ea];
+                    for (int eb = B.row_ptr[k]; eb < B.row_ptr[k + 1]; eb++) {
+                        int j = B.col_idx[eb];
+                        if (mark[j] != i) {
+                            mark[j] = i;
+                            np++;
+                        }
+                    }
+                }
+                rowLen[i] = (row_cap > 0 && np > row_cap) ? row_cap : np;
+            }
+        }
+        free(mark);
+    }
+
+    long nnz = 0;
+    for (int i = 0; i < rows; i++) nnz += rowLen[i];
+    if (nnz > 0x7fffffffL) {
+        fprintf(stderr, "sparse product too large (%ld entries)\n", nnz);
+        exit(EXIT_FAILURE);
+    }
+
+    t_sparse_matrix C = sparseCreate(rows, cols, (int)nnz);
+    for (int i = 0; i < rows; i++) C.row_ptr[i + 1] = C.row_ptr[i] + rowLen[i];
+
+    /* Numeric pass: row i goes to its slot, pruned below drop_tol, then cut to row_cap */
+    #pragma omp parallel
+    {
+        double *acc = (double *)calloc(cols, sizeof(double));
+        int *mark = (int *)malloc(cols * sizeof(int));
+        int *pattern = (int *)malloc(cols * sizeof(int));
+        if (!acc || !mark || !pattern) {
+            perror("alloc spgemm");
+            exit(EXIT_FAILURE);
+        }
+        for (int j = 0; j < cols; j++) mark[j] = -1;
+
+        #pragma omp for schedule(dynamic, 1)
+        for (int ch = 0; ch < chunks; ch++) {
+            int first = ch * SPGEMM_CHUNK_ROWS;
+            int last = first + SPGEMM_CHUNK_ROWS < rows ? first + SPGEMM_CHUNK_ROWS : rows;
+
+            for (int i = first; i < last; i++) {
+                int np = 0;
+                for (int ea = A.row_ptr[i]; ea < A.row_ptr[i + 1]; ea++) {
+                    int k = A.col_idx[ea];
+                    double a = A.values[ea];
+                    for (int eb = B.row_ptr[k]; eb < B.row_ptr[k + 1]; eb++) {
+                        int j = B.col_idx[eb];
+                        if (mark[j] != i) {
+                            mark[j] = i;
+                            acc[j] = 0.0;
+                            pattern[np++] = j;
+                        }
+                        acc[j] += a * B.values[eb];
+                    }
+                }
+
+                int kept = 0;
+                for (int p = 0; p < np; p++) {
+                    int j = pattern[p];
+                    if (fabs(acc[j]) < drop_tol) {
+                        chunkLost[ch] += acc[j];
+                        continue;
+                    }
+                    pattern[kept++] = j;
+                }
+
+                if (row_cap > 0 && kept > row_cap) {
+                    selectLargest(pattern, kept, row_cap, acc);
+                    for (int p = row_cap; p < kept; p++) chunkLost[ch] += acc[pattern[p]];
+                    kept = row_cap;
+                    chunkCapped[ch]++;
+                }
+
+                qsort(pattern, kept, sizeof(int), compareInts);
+
+                int base = C.row_ptr[i];
+                for (int p = 0; p < kept; p++) {
+                    C.col_idx[base + p] = pattern[p];
+                    C.values[base + p] = acc[pattern[p]];
+                }
+                rowLen[i] = kept;
+            }
+        }
+
+        free(acc);
+        free(mark);
+        free(pattern);
+    }
+
+    /* Pruned rows are shorter than their slots: close the gaps */
+    int pos = 0;
+    for (int i = 0; i < rows; i++) {
+        int begin = C.row_ptr[i];
+        C.row_ptr[i] = pos;
+        for (int e = 0; e < rowLen[i]; e++) {
+            C.col_idx[pos] = C.col_idx[begin + e];
+            C.values[pos] = C.values[begin + e];
+            pos++;
+        }
+    }
+    C.row_ptr[rows] = pos;
+    C.nnz = pos;
+
+    double lost = 0.0;
+    long trimmed = 0;
+    for (int ch = 0; ch < chunks; ch++) {
+        lost += chunkLost[ch];
+        trimmed += chunkCapped[ch];
+    }
+    if (dropped) *dropped += lost;
+    if (capped) *capped += trimmed;
+
+    free(rowLen);
+    free(chunkLost);
+    free(chunkCapped);
+    return C;
+}
+
+/* Unlimited rows */
+t_sparse_matrix sparseMultiply(t_sparse_matrix A, t_sparse_matrix B, double drop_tol, double *dropped) {
+    return sparseMultiplyCapped(A, B, drop_tol, 0, dropped, NULL);
+}
+
+/* In-place compaction of the entries below drop_tol */
+double sparsePrune(t_sparse_matrix *M, double drop_tol) {
+    if (!M || !M->row_ptr) return 0.0;
+
+    double lost = 0.0;
+    int pos = 0;
+    int begin = M->row_ptr[0];
+
+    for (int i = 0; i < M->rows; i++) {
+        int end = M->row_ptr[i + 1];
+        M->row_ptr[i] = pos;
+        for (int e = begin; e < end; e++) {
+            if (fabs(M->values[e]) < drop_tol) {
+                lost += M->values[e];
+                continue;
+            }
+            M->col_idx[pos] = M->col_idx[e];
+            M->values[pos] = M->values[e];
+            pos++;
+        }
+        begin = end;
+    }
+    M->row_ptr[M->rows] = pos;
+    M->nnz = pos;
+    return lost;
+}
+
+/* Helper : entries per row that keep a product of rows rows within room bytes (at least 1) */
+static int budgetRowCap(long room, int rows) {
+    long cap = (room - (long)(rows + 1) * (long)sizeof(int))
+             / ((long)rows * (long)(sizeof(int) + sizeof(double)));
+    if (cap > 0x7fffffffL / rows) cap = 0x7fffffffL / rows;
+    return cap > 1 ? (int)cap : 1;
+}
+
+/* start * M^steps with pruning and an optional memory budget. The operand and the
+   product of a step are alive together: the product gets what the operand leaves
+   of the budget, shared equally between its rows. start is read in place. */
+t_sparse_matrix sparseAdvance(t_sparse_matrix start, t_sparse_matrix M, int steps,
+                              double drop_tol, long max_bytes, t_sparse_power_info *info) {
+    t_sparse_power_info local = {0, drop_tol, 0, 0, 0.0, sparseBytes(start)};
+
+    t_sparse_matrix cur = start;
+    int owned = 0;
+
+    for (int s = 0; s < steps && cur.rows > 0; s++) {
+        int cap = 0;
+        if (max_bytes > 0) {
+            cap = budgetRowCap(max_bytes - sparseBytes(cur), cur.rows);
+            if (local.row_cap == 0 || cap < local.row_cap) local.row_cap = cap;
+        }
+
+        t_sparse_matrix next = sparseMultiplyCapped(cur, M, local.drop_tol, cap,
+                                                    &local.dropped_mass, &local.capped_rows);
+        local.products++;
+        if (sparseBytes(cur) + sparseBytes(next) > local.peak_bytes) {
+            local.peak_bytes = sparseBytes(cur) + sparseBytes(next);
+        }
+        if (owned) sparseFree(&cur);
+        cur = next;
+        owned = 1;
+    }
+
+    /* No product: the caller still gets a matrix of its own (start may be a view) */
+    if (!owned && start.rows > 0) {
+        cur = sparseCreate(start.rows, start.cols, start.nnz);
+        int base = start.row_ptr[0];
+        for (int i = 0; i <= start.rows; i++) cur.row_ptr[i] = start.row_ptr[i] - base;
+        for (int e = 0; e < start.nnz; e++) {
+            cur.col_idx[e] = start.col_idx[base + e];
+            cur.values[e] = start.values[base + e];
+        }
+    }
+
+    if (info) *info = local;
+    return cur;
+}
+
+/* ---------- All class blocks in one pass ---------- */
+
+/* Deduplicated, sorted rows in the original numbering, then the blocks */
+int classBlocksBuild(const AdjList *adj, const Partition *part, t_class_blocks *cb) {
+    if (!adj) {
+        return 1;
+    }
+
+    t_sparse_matrix S = adjToSparse(adj);
+    int rc = classBlocksBuildSparse(S, part, cb);
+    sparseFree(&S);
+    return rc;
+}
+
+/* Bucket every entry of S by v2c: intra-class entries go to diag, the others to offdiag */
+int classBlocksBuildSparse(t_sparse_matrix S, const Partition *part, t_class_blocks *cb) {
+    if (!S.row_ptr || S.rows != S.cols || !part || !cb || !part->v2c || part->count <= 0) {
+        return 1;
+    }
+
+    int n = S.rows;
+    int count = part->count;
+
+    cb->count = count;
+    cb->n = n;
+    cb->perm = (int *)malloc(n * sizeof(int));
+    cb->inv = (int *)malloc(n * sizeof(int));
+    cb->class_start = (int *)malloc((count + 1) * sizeof(int));
+    cb->blocks = (t_sparse_matrix *)malloc(count * sizeof(t_sparse_matrix));
+    if (!cb->perm || !cb->inv || !cb->class_start || !cb->blocks) {
+        perror("alloc blocks");
+        exit(EXIT_FAILURE);
+    }
+
+    /* Block order */
+    int pos = 0;
+    for (int c = 0; c < count; c++) {
+        cb->class_start[c] = pos;
+        for (int i = 0; i < part->classes[c].size; i++) {
+            int old = part->classes[c].vertices[i] - 1; /* convert to 0-based */
+            cb->perm[pos] = old;
+            cb->inv[old] = pos;
+            pos++;
+        }
+    }
+    cb->class_start[count] = pos;
+    if (pos != n) {
+        fprintf(stderr, "partition does not cover the graph\n");
+        free(cb->perm);
+        free(cb->inv);
+        free(cb->class_start);
+        free(cb->blocks);
+        return 2;
+    }
+
+    int nd = 0, no = 0;
+    for (int u = 0; u < n; u++) {
+        int cu = part->v2c[u + 1];
+        for (int e = S.row_ptr[u]; e < S.row_ptr[u + 1]; e++) {
+            if (part->v2c[S.col_idx[e] + 1] == cu) nd++;
+            else no++;
+        }
+    }
+
+    cb->diag = sparseCreate(n, n, nd);
+    cb->offdiag = sparseCreate(n, n, no);
+
+    int pd = 0, po = 0;
+    for (int r = 0; r < n; r++) {
+        int u = cb->perm[r];
+        int cu = part->v2c[u + 1];
+        int first = cb->class_start[cu];
+
+        cb->diag.row_ptr[r] = pd;
+        cb->offdiag.row_ptr[r] = po;
+
+        for (int e = S.row_ptr[u]; e < S.row_ptr[u + 1]; e++) {
+            int v = S.col_idx[e];
+            if (part->v2c[v + 1] == cu) {
+                cb->diag.col_idx[pd] = cb->inv[v] - first;
+                cb->diag.values[pd++] = S.values[e];
+            } else {
+                cb->offdiag.col_idx[po] = cb->inv[v];
+                cb->offdiag.values[po++] = S.values[e];
+            }
+        }
+    }
+    cb->diag.row_ptr[n] = pd;
+    cb->offdiag.row_ptr[n] = po;
+
+    sparseSortRows(cb->diag);
+    sparseSortRows(cb->offdiag);
+
+    /* Views: consecutive rows of diag, local columns already */
+    for (int c = 0; c < count; c++) {
+        int first = cb->class_start[c];
+        int size = cb->class_start[c + 1] - first;
+        t_sparse_matrix *b = &cb->blocks[c];
+        b->rows = size;
+        b->cols = size;
+        b->row_ptr = cb->diag.row_ptr + first;
+        b->nnz = b->row_ptr[size] - b->row_ptr[0];
+        b->col_idx = cb->diag.col_idx;
+        b->values = cb->diag.values;
+    }
+
+    return 0;
+}
+
+/* Free class blocks (the views share diag's storage) */
+void classBlocksFree(t_class_blocks *cb) {
+    if (!cb) return;
+
+    free(cb->perm);
+    free(cb->inv);
+    free(cb->class_start);
+    free(cb->blocks);
+    sparseFree(&cb->diag);
+    sparseFree(&cb->offdiag);
+
+    cb->perm = NULL;
+    cb->inv = NULL;
+    cb->class_start = NULL;
+    cb->blocks = NULL;
+    cb->count = 0;
+    cb->n = 0;
+}
@@ -0,0 +1,122 @@
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+const char *PERF_COUNTER_NAMES[PERF_COUNTER_COUNT] = {
+    "cycles", "instructions", "llc_misses", "branch_misses"
+};
+
+#ifdef __linux__
+
+static const unsigned long long EVENT_CONFIG[PERF_COUNTER_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES
+};
+
+/* One counting (not sampling) event, user space only so that
+   perf_event_paranoid = 2 is enough; inherit follows new threads */
+static int openEvent(unsigned long long config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.inherit = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+int perfCountersOpen(t_perf_counters *pc) {
+    if (pc == NULL) return 0;
+
+    pc->opened = 0;
+    pc->error = 0;
+    for (int k = 0; k < PERF_COUNTER_COUNT; k++) {
+        pc->fd[k] = openEvent(EVENT_CONFIG[k]);
+        if (pc->fd[k] >= 0) pc->opened++;
+        else if (pc->error == 0) pc->error = errno;
+    }
+    return pc->opened;
+}
+
+void perfCountersRead(const t_perf_counters *pc, t_perf_sample *s) {
+    for (int k = 0; k < PERF_COUNTER_COUNT; k++) {
+        s->value[k] = -1;
+        s->enabled[k] = 0;
+        s->running[k] = 0;
+        if (pc == NULL || pc->fd[k] < 0) continue;
+
+        unsigned long long buf[3];   /* value, time enabled, time running */
+        if (read(pc->fd[k], buf, sizeof(buf)) != (ssize_t)sizeof(buf)) continue;
+
+        /* Scaling the totals here would mix the multiplexing ratio of the whole
+           run into every region: perfSampleDiff scales the differences instead */
+        s->value[k] = (long long)buf[0];
+        s->enabled[k] = (long long)buf[1];
+        s->running[k] = (long long)buf[2];
+    }
+}
+
+void perfCountersClose(t_perf_counters *pc) {
+    if (pc == NULL) return;
+    for (int k = 0; k < PERF_COUNTER_COUNT; k++) {
+        if (pc->fd[k] >= 0) close(pc->fd[k]);
+        pc->fd[k] = -1;
+    }
+    pc->opened = 0;
+}
+
+#else
+
+/* No perf_event_open: every counter is unavailable */
+int perfCountersOpen(t_perf_counters *pc) {
+    if (pc == NULL) return 0;
+    for (int k = 0; k < PERF_COUNTER_COUNT; k++) pc->fd[k] = -1;
+    pc->opened = 0;
+    pc->error = ENOSYS;
+    return 0;
+}
+
+void perfCountersRead(const t_perf_counters *pc, t_perf_sample *s) {
+    (void)pc;
+    for (int k = 0; k < PERF_COUNTER_COUNT; k++) {
+        s->value[k] = -1;
+        s->enabled[k] = 0;
+        s->running[k] = 0;
+    }
+}
+
+void perfCountersClose(t_perf_counters *pc) {
+    if (pc != NULL) pc->opened = 0;
+}
+
+#endif
+
+void perfSampleDiff(const t_perf_sample *end, const t_perf_sample *start, t_perf_sample *out) {
+    for (int k = 0; k < PERF_COUNTER_COUNT; k++) {
+        long long value = end->value[k] - start->value[k];
+        long long enabled = end->enabled[k] - start->enabled[k];
+        long long running = end->running[k] - start->running[k];
+
+        out->enabled[k] = enabled;
+        out->running[k] = running;
+        if (end->value[k] < 0 || start->value[k] < 0 || running <= 0) {
+            out->value[k] = -1;
+        } else if (running < enabled) {
+            out->value[k] = (long long)((double)value * (double)enabled / (double)running);
+        } else {
+            out->value[k] = value;
+        }
+    }
+}
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include "profile.h"
+
+int profile_active = 0;
+
+static const char *program_name = "";
+static const char *json_path = NULL;      /* NULL: table on stderr */
+static int reported = 0;
+
+static t_profile_stage stages[PROFILE_MAX_STAGES];
+static int stage_count = 0;
+
+/* Open stages, innermost last, with their start times */
+static int open_ids[PROFILE_MAX_DEPTH];
+static double open_start[PROFILE_MAX_DEPTH];
+static int open_depth = 0;
+
+static double start_time = 0.0;
+
+/* Monotonic wall clock in seconds */
+double profileNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Process high-water mark in kB, -1 if unknown */
+long profilePeakRssKb(void) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return -1;
+    return ru.ru_maxrss;
+}
+
+static void reportAtExit(void) {
+    profileReport();
+}
+
+/* MARKOV_PROFILE=1|stderr|<file.json>, overridden by --profile[=<file.json>] */
+void profileInit(int argc, char **argv, const char *program) {
+    const char *setting = getenv("MARKOV_PROFILE");
+    if (setting != NULL && (setting[0] == '\0' || strcmp(setting, "0") == 0)) setting = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--profile") == 0) setting = "stderr";
+        else if (strncmp(argv[i], "--profile=", 10) == 0) setting = argv[i] + 10;
+    }
+    if (setting == NULL) return;
+
+    program_name = program;
+    json_path = (strcmp(setting, "1") == 0 || strcmp(setting, "stderr") == 0) ? NULL : setting;
+    stage_count = 0;
+    open_depth = 0;
+    reported = 0;
+    start_time = profileNow();
+    profile_active = 1;
+    atexit(reportAtExit);
+}
+
+/* Stage record for name under the current stage, created on first use */
+int profileBegin(const char *name) {
+    if (!profile_active || open_depth >= PROFILE_MAX_DEPTH) return -1;
+
+    int parent = open_depth > 0 ? open_ids[open_depth - 1] : -1;
+    int id = -1;
+    for (int s = 0; s < stage_count; s++) {
+        if (stages[s].parent == parent && strcmp(stages[s].name, name) == 0) {
+            id = s;
+            break;
+        }
+    }
+    if (id < 0) {
+        if (stage_count >= PROFILE_MAX_STAGES) return -1;
+        id = stage_count++;
+        memset(&stages[id], 0, sizeof(t_profile_stage));
+        stages[id].name = name;
+        stages[id].parent = parent;
+        stages[id].depth = open_depth;
+    }
+
+    open_ids[open_depth] = id;
+    open_start[open_depth] = profileNow();
+    open_depth++;
+    return id;
+}
+
+/* Close stage id (and any stage left open inside it) */
+void profileEnd(int id) {
+    if (id < 0 || !profile_active) return;
+
+    double t = profileNow();
+    long rss = profilePeakRssKb();
+    while (open_depth > 0) {
+        open_depth--;
+        int s = open_ids[open_depth];
+        stages[s].calls++;
+        stages[s].seconds += t - open_start[open_depth];
+        stages[s].peak_rss_kb = rss;
+        if (s == id) break;
+    }
+}
+
+void profileEstimatedBytes(long long bytes) {
+    if (!profile_active || open_depth == 0) return;
+    t_profile_stage *s = &stages[open_ids[open_depth - 1]];
+    #pragma omp atomic
+    s->est_bytes += bytes;
+}
+
+void profileIterations(long long count) {
+    if (!profile_active || open_depth == 0) return;
+    t_profile_stage *s = &stages[open_ids[open_depth - 1]];
+    #pragma omp atomic
+    s->iterations += count;
+}
+
+/* Stage table on stderr */
+static void writeTable(FILE *f, double total, long rss) {
+    fprintf(f, "\n=== Profile: %s ===\n", program_name);
+    fprintf(f, "%-32s %7s %12s %14s %12s %12s\n",
+            "stage", "calls", "seconds", "est_bytes", "iterations", "peak_rss_kb");
+    for (int s = 0; s < stage_count; s++) {
+        const t_profile_stage *p = &stages[s];
+        fprintf(f, "%*s%-*s %7lld %12.6f %14lld %12lld %12ld\n",
+                2 * p->depth, "", 32 - 2 * p->depth, p->name,
+                p->calls, p->seconds, p->est_bytes, p->iterations, p->peak_rss_kb);
+    }
+    fprintf(f, "%-32s %7s %12.6f %14s %12s %12ld\n", "total", "", total, "", "", rss);
+}
+
+/* Same content as one JSON object */
+static void writeJson(FILE *f, double total, long rss) {
+    fprintf(f, "{\"program\": \"%s\", \"total_s\": %.6e, \"peak_rss_kb\": %ld, \"stages\": [",
+            program_name, total, rss);
+    for (int s = 0; s < stage_count; s++) {
+        const t_profile_stage *p = &stages[s];
+        fprintf(f, "%s\n  {\"name\": \"%s\", \"parent\": %d, \"depth\": %d, \"calls\": %lld, "
+                   "\"seconds\": %.6e, \"est_bytes\": %lld, \"iterations\": %lld, \"peak_rss_kb\": %ld}",
+                s > 0 ? "," : "", p->name, p->parent, p->depth, p->calls,
+                p->seconds, p->est_bytes, p->iterations, p->peak_rss_kb);
+    }
+    fprintf(f, "\n]}\n");
+}
+
+/* Close what is still open and write the report once */
+void profileReport(void) {
+    if (!profile_active || reported) return;
+    reported = 1;
+
+    if (open_depth > 0) profileEnd(open_ids[0]);
+
+    double total = profileNow() - start_time;
+    long rss = profilePeakRssKb();
+
+    if (json_path == NULL) {
+        writeTable(stderr, total, rss);
+        return;
+    }
+
+    FILE *f = fopen(json_path, "w");
+    if (f == NULL) {
+        perror(json_path);
+        writeTable(stderr, total, rss);
+        return;
+    }
+    writeJson(f, total, rss);
+    fclose(f);
+}
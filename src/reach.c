@@ -0,0 +1,333 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "reach.h"
+
+/* Growable int array */
+typedef struct {
+    int *data;
+    int size;
+    int capacity;
+} t_int_array;
+
+static int intArrayPush(t_int_array *a, int value) {
+    if (a->size == a->capacity) {
+        int cap = a->capacity > 0 ? 2 * a->capacity : 64;
+        int *data = realloc(a->data, cap * sizeof(int));
+        if (data == NULL) return 2;
+        a->data = data;
+        a->capacity = cap;
+    }
+    a->data[a->size++] = value;
+    return 0;
+}
+
+/* Postorder interval used while merging */
+typedef struct {
+    int lo, hi;
+} t_interval;
+
+static int compareIntervals(const void *a, const void *b) {
+    const t_interval *x = a, *y = b;
+    return (x->lo > y->lo) - (x->lo < y->lo);
+}
+
+/* Class DAG in CSR form: successors of c are succ[ptr[c] .. ptr[c + 1]).
+   Each class scans its own states once; stamp[] removes repeated links. */
+static int buildClassDag(const AdjCsr *g, const Partition *part, int **ptr, t_int_array *succ) {
+    int count = part->count;
+    *ptr = malloc((count + 1) * sizeof(int));
+    int *stamp = calloc(count, sizeof(int));
+    if (*ptr == NULL || stamp == NULL) {
+        free(stamp);
+        return 2;
+    }
+
+    for (int c = 0; c < count; c++) {
+        (*ptr)[c] = succ->size;
+        const Class *cl = &part->classes[c];
+
+        for (int k = 0; k < cl->size; k++) {
+            int u = cl->vertices[k] - 1;
+            for (int e = g->row_ptr[u]; e < g->row_ptr[u + 1]; e++) {
+                int d = part->v2c[g->v[e] + 1];
+                if (d < 0 || d == c || stamp[d] == c + 1) continue;
+                stamp[d] = c + 1;
+                if (intArrayPush(succ, d) != 0) {
+                    free(stamp);
+                    return 2;
+                }
+            }
+        }
+    }
+    (*ptr)[count] = succ->size;
+
+    free(stamp);
+    return 0;
+}
+
+/* Kahn's algorithm; returns the number of classes ordered (count for a DAG) */
+static int topologicalOrder(int count, const int *ptr, const int *succ, int *order) {
+    int *indeg = calloc(count, sizeof(int));
+    if (indeg == NULL) return -1;
+
+    for (int e = 0; e < ptr[count]; e++) indeg[succ[e]]++;
+
+    int head = 0, tail = 0;
+    for (int c = 0; c < count; c++) {
+        if (indeg[c] == 0) order[tail++] = c;
+    }
+    while (head < tail) {
+        int c = order[head++];
+        for (int e = ptr[c]; e < ptr[c + 1]; e++) {
+            if (--indeg[succ[e]] == 0) order[tail++] = succ[e];
+        }
+    }
+
+    free(indeg);
+    return tail;
+}
+
+/* Transitive closure, sinks first: row(c) = {c} + rows of its successors */
+static int buildBitset(t_reach_index *idx, const int *ptr, const int *succ, const int *order) {
+    int count = idx->count;
+    idx->words = (count + 63) / 64;
+    idx->bits = calloc((size_t)count * idx->words, sizeof(unsigned long long));
+    if (idx->bits == NULL) return 2;
+
+    for (int t = count - 1; t >= 0; t--) {
+        int c = order[t];
+        unsigned long long *row = idx->bits + (size_t)c * idx->words;
+        row[c / 64] |= 1ULL << (c % 64);
+
+        for (int e = ptr[c]; e < ptr[c + 1]; e++) {
+            const unsigned long long *other = idx->bits + (size_t)succ[e] * idx->words;
+            for (int w = 0; w < idx->words; w++) row[w] |= other[w];
+        }
+    }
+
+    return 0;
+}
+
+/* Interval labeling (Agrawal, Borgida, Jagadish): postorder numbers of a
+   spanning forest, then each class keeps the merged intervals of everything it
+   reaches. A class reaches d iff post[d] lies in one of its intervals. */
+static int buildIntervals(t_reach_index *idx, const int *ptr, const int *succ, const int *order) {
+    int count = idx->count;
+    int *low = malloc(count * sizeof(int));
+    int *next = malloc(count * sizeof(int));
+    int *stack = malloc(count * sizeof(int));
+    idx->post = malloc(count * sizeof(int));
+    idx->iv_start = malloc(count * sizeof(int));
+    idx->iv_count = malloc(count * sizeof(int));
+    if (!low || !next || !stack || !idx->post || !idx->iv_start || !idx->iv_count) {
+        free(low);
+        free(next);
+        free(stack);
+        return 2;
+    }
+
+    /* Spanning forest by iterative DFS, roots taken in topological order */
+    for (int c = 0; c < count; c++) idx->post[c] = -1;
+    for (int c = 0; c < count; c++) next[c] = -1;
+
+    int counter = 0;
+    for (int t = 0; t < count; t++) {
+        int root = order[t];
+        if (next[root] >= 0) continue;
+
+        int top = 0;
+        stack[top++] = root;
+        next[root] = ptr[root];
+        low[root] = counter;
+
+        while (top > 0) {
+            int c = stack[top - 1];
+            if (next[c] < ptr[c + 1]) {
+                int d = succ[next[c]++];
+                if (next[d] < 0) {
+                    next[d] = ptr[d];
+                    low[d] = counter;
+                    stack[top++] = d;
+                }
+            } else {
+                idx->post[c] = counter++;
+                top--;
+            }
+        }
+    }
+
+    /* Merge interval lists, sinks first */
+    t_int_array lo = {NULL, 0, 0}, hi = {NULL, 0, 0};
+    t_interval *tmp = NULL;
+    int tmpCap = 0, rc = 0;
+
+    for (int t = count - 1; t >= 0 && rc == 0; t--) {
+        int c = order[t];
+
+        int need = 1;
+        for (int e = ptr[c]; e < ptr[c + 1]; e++) need += idx->iv_count[succ[e]];
+        if (need > tmpCap) {
+            t_interval *grown = realloc(tmp, need * sizeof(t_interval));
+            if (grown == NULL) {
+                rc = 2;
+                break;
+            }
+            tmp = grown;
+            tmpCap = need;
+        }
+
+        int m = 0;
+        tmp[m].lo = low[c];
+        tmp[m].hi = idx->post[c];
+        m++;
+        for (int e = ptr[c]; e < ptr[c + 1]; e++) {
+            int d = succ[e];
+            for (int i = 0; i < idx->iv_count[d]; i++) {
+                tmp[m].lo = lo.data[idx->iv_start[d] + i];
+                tmp[m].hi = hi.data[idx->iv_start[d] + i];
+                m++;
+            }
+        }
+
+        qsort(tmp, m, sizeof(t_interval), compareIntervals);
+
+        /* Postorder numbers are integers: [a, b] and [b + 1, c] merge too */
+        idx->iv_start[c] = lo.size;
+        int curLo = tmp[0].lo, curHi = tmp[0].hi;
+        for (int i = 1; i <= m && rc == 0; i++) {
+            if (i < m && tmp[i].lo <= curHi + 1) {
+                if (tmp[i].hi > curHi) curHi = tmp[i].hi;
+                continue;
+            }
+            rc |= intArrayPush(&lo, curLo);
+            rc |= intArrayPush(&hi, curHi);
+            if (i < m) {
+                curLo = tmp[i].lo;
+                curHi = tmp[i].hi;
+            }
+        }
+        idx->iv_count[c] = lo.size - idx->iv_start[c];
+    }
+
+    idx->iv_lo = lo.data;
+    idx->iv_hi = hi.data;
+    idx->iv_total = lo.size;
+
+    free(tmp);
+    free(low);
+    free(next);
+    free(stack);
+    return rc;
+}
+
+int reachIndexBuild(const AdjList *adj, const Partition *part, int force_mode, t_reach_index *idx) {
+    if (adj == NULL) return 1;
+
+    AdjCsr g;
+    if (adjToCsr(adj, &g) != 0) return 2;
+    int rc = reachIndexBuildCsr(&g, part, force_mode, idx);
+    adjCsrFree(&g);
+    return rc;
+}
+
+int reachIndexBuildCsr(const AdjCsr *g, const Partition *part, int force_mode, t_reach_index *idx) {
+    if (g == NULL || g->row_ptr == NULL || part == NULL || part->v2c == NULL ||
+        idx == NULL || part->count <= 0) {
+        return 1;
+    }
+
+    memset(idx, 0, sizeof(*idx));
+    idx->n = g->n;
+    idx->count = part->count;
+    if (force_mode >= 0) idx->mode = (t_reach_mode)force_mode;
+    else idx->mode = (part->count <= REACH_BITSET_MAX) ? REACH_BITSET : REACH_INTERVAL;
+
+    idx->v2c = malloc((g->n + 1) * sizeof(int));
+    int *order = malloc(part->count * sizeof(int));
+    int *ptr = NULL;
+    t_int_array succ = {NULL, 0, 0};
+
+    int rc = (idx->v2c == NULL || order == NULL) ? 2 : 0;
+    if (rc == 0) {
+        memcpy(idx->v2c, part->v2c, (g->n + 1) * sizeof(int));
+        rc = buildClassDag(g, part, &ptr, &succ);
+    }
+    if (rc == 0 && topologicalOrder(part->count, ptr, succ.data, order) != part->count) {
+        rc = 3;   /* not a condensation: some classes are mutually reachable */
+    }
+    if (rc == 0) {
+        if (idx->mode == REACH_BITSET) rc = buildBitset(idx, ptr, succ.data, order);
+        else rc = buildIntervals(idx, ptr, succ.data, order);
+    }
+
+    free(order);
+    free(ptr);
+    free(succ.data);
+    if (rc != 0) reachIndexFree(idx);
+    return rc;
+}
+
+/* Class-level query */
+static int classReaches(const t_reach_index *idx, int c, int d) {
+    if (c == d) return 1;
+
+    if (idx->mode == REACH_BITSET) {
+        return (int)((idx->bits[(size_t)c * idx->words + d / 64] >> (d % 64)) & 1ULL);
+    }
+
+    /* Last interval starting at or before post[d] */
+    int p = idx->post[d];
+    const int *lo = idx->iv_lo + idx->iv_start[c];
+    const int *hi = idx->iv_hi + idx->iv_start[c];
+    int a = 0, b = idx->iv_count[c] - 1, found = -1;
+    while (a <= b) {
+        int mid = (a + b) / 2;
+        if (lo[mid] <= p) {
+            found = mid;
+            a = mid + 1;
+        } else {
+            b = mid - 1;
+        }
+    }
+    return found >= 0 && hi[found] >= p;
+}
+
+int reachQuery(const t_reach_index *idx, int u, int v) {
+    if (idx == NULL || idx->v2c == NULL || u < 1 || v < 1 || u > idx->n || v > idx->n) {
+        return -1;
+    }
+
+    int c = idx->v2c[u], d = idx->v2c[v];
+    if (c < 0 || d < 0) return -1;
+    return classReaches(idx, c, d);
+}
+
+void reachQueryBatch(const t_reach_index *idx, const int *from, const int *to,
+                     int count, signed char *out) {
+    if (from == NULL || to == NULL || out == NULL) return;
+
+    /* The index is read-only: queries are independent */
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < count; i++) {
+        out[i] = (signed char)reachQuery(idx, from[i], to[i]);
+    }
+}
+
+long reachIndexSize(const t_reach_index *idx) {
+    if (idx == NULL) return 0;
+    if (idx->mode == REACH_BITSET) return (long)idx->count * idx->words * 8;
+    return (long)idx->iv_total * 2 * sizeof(int) + (long)idx->count * 3 * sizeof(int);
+}
+
+void reachIndexFree(t_reach_index *idx) {
+    if (idx == NULL) return;
+    free(idx->v2c);
+    free(idx->bits);
+    free(idx->post);
+    free(idx->iv_start);
+    free(idx->iv_count);
+    free(idx->iv_lo);
+    free(idx->iv_hi);
+    memset(idx, 0, sizeof(*idx));
+}
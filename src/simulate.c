@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "simulate.h"
+
+/* ---------- Counter-based generator ---------- */
+
+/* SplitMix64 finalizer: a bijective 64-bit mix */
+static unsigned long long mix64(unsigned long long x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/* Stream of one walk: the k-th number only depends on (key, k) */
+typedef struct {
+    unsigned long long key;
+    unsigned long long counter;
+} t_walk_rng;
+
+static t_walk_rng walkRng(unsigned long long seed, long walk) {
+    t_walk_rng r = {mix64(seed ^ mix64((unsigned long long)walk)), 0};
+    return r;
+}
+
+/* Uniform double in [0, 1) with 53 random bits */
+static double walkUniform(t_walk_rng *r) {
+    unsigned long long x = mix64(r->key + 0x632BE59BD9B4E019ULL * ++r->counter);
+    return (double)(x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/* ---------- Alias tables ---------- */
+
+int aliasChainBuild(const AdjList *adj, t_alias_chain *ch) {
+    if (adj == NULL || ch == NULL || adj->n <= 0) {
+        return 1;
+    }
+
+    int n = adj->n;
+    memset(ch, 0, sizeof(*ch));
+    ch->n = n;
+    ch->row_ptr = malloc((n + 1) * sizeof(int));
+    if (ch->row_ptr == NULL) {
+        return 2;
+    }
+
+    ch->row_ptr[0] = 0;
+    for (int u = 0; u < n; u++) {
+        int d = 0;
+        for (EdgeCell *e = adj->L[u].head; e != NULL; e = e->next) {
+            if (e->v >= 0 && e->v < n && e->p > 0.0f) d++;
+        }
+        ch->row_ptr[u + 1] = ch->row_ptr[u] + d;
+    }
+
+    int m = ch->row_ptr[n];
+    ch->target = malloc((m > 0 ? m : 1) * sizeof(int));
+    ch->alias = malloc((m > 0 ? m : 1) * sizeof(int));
+    ch->prob = malloc((m > 0 ? m : 1) * sizeof(double));
+    if (!ch->target || !ch->alias || !ch->prob) {
+        aliasChainFree(ch);
+        return 2;
+    }
+
+    int failed = 0;
+
+    /* Vose's method, one row at a time; rows are independent */
+    #pragma omp parallel reduction(+:failed)
+    {
+        int cap = 0;
+        int *work = NULL;   /* small / large stacks, 2 * degree entries */
+
+        #pragma omp for schedule(dynamic, 1024)
+        for (int u = 0; u < n; u++) {
+            int first = ch->row_ptr[u];
+            int d = ch->row_ptr[u + 1] - first;
+            if (d == 0 || failed) continue;
+
+            if (2 * d > cap) {
+                int *grown = realloc(work, 2 * d * sizeof(int));
+                if (grown == NULL) {
+                    failed++;
+                    continue;
+                }
+                work = grown;
+                cap = 2 * d;
+            }
+
+            double sum = 0.0;
+            int k = 0;
+            for (EdgeCell *e = adj->L[u].head; e != NULL; e = e->next) {
+                if (e->v < 0 || e->v >= n || e->p <= 0.0f) continue;
+                ch->target[first + k] = e->v;
+                ch->prob[first + k] = e->p;
+                sum += e->p;
+                k++;
+            }
+
+            /* Scaled weights d * p / sum: below 1 goes to small, the rest to large */
+            int *small = work, *large = work + d;
+            int ns = 0, nl = 0;
+            for (k = 0; k < d; k++) {
+                double w = ch->prob[first + k] * d / sum;
+                ch->prob[first + k] = w;
+                if (w < 1.0) small[ns++] = k;
+                else large[nl++] = k;
+            }
+
+            while (ns > 0 && nl > 0) {
+                int s = small[--ns], l = large[nl - 1];
+                ch->alias[first + s] = ch->target[first + l];
+                ch->prob[first + l] -= 1.0 - ch->prob[first + s];
+                if (ch->prob[first + l] < 1.0) {
+                    nl--;
+                    small[ns++] = l;
+                }
+            }
+
+            /* Leftovers are 1 up to rounding */
+            while (nl > 0) {
+                int l = large[--nl];
+                ch->prob[first + l] = 1.0;
+                ch->alias[first + l] = ch->target[first + l];
+            }
+            while (ns > 0) {
+                int s = small[--ns];
+                ch->prob[first + s] = 1.0;
+                ch->alias[first + s] = ch->target[first + s];
+            }
+        }
+
+        free(work);
+    }
+
+    if (failed) {
+        aliasChainFree(ch);
+        return 2;
+    }
+    return 0;
+}
+
+void aliasChainFree(t_alias_chain *ch) {
+    if (ch == NULL) return;
+    free(ch->row_ptr);
+    free(ch->target);
+    free(ch->alias);
+    free(ch->prob);
+    memset(ch, 0, sizeof(*ch));
+}
+
+/* One transition from u: pick an entry uniformly, accept it or take its alias */
+static int aliasStep(const t_alias_chain *ch, int u, t_walk_rng *r) {
+    int first = ch->row_ptr[u];
+    int d = ch->row_ptr[u + 1] - first;
+    if (d == 0) return u;
+
+    double x = walkUniform(r) * d;
+    int k = (int)x;
+    if (k >= d) k = d - 1;
+    return (x - k < ch->prob[first + k]) ? ch->target[first + k] : ch->alias[first + k];
+}
+
+/* ---------- Simulation ---------- */
+
+int simulateWalks(const t_alias_chain *ch, const t_simulation_options *opt,
+                  t_simulation_result *res) {
+    if (ch == NULL || opt == NULL || res == NULL || ch->n <= 0 ||
+        opt->walks <= 0 || opt->steps < 0 || opt->start < 0 || opt->start > ch->n) {
+        return 1;
+    }
+
+    int n = ch->n;
+    res->n = n;
+    res->total = 0;
+    res->visits = calloc(n, sizeof(unsigned long long));
+    res->final = calloc(n, sizeof(unsigned long long));
+    if (!res->visits || !res->final) {
+        simulationResultFree(res);
+        return 2;
+    }
+
+    int failed = 0;
+
+    /* Counts are integers: merging the per-thread arrays in any order gives
+       the same totals, so the result does not depend on the thread count */
+    #pragma omp parallel reduction(+:failed)
+    {
+        unsigned long long *visits = calloc(n, sizeof(unsigned long long));
+        unsigned long long *final = calloc(n, sizeof(unsigned long long));
+
+        if (!visits || !final) failed++;
+
+        /* Every thread must reach the worksharing loop, even after a failed allocation */
+        #pragma omp for schedule(static)
+        for (long w = 0; w < opt->walks; w++) {
+            if (!visits || !final) continue;
+
+            t_walk_rng r = walkRng(opt->seed, w);
+            int u = (opt->start > 0) ? opt->start - 1 : (int)(walkUniform(&r) * n);
+            if (u >= n) u = n - 1;
+
+            if (opt->burn_in == 0) visits[u]++;
+            for (int s = 1; s <= opt->steps; s++) {
+                u = aliasStep(ch, u, &r);
+                if (s >= opt->burn_in) visits[u]++;
+            }
+            final[u]++;
+        }
+
+        if (visits && final) {
+            #pragma omp critical
+            {
+                for (int v = 0; v < n; v++) {
+                    res->visits[v] += visits[v];
+                    res->final[v] += final[v];
+                }
+            }
+        }
+
+        free(visits);
+        free(final);
+    }
+
+    if (failed) {
+        simulationResultFree(res);
+        return 2;
+    }
+
+    for (int v = 0; v < n; v++) res->total += res->visits[v];
+    return 0;
+}
+
+void simulationResultFree(t_simulation_result *res) {
+    if (res == NULL) return;
+    free(res->visits);
+    free(res->final);
+    res->visits = NULL;
+    res->final = NULL;
+    res->n = 0;
+    res->total = 0;
+}
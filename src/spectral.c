@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "spectral.h"
+
+/* Number of steps averaged by the |lambda2| estimator */
+#define SPECTRAL_WINDOW 10
+
+/* Ratios above this value are treated as |lambda2| = rho (no mixing) */
+#define SPECTRAL_UNIT 0.99999
+
+/* L1 norm */
+static double norm1(const double *x, int n) {
+    double s = 0.0;
+    for (int i = 0; i < n; i++) s += fabs(x[i]);
+    return s;
+}
+
+/* Scale x so that its L1 norm is 1, return the previous norm */
+static double normalize(double *x, int n) {
+    double s = norm1(x, n);
+    if (s > 0.0) {
+        for (int i = 0; i < n; i++) x[i] /= s;
+    }
+    return s;
+}
+
+/* Dot product */
+static double dot(const double *x, const double *y, int n) {
+    double s = 0.0;
+    for (int i = 0; i < n; i++) s += x[i] * y[i];
+    return s;
+}
+
+/* Dominant left (u) or right (v) Perron vector by power iteration on (M + I) / 2.
+   The shift keeps the iteration convergent on periodic blocks. Returns rho. */
+static double perronVector(t_matrix_ref M, int left, double *x, double *y,
+                           int max_iter, double tol, int *iter, int *converged) {
+    int n = matrixRefSize(M);
+    double r = 0.0;
+
+    for (int i = 0; i < n; i++) x[i] = 1.0 / n;
+
+    *converged = 0;
+    for (int k = 0; k < max_iter; k++) {
+        if (left) matrixRefVectorMultiply(x, M, y);
+        else      matrixRefMatrixVectorMultiply(M, x, y);
+        (*iter)++;
+
+        for (int i = 0; i < n; i++) y[i] = 0.5 * (y[i] + x[i]);
+        r = normalize(y, n);
+
+        double change = 0.0;
+        for (int i = 0; i < n; i++) change += fabs(y[i] - x[i]);
+        for (int i = 0; i < n; i++) x[i] = y[i];
+
+        if (change < tol) {
+            *converged = 1;
+            break;
+        }
+    }
+
+    /* (rho + 1) / 2 is the dominant eigenvalue of the shifted matrix */
+    double rho = 2.0 * r - 1.0;
+    return rho > 0.0 ? rho : 0.0;
+}
+
+/* Estimate rho and |lambda2|: Perron vectors first, then power iteration on
+   M restricted to the complement of the dominant eigenvector (Hotelling deflation) */
+static int estimateSpectrum(t_matrix_ref M, int max_iter, double tol, t_spectral_estimate *est) {
+    int n = matrixRefSize(M);
+    if (n <= 0 || est == NULL || max_iter <= 0) {
+        return 1;
+    }
+
+    est->rho = 0.0;
+    est->lambda2 = 0.0;
+    est->relaxation = 0.0;
+    est->iterations = 0;
+    est->converged = 1;
+
+    double *buf = malloc(4 * (size_t)n * sizeof(double));
+    if (!buf) {
+        perror("malloc");
+        return 2;
+    }
+    double *u = buf, *v = buf + n, *x = buf + 2 * n, *y = buf + 3 * n;
+
+    int convLeft = 0, convRight = 0;
+    double rho = perronVector(M, 1, u, y, max_iter, tol, &est->iterations, &convLeft);
+    perronVector(M, 0, v, y, max_iter, tol, &est->iterations, &convRight);
+    est->rho = rho;
+
+    double uv = dot(u, v, n);
+    if (rho <= 0.0 || uv <= 0.0 || n == 1) {
+        /* Nilpotent block or single state: nothing below the dominant eigenvalue */
+        est->converged = convLeft && convRight;
+        est->relaxation = (rho > 0.0) ? 1.0 : 0.0;
+        free(buf);
+        return 0;
+    }
+
+    /* Deterministic, non-symmetric start vector */
+    unsigned int seed = 12345u;
+    for (int i = 0; i < n; i++) {
+        seed = seed * 1103515245u + 12345u;
+        x[i] = (double)(seed >> 16) / 65536.0 - 0.5;
+    }
+
+    double logs[SPECTRAL_WINDOW];
+    double prevEstimate = -1.0, current = 0.0;
+    int convDeflated = 0;
+
+    for (int k = 0; k < max_iter; k++) {
+        double c = dot(x, v, n) / uv;
+        for (int i = 0; i < n; i++) x[i] -= c * u[i];
+        if (normalize(x, n) < 1e-300) {
+            current = 0.0;
+            convDeflated = 1;
+            break;
+        }
+
+        matrixRefVectorMultiply(x, M, y);
+        est->iterations++;
+
+        c = dot(y, v, n) / uv;
+        for (int i = 0; i < n; i++) y[i] -= c * u[i];
+
+        double g = norm1(y, n);
+        if (g < 1e-300) {
+            current = 0.0;
+            convDeflated = 1;
+            break;
+        }
+        logs[k % SPECTRAL_WINDOW] = log(g);
+
+        for (int i = 0; i < n; i++) x[i] = y[i];
+
+        /* Geometric mean of the growth factor over the last window:
+           stable even when lambda2 is negative or complex */
+        if (k + 1 >= SPECTRAL_WINDOW) {
+            double s = 0.0;
+            for (int w = 0; w < SPECTRAL_WINDOW; w++) s += logs[w];
+            current = exp(s / SPECTRAL_WINDOW);
+
+            if ((k + 1) % SPECTRAL_WINDOW == 0) {
+                if (prevEstimate >= 0.0 && fabs(current - prevEstimate) < tol) {
+                    convDeflated = 1;
+                    break;
+                }
+                prevEstimate = current;
+            }
+        }
+    }
+
+    if (current > rho) current = rho;
+    est->lambda2 = current;
+    est->converged = convLeft && convRight && convDeflated;
+
+    double ratio = current / rho;
+    est->relaxation = (ratio >= SPECTRAL_UNIT) ? INFINITY : 1.0 / (1.0 - ratio);
+
+    free(buf);
+    return 0;
+}
+
+/* Dense matrix */
+int spectralEstimate(t_matrix M, int max_iter, double tol, t_spectral_estimate *est) {
+    t_matrix_ref ref = {&M, NULL};
+    return estimateSpectrum(ref, max_iter, tol, est);
+}
+
+/* Sparse matrix: O(nnz) per product */
+int spectralEstimateSparse(t_sparse_matrix M, int max_iter, double tol, t_spectral_estimate *est) {
+    if (M.rows != M.cols) return 1;
+    t_matrix_ref ref = {NULL, &M};
+    return estimateSpectrum(ref, max_iter, tol, est);
+}
+
+/* Steps n such that rate^n <= epsilon, where rate is rho for a transient
+   block (M^n decays to 0) and |lambda2| for a stochastic one (M^n mixes) */
+long spectralStepsFor(const t_spectral_estimate *est, double epsilon) {
+    if (est == NULL || epsilon <= 0.0) {
+        return -1;
+    }
+
+    double rate = (est->rho < SPECTRAL_UNIT) ? est->rho : est->lambda2 / est->rho;
+    if (rate >= SPECTRAL_UNIT) return -1;
+    if (rate <= 0.0 || epsilon >= 1.0) return 1;
+
+    double steps = ceil(log(epsilon) / log(rate));
+    return steps < 1.0 ? 1 : (long)steps;
+}
@@ -0,0 +1,302 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "stationary.h"
+
+/* Largest exponent reachable by repeated squaring without overflowing a long */
+#define STATIONARY_MAX_SQUARINGS 62
+
+/* Aitken extrapolation is attempted every AITKEN_PERIOD products */
+#define AITKEN_PERIOD 10
+
+/* Default settings */
+t_stationary_options stationaryDefaultOptions(void) {
+    t_stationary_options opt;
+    opt.method = STATIONARY_SQUARING;
+    opt.epsilon = 0.01;
+    opt.max_iter = 1000;
+    opt.sample_rows = 16;
+    opt.lazy = 0;
+    return opt;
+}
+
+/* Number of rows compared by the stopping test */
+static int sampleCount(int n, int sample_rows) {
+    if (sample_rows <= 0 || sample_rows >= n) return n;
+    return sample_rows;
+}
+
+/* Index of the i-th sampled row, evenly spread over [0, n) */
+static int sampleRow(int n, int count, int i) {
+    return (int)((long)i * n / count);
+}
+
+/* L1 change between A and B on the sampled rows, scaled to the full matrix */
+static double sampledDiff(t_matrix A, t_matrix B, int count) {
+    int n = A.size;
+    double diff = 0.0;
+
+    for (int s = 0; s < count; s++) {
+        int r = sampleRow(n, count, s);
+        for (int j = 0; j < n; j++) {
+            diff += fabs(A.data[r][j] - B.data[r][j]);
+        }
+    }
+    return diff * n / count;
+}
+
+/* Worst residual ||r * M - r||_1 over the sampled rows r of P */
+static double sampledResidual(t_matrix M, t_matrix P, int count) {
+    int n = M.size;
+    double worst = 0.0;
+
+    for (int s = 0; s < count; s++) {
+        int r = sampleRow(n, count, s);
+        double res = stationaryResidual(M, P.data[r]);
+        if (res > worst) worst = res;
+    }
+    return worst;
+}
+
+/* L1 norm of pi * M - pi on either storage (pi * M first rescaled to the mass
+   of pi when rescale is set, for rows that only nearly sum to 1) */
+static double refResidual(t_matrix_ref M, const double *pi, int rescale) {
+    int n = matrixRefSize(M);
+    if (n <= 0 || pi == NULL) return 0.0;
+
+    double *y = malloc(n * sizeof(double));
+    if (!y) {
+        perror("malloc");
+        return -1.0;
+    }
+
+    matrixRefVectorMultiply(pi, M, y);
+
+    if (rescale) {
+        double from = 0.0, to = 0.0;
+        for (int j = 0; j < n; j++) {
+            from += pi[j];
+            to += y[j];
+        }
+        for (int j = 0; to > 0.0 && j < n; j++) y[j] *= from / to;
+    }
+
+    double res = 0.0;
+    for (int j = 0; j < n; j++) {
+        res += fabs(y[j] - pi[j]);
+    }
+
+    free(y);
+    return res;
+}
+
+/* L1 norm of pi * M - pi */
+double stationaryResidual(t_matrix M, const double *pi) {
+    t_matrix_ref ref = {&M, NULL};
+    return refResidual(ref, pi, 0);
+}
+
+/* Same on a sparse matrix */
+double stationaryResidualSparse(t_sparse_matrix M, const double *pi) {
+    t_matrix_ref ref = {NULL, &M};
+    return refResidual(ref, pi, 0);
+}
+
+/* Compute M^n by plain powers or repeated squaring until the sampled rows stop moving */
+int stationaryLimitMatrix(t_matrix M, t_stationary_options opt, t_matrix result,
+                          t_stationary_info *info) {
+    int n = M.size;
+    if (n <= 0 || result.size != n) {
+        return 1;
+    }
+
+    int count = sampleCount(n, opt.sample_rows);
+    int squaring = (opt.method != STATIONARY_POWER);
+
+    t_matrix cur  = matrixCreate(n);
+    t_matrix next = matrixCreate(n);
+    matrixCopy(cur, M);
+
+    long exponent = 1;
+    int iter = 0;
+    double diff = INFINITY;
+
+    while (iter < opt.max_iter) {
+        if (squaring) {
+            if (iter >= STATIONARY_MAX_SQUARINGS) break;
+            matrixMultiply(cur, cur, next);   // M^(2e)
+            exponent *= 2;
+        } else {
+            matrixMultiply(cur, M, next);     // M^(e+1)
+            exponent++;
+        }
+        iter++;
+
+        diff = sampledDiff(next, cur, count);
+
+        t_matrix swap = cur;
+        cur = next;
+        next = swap;
+
+        if (diff <= opt.epsilon) break;
+    }
+
+    matrixCopy(result, cur);
+
+    double residual = sampledResidual(M, cur, count);
+
+    if (info) {
+        info->iterations = iter;
+        info->exponent = exponent;
+        info->diff = diff;
+        info->residual = residual;
+        info->converged = (diff <= opt.epsilon && residual <= opt.epsilon);
+    }
+
+    matrixFree(&cur);
+    matrixFree(&next);
+    return 0;
+}
+
+/* Component-wise Aitken delta-squared on three successive iterates, written to out.
+   The result keeps the mass of x2 so that substochastic (transient) blocks stay comparable. */
+static void aitkenExtrapolate(const double *x0, const double *x1, const double *x2,
+                              double *out, int n) {
+    double mass = 0.0, total = 0.0;
+
+    for (int j = 0; j < n; j++) {
+        double d1 = x2[j] - x1[j];
+        double den = x2[j] - 2.0 * x1[j] + x0[j];
+        double v = x2[j];
+        if (fabs(den) > 1e-15) {
+            v = x2[j] - d1 * d1 / den;
+        }
+        if (v < 0.0) v = 0.0;
+        out[j] = v;
+        mass += x2[j];
+        total += v;
+    }
+
+    if (total > 0.0) {
+        for (int j = 0; j < n; j++) out[j] *= mass / total;
+    }
+}
+
+/* Distribution iteration x_k = x_(k-1) * M, optionally extrapolated, from start
+   rescaled to mass 1 (from the uniform vector when start is NULL or has no mass) */
+static int vectorIteration(t_matrix_ref M, t_stationary_options opt, const double *start,
+                           double *pi, t_stationary_info *info) {
+    int n = matrixRefSize(M);
+
+    /* x0, x1, x2: the last three iterates (x2 is the current one), e: extrapolation */
+    double *buf = malloc(4 * (size_t)n * sizeof(double));
+    if (!buf) {
+        perror("malloc");
+        return 2;
+    }
+    double *x0 = buf, *x1 = buf + n, *x2 = buf + 2 * n, *e = buf + 3 * n;
+
+    double mass = 0.0;
+    for (int j = 0; start != NULL && j < n; j++) mass += start[j] > 0.0 ? start[j] : 0.0;
+    for (int j = 0; j < n; j++) {
+        x2[j] = mass > 0.0 ? (start[j] > 0.0 ? start[j] / mass : 0.0) : 1.0 / n;
+    }
+
+    int iter = 0, history = 1;
+    double diff = INFINITY;
+
+    /* A lazy step moves x by half of its residual */
+    double stop = opt.lazy ? 0.5 * opt.epsilon : opt.epsilon;
+
+    while (iter < opt.max_iter) {
+        double *oldest = x0;
+        x0 = x1;
+        x1 = x2;
+        x2 = oldest;
+
+        matrixRefVectorMultiply(x1, M, x2);
+        iter++;
+        history++;
+
+        if (opt.lazy) {
+            mass = 0.0;
+            for (int j = 0; j < n; j++) {
+                x2[j] = 0.5 * (x1[j] + x2[j]);
+                mass += x2[j];
+            }
+            for (int j = 0; mass > 0.0 && j < n; j++) x2[j] /= mass;
+        }
+
+        diff = 0.0;
+        for (int j = 0; j < n; j++) diff += fabs(x2[j] - x1[j]);
+        if (diff <= stop) break;
+
+        if (opt.method == STATIONARY_AITKEN && history >= AITKEN_PERIOD) {
+            aitkenExtrapolate(x0, x1, x2, e, n);
+            iter++;   // the acceptance test costs one product
+            if (refResidual(M, e, opt.lazy) < diff) {
+                double *t = x2;
+                x2 = e;
+                e = t;
+            }
+            history = 1;
+        }
+    }
+
+    for (int j = 0; j < n; j++) pi[j] = x2[j];
+    free(buf);
+
+    if (info) {
+        info->iterations = iter;
+        info->exponent = iter;
+        info->diff = diff;
+        info->residual = refResidual(M, pi, opt.lazy);
+        info->converged = (diff <= stop && info->residual <= opt.epsilon);
+    }
+    return 0;
+}
+
+/* Stationary vector: distribution iteration (optionally extrapolated) or a row of the limit matrix */
+int stationaryVector(t_matrix M, t_stationary_options opt, double *pi,
+                     t_stationary_info *info) {
+    int n = M.size;
+    if (n <= 0 || pi == NULL) {
+        return 1;
+    }
+
+    if (opt.method == STATIONARY_SQUARING) {
+        t_matrix limit = matrixCreate(n);
+        int rc = stationaryLimitMatrix(M, opt, limit, info);
+        if (rc == 0) {
+            for (int j = 0; j < n; j++) pi[j] = limit.data[0][j];
+            if (info) info->residual = stationaryResidual(M, pi);
+        }
+        matrixFree(&limit);
+        return rc;
+    }
+
+    t_matrix_ref ref = {&M, NULL};
+    return vectorIteration(ref, opt, NULL, pi, info);
+}
+
+/* Stationary vector of a sparse matrix: squaring would fill the matrix in,
+   so STATIONARY_SQUARING runs the extrapolated vector iteration instead */
+int stationaryVectorSparse(t_sparse_matrix M, t_stationary_options opt, double *pi,
+                           t_stationary_info *info) {
+    return stationaryVectorSparseFrom(M, opt, NULL, pi, info);
+}
+
+/* Warm start: after a small change of M, the previous vector is a few products away */
+int stationaryVectorSparseFrom(t_sparse_matrix M, t_stationary_options opt, const double *start,
+                               double *pi, t_stationary_info *info) {
+    if (M.rows <= 0 || M.rows != M.cols || pi == NULL) {
+        return 1;
+    }
+
+    if (opt.method == STATIONARY_SQUARING) {
+        opt.method = STATIONARY_AITKEN;
+    }
+
+    t_matrix_ref ref = {NULL, &M};
+    return vectorIteration(ref, opt, start, pi, info);
+}
@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "stationary_update.h"
+#include "tarjan.h"
+
+/* Helper : classes, blocks and closed flags of the current lists */
+static int buildClasses(t_stationary_state *st) {
+    st->part = partitionCreate(st->adj->n);
+    if (st->part.v2c == NULL) return 2;
+    if (tarjanRun(st->adj, &st->part) != 0) return 2;
+    if (classBlocksBuild(st->adj, &st->part, &st->blocks) != 0) return 2;
+
+    int count = st->part.count;
+    st->closed = malloc(count);
+    st->solved = calloc(count, 1);
+    if (!st->closed || !st->solved) return 2;
+
+    /* Closed: no row of the class has an entry outside it */
+    const int *off = st->blocks.offdiag.row_ptr;
+    for (int c = 0; c < count; c++) {
+        st->closed[c] = off[st->blocks.class_start[c]] == off[st->blocks.class_start[c + 1]];
+    }
+    return 0;
+}
+
+/* Helper : solve the listed classes in parallel, each from its part of from
+   (0-based states, may be NULL or be st->pi: classes never share a state) */
+static int solveClasses(t_stationary_state *st, const int *list, int count, const double *from,
+                        t_stationary_update_info *info) {
+    int iterations = 0, converged = 0, failed = 0;
+
+    #pragma omp parallel for reduction(+:iterations, converged, failed) schedule(dynamic, 1)
+    for (int t = 0; t < count; t++) {
+        int c = list[t];
+        int first = st->blocks.class_start[c];
+        int k = st->blocks.class_start[c + 1] - first;
+        const int *perm = st->blocks.perm + first;
+
+        double *x = malloc(2 * (size_t)k * sizeof(double));
+        if (!x) {
+            failed++;
+            continue;
+        }
+        double *y = x + k;
+        for (int i = 0; i < k; i++) x[i] = from != NULL ? from[perm[i]] : 0.0;
+
+        t_stationary_info si;
+        if (stationaryVectorSparseFrom(st->blocks.blocks[c], st->opt, x, y, &si) != 0) {
+            failed++;
+        } else {
+            iterations += si.iterations;
+            converged += si.converged;
+            st->solved[c] = (char)si.converged;
+            for (int i = 0; i < k; i++) st->pi[perm[i]] = si.converged ? y[i] : 0.0;
+        }
+        free(x);
+    }
+
+    info->solved += count;
+    info->converged += converged;
+    info->iterations += iterations;
+    return failed ? 2 : 0;
+}
+
+int stationaryStateInit(AdjList *adj, const double *pi0, t_stationary_options opt,
+                        t_stationary_state *st, t_stationary_update_info *info) {
+    t_stationary_update_info local;
+    if (info == NULL) info = &local;
+    memset(info, 0, sizeof(*info));
+
+    if (st == NULL) return 1;
+    memset(st, 0, sizeof(*st));
+    if (adj == NULL || adj->n <= 0) return 1;
+
+    st->adj = adj;
+    st->opt = opt;
+    st->pi = calloc(adj->n, sizeof(double));
+
+    int rc = st->pi != NULL ? buildClasses(st) : 2;
+    int *list = rc == 0 ? malloc(st->part.count * sizeof(int)) : NULL;
+    if (rc == 0 && list == NULL) rc = 2;
+
+    if (rc == 0) {
+        int m = 0;
+        for (int c = 0; c < st->part.count; c++) {
+            if (st->closed[c]) list[m++] = c;
+        }
+        rc = solveClasses(st, list, m, pi0, info);
+    }
+
+    free(list);
+    if (rc != 0) stationaryStateFree(st);
+    return rc;
+}
+
+/* Helper : entry (u, v) of the class blocks follows the lists (0-based states,
+   classes unchanged); repeated cells for v add up, as in adjToSparse */
+static void setBlockValue(t_stationary_state *st, int u, int v) {
+    const t_class_blocks *cb = &st->blocks;
+    int cu = st->part.v2c[u + 1], cv = st->part.v2c[v + 1];
+    t_sparse_matrix *M = cu == cv ? &st->blocks.diag : &st->blocks.offdiag;
+    int col = cu == cv ? cb->inv[v] - cb->class_start[cu] : cb->inv[v];
+
+    double p = 0.0;
+    for (const EdgeCell *e = st->adj->L[u].head; e != NULL; e = e->next) {
+        if (e->v == v) p += e->p;
+    }
+
+    int r = cb->inv[u];
+    int lo = M->row_ptr[r], hi = M->row_ptr[r + 1] - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (M->col_idx[mid] < col) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo <= hi && M->col_idx[lo] == col) M->values[lo] = p;
+}
+
+/* Helper : classes recomputed after an edge appeared or vanished. The vector of
+   a closed class with the same states as an untouched solved closed class is
+   kept; every other closed class is solved from the previous vectors. */
+static int rebuildClasses(t_stationary_state *st, const char *touched,
+                          t_stationary_update_info *info) {
+    t_stationary_state next;
+    memset(&next, 0, sizeof(next));
+    next.adj = st->adj;
+    next.opt = st->opt;
+    next.pi = calloc(st->adj->n, sizeof(double));
+
+    int rc = next.pi != NULL ? buildClasses(&next) : 2;
+    int *list = rc == 0 ? malloc(next.part.count * sizeof(int)) : NULL;
+    if (rc == 0 && list == NULL) rc = 2;
+    if (rc != 0) {
+        free(list);
+        stationaryStateFree(&next);
+        return rc;
+    }
+
+    int m = 0;
+    for (int c = 0; c < next.part.count; c++) {
+        if (!next.closed[c]) continue;
+
+        int first = next.blocks.class_start[c];
+        int k = next.blocks.class_start[c + 1] - first;
+        const int *perm = next.blocks.perm + first;
+        int oc = st->part.v2c[perm[0] + 1];
+
+        int same = st->part.classes[oc].size == k && !touched[oc]
+                   && st->closed[oc] && st->solved[oc];
+        for (int i = 1; same && i < k; i++) same = st->part.v2c[perm[i] + 1] == oc;
+
+        if (same) {
+            for (int i = 0; i < k; i++) next.pi[perm[i]] = st->pi[perm[i]];
+            next.solved[c] = 1;
+            info->kept++;
+        } else {
+            list[m++] = c;
+        }
+    }
+
+    rc = solveClasses(&next, list, m, st->pi, info);
+    free(list);
+
+    stationaryStateFree(st);
+    *st = next;
+    return rc;
+}
+
+int stationaryStateUpdate(t_stationary_state *st, const t_prob_update *updates, int count,
+                          t_stationary_update_info *info) {
+    t_stationary_update_info local;
+    if (info == NULL) info = &local;
+    memset(info, 0, sizeof(*info));
+
+    if (st == NULL || st->adj == NULL || st->pi == NULL || count < 0 || (count > 0 && updates == NULL)) {
+        return 1;
+    }
+
+    /* Every edit is checked before the first one is applied */
+    int n = st->adj->n;
+    for (int k = 0; k < count; k++) {
+        const t_prob_update *up = &updates[k];
+        if (up->u < 1 || up->u > n || up->v < 1 || up->v > n || !(up->p >= 0.0 && up->p <= 1.0)) {
+            return 1;
+        }
+    }
+
+    char *touched = calloc(st->part.count > 0 ? st->part.count : 1, 1);
+    if (!touched) return 2;
+
+    for (int k = 0; k < count; k++) {
+        int u = updates[k].u - 1, v = updates[k].v - 1;
+        float p = (float)updates[k].p;
+
+        EdgeCell **link = &st->adj->L[u].head;
+        while (*link != NULL && (*link)->v != v) link = &(*link)->next;
+
+        if (*link != NULL && p > 0.0f) {
+            (*link)->p = p;
+            if (!info->structural) setBlockValue(st, u, v);
+        } else if (*link != NULL) {
+            EdgeCell *dead = *link;
+            *link = dead->next;
+            free(dead);
+            info->structural = 1;
+        } else if (p > 0.0f) {
+            adjAdd(st->adj, u, v, p);
+            info->structural = 1;
+        } else {
+            continue;   /* absent edge set to 0: nothing changes */
+        }
+        touched[st->part.v2c[u + 1]] = 1;
+    }
+
+    int rc;
+    if (info->structural) {
+        rc = rebuildClasses(st, touched, info);
+    } else {
+        /* Same classes: only the touched closed ones move, each from its own vector */
+        int *list = malloc((st->part.count > 0 ? st->part.count : 1) * sizeof(int));
+        int m = 0;
+        rc = list != NULL ? 0 : 2;
+        for (int c = 0; list != NULL && c < st->part.count; c++) {
+            if (!st->closed[c]) continue;
+            if (touched[c]) list[m++] = c;
+            else info->kept++;
+        }
+        if (rc == 0) rc = solveClasses(st, list, m, st->pi, info);
+        free(list);
+    }
+
+    free(touched);
+    return rc;
+}
+
+void stationaryStateFree(t_stationary_state *st) {
+    if (st == NULL) return;
+
+    partitionFree(&st->part);
+    classBlocksFree(&st->blocks);
+    free(st->closed);
+    free(st->solved);
+    free(st->pi);
+
+    st->closed = NULL;
+    st->solved = NULL;
+    st->pi = NULL;
+}
@@ -1,10 +1,10 @@
 #include <stdlib.h>
 #include "tarjan.h"
 
-/* Return the number of vertices in the adjacency list. */
-static int getVertexCount(const AdjList *adj)
+/* Return the number of vertices in the compact graph. */
+static int getVertexCount(const AdjCsr *g)
 {
-    return adj->n;
+    return g->n;
 }
 
 /* Initialize an integer stack. */
@@ -165,7 +165,7 @@ void tarjanMetaFree(TarjanMeta *meta) {
 
 /* INTERNAL DFS FUNCTION — TARJAN VISIT */
 /* Depth-first search implementing Tarjan's SCC algorithm (pseudo-code translated to C). */
-static void tarjanVisit(const AdjList *adj, int v, TarjanMeta *meta, Partition *partition)
+static void tarjanVisit(const AdjCsr *g, int v, TarjanMeta *meta, Partition *partition)
 {
     if (v < 1 || v > meta->vertexCount) {
         printf("[ERROR] tarjanVisit: invalid v = %d (allowed: 1..%d)\n",
@@ -182,28 +182,26 @@ static void tarjanVisit(const AdjList *adj, int v, TarjanMeta *meta, Partition *
     stackPush(meta->stack, v);
     tv->onStack = 1;
 
-    /* Compute list index */
+    /* Compute row index */
     int idx = v - 1;
 
-    if (idx < 0 || idx >= adj->n) {
-        printf("[ERROR] tarjanVisit: idx=%d out of range (adj->n=%d)\n",
-               idx, adj->n);
+    if (idx < 0 || idx >= g->n) {
+        printf("[ERROR] tarjanVisit: idx=%d out of range (g->n=%d)\n",
+               idx, g->n);
         return;
     }
 
-    EdgeCell *edge = adj->L[idx].head;
+    /* Scan neighbourhood, in list order */
+    for (int e = g->row_ptr[idx]; e < g->row_ptr[idx + 1]; e++) {
 
-    /* Scan neighbourhood */
-    while (edge != NULL) {
-
-        int w = edge->v;   // w is 0-based in adjacency list
+        int w = g->v[e];   // w is 0-based in the compact graph
 
         /* Convert 0-based storage to 1-based Tarjan vertices */
         int w_vertex = w + 1;
 
         if (w_vertex < 1 || w_vertex > meta->vertexCount) {
             printf("[ERROR] Invalid edge: %d -> %d (converted %d)  [vertexCount=%d]\n",
-                   v, edge->v, w_vertex, meta->vertexCount);
+                   v, w, w_vertex, meta->vertexCount);
             return;
         }
 
@@ -211,7 +209,7 @@ static void tarjanVisit(const AdjList *adj, int v, TarjanMeta *meta, Partition *
 
         if (tw->index == -1) {
             /* Unvisited → recursion */
-            tarjanVisit(adj, w_vertex, meta, partition);
+            tarjanVisit(g, w_vertex, meta, partition);
 
             if (tw->lowLink < tv->lowLink) {
                 tv->lowLink = tw->lowLink;
@@ -222,8 +220,6 @@ static void tarjanVisit(const AdjList *adj, int v, TarjanMeta *meta, Partition *
                 tv->lowLink = tw->index;
             }
         }
-
-        edge = edge->next;
     }
 
     /* If v is a root of SCC, pop stack until v to form this component. */
@@ -259,7 +255,23 @@ int tarjanRun(const AdjList *adj, Partition *partition)
         return 1;
     }
 
-    int n = getVertexCount(adj);
+    AdjCsr g;
+    if (adjToCsr(adj, &g) != 0) {
+        return 3;
+    }
+    int rc = tarjanRunCsr(&g, partition);
+    adjCsrFree(&g);
+    return rc;
+}
+
+/* Same on the compact form, which may alias a graph store. */
+int tarjanRunCsr(const AdjCsr *g, Partition *partition)
+{
+    if (g == NULL || g->row_ptr == NULL || partition == NULL) {
+        return 1;
+    }
+
+    int n = getVertexCount(g);
     if (n <= 0) {
         return 2;
     }
@@ -272,7 +284,7 @@ int tarjanRun(const AdjList *adj, Partition *partition)
 
     for (int v = 1; v <= n; v++) {
         if (meta.vertices[v].index == -1) {
-            tarjanVisit(adj, v, &meta, partition);
+            tarjanVisit(g, v, &meta, partition);
         }
     }
 
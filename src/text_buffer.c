@@ -0,0 +1,96 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "text_buffer.h"
+
+/* Initial capacity of a buffer */
+#define TEXT_BUFFER_MIN 256
+
+/* Initialize an empty buffer */
+void textBufferInit(t_text_buffer *b) {
+    if (b == NULL) return;
+    b->data = NULL;
+    b->len = 0;
+    b->cap = 0;
+}
+
+/* Free the buffer memory */
+void textBufferFree(t_text_buffer *b) {
+    if (b == NULL) return;
+    free(b->data);
+    b->data = NULL;
+    b->len = 0;
+    b->cap = 0;
+}
+
+/* Grow the capacity (doubling) so that extra more bytes fit */
+int textBufferReserve(t_text_buffer *b, size_t extra) {
+    if (b == NULL) return 1;
+
+    size_t need = b->len + extra + 1;   /* room for a terminating NUL */
+    if (need <= b->cap) return 0;
+
+    size_t cap = b->cap > 0 ? b->cap : TEXT_BUFFER_MIN;
+    while (cap < need) cap *= 2;
+
+    char *data = realloc(b->data, cap);
+    if (data == NULL) return 2;
+
+    b->data = data;
+    b->cap = cap;
+    return 0;
+}
+
+/* Append len raw bytes */
+int textBufferAppend(t_text_buffer *b, const char *s, size_t len) {
+    if (textBufferReserve(b, len) != 0) return 2;
+    memcpy(b->data + b->len, s, len);
+    b->len += len;
+    b->data[b->len] = '\0';
+    return 0;
+}
+
+/* Append printf-style formatted text */
+int textBufferPrintf(t_text_buffer *b, const char *fmt, ...) {
+    if (b == NULL || fmt == NULL) return 1;
+
+    va_list args;
+    va_start(args, fmt);
+    va_list copy;
+    va_copy(copy, args);
+    int needed = vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
+
+    if (needed < 0 || textBufferReserve(b, (size_t)needed) != 0) {
+        va_end(args);
+        return 2;
+    }
+
+    vsnprintf(b->data + b->len, (size_t)needed + 1, fmt, args);
+    va_end(args);
+    b->len += (size_t)needed;
+    return 0;
+}
+
+/* Append a decimal integer (digits built right to left) */
+int textBufferAppendInt(t_text_buffer *b, long long x) {
+    char tmp[24];
+    int pos = sizeof(tmp);
+    unsigned long long u = (x < 0) ? 0ULL - (unsigned long long)x : (unsigned long long)x;
+
+    do {
+        tmp[--pos] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u > 0);
+    if (x < 0) tmp[--pos] = '-';
+
+    return textBufferAppend(b, tmp + pos, sizeof(tmp) - pos);
+}
+
+/* Write everything to f, then empty the buffer (capacity is kept) */
+int textBufferFlush(t_text_buffer *b, FILE *f) {
+    if (b == NULL || f == NULL) return 1;
+    if (b->len > 0 && fwrite(b->data, 1, b->len, f) != b->len) return 2;
+    b->len = 0;
+    return 0;
+}
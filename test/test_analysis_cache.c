@@ -0,0 +1,169 @@
+/* Analysis cache: round trip, and every way a stale or damaged file is refused */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "adj_list.h"
+#include "partition.h"
+#include "tarjan.h"
+#include "hasse.h"
+#include "analysis_cache.h"
+#include "test_check.h"
+
+/* 1 <-> 2 closed, 3 -> 1 or 4, 4 -> 3 or 5, 5 absorbing: classes {1, 2}, {3, 4}, {5} */
+static AdjList *smallChain(float p34) {
+    AdjList *adj = adjCreate(5);
+    adjAdd(adj, 0, 1, 1.0f);
+    adjAdd(adj, 1, 0, 1.0f);
+    adjAdd(adj, 2, 0, 1.0f - p34);
+    adjAdd(adj, 2, 3, p34);
+    adjAdd(adj, 3, 2, 0.5f);
+    adjAdd(adj, 3, 4, 0.5f);
+    adjAdd(adj, 4, 4, 1.0f);
+    return adj;
+}
+
+/* Every section filled from the graph */
+static void fillCache(const AdjList *adj, t_analysis_cache *cache) {
+    analysisCacheInit(cache, adj);
+    cache->part = partitionCreate(adj->n);
+    cache->has_partition = 1;
+    CHECK(tarjanRun(adj, &cache->part) == 0);
+    cache->has_links = 1;
+    buildLinksBetweenClasses(adj, &cache->part, &cache->links);
+    removeTransitiveLinks(&cache->links);
+
+    cache->period = malloc(cache->part.count * sizeof(int));
+    for (int c = 0; c < cache->part.count; c++) cache->period[c] = c + 1;
+    cache->stationary = malloc(adj->n * sizeof(double));
+    for (int i = 0; i < adj->n; i++) cache->stationary[i] = 0.125 * i;
+
+    cache->text_count = 2;
+    cache->texts = calloc(2, sizeof(t_text_buffer));
+    textBufferAppend(&cache->texts[0], "first block\n", 12);
+    cache->settings = analysisSettingsHash("test settings");
+}
+
+static long fileSize(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+/* A refused load leaves an empty cache, still keyed on its graph */
+static void checkRefused(const AdjList *adj, const char *path) {
+    t_analysis_cache got;
+    analysisCacheInit(&got, adj);
+    uint64_t hash = got.hash;
+    CHECK(analysisCacheLoad(path, &got) == 1);
+    CHECK(!got.has_partition && !got.has_links);
+    CHECK(got.period == NULL && got.stationary == NULL && got.texts == NULL);
+    CHECK(got.hash == hash && got.n == adj->n);
+    analysisCacheFree(&got);
+}
+
+static void testRoundTrip(const AdjList *adj, const char *path) {
+    t_analysis_cache cache;
+    fillCache(adj, &cache);
+    CHECK(cache.part.count == 3 && cache.links.size == 2);
+    CHECK(analysisCacheSave(path, &cache) == 0);
+
+    t_analysis_cache got;
+    analysisCacheInit(&got, adj);
+    CHECK(analysisCacheLoad(path, &got) == 0);
+    CHECK(got.has_partition && got.part.count == cache.part.count);
+    for (int c = 0; c < got.part.count; c++) {
+        CHECK(got.part.classes[c].size == cache.part.classes[c].size);
+        CHECK(memcmp(got.part.classes[c].vertices, cache.part.classes[c].vertices,
+                     cache.part.classes[c].size * sizeof(int)) == 0);
+    }
+    CHECK(memcmp(got.part.v2c, cache.part.v2c, (adj->n + 1) * sizeof(int)) == 0);
+    CHECK(got.has_links && got.links.size == cache.links.size);
+    CHECK(memcmp(got.links.data, cache.links.data, cache.links.size * sizeof(t_link)) == 0);
+    CHECK(memcmp(got.period, cache.period, cache.part.count * sizeof(int)) == 0);
+    CHECK(memcmp(got.stationary, cache.stationary, adj->n * sizeof(double)) == 0);
+    CHECK(got.text_count == 2 && got.texts[0].len == 12 && got.texts[1].len == 0);
+    CHECK(memcmp(got.texts[0].data, "first block\n", 12) == 0);
+    CHECK(got.settings == cache.settings);
+
+    analysisCacheFree(&got);
+    analysisCacheFree(&cache);
+}
+
+/* One probability changed: another hash, the file is stale */
+static void testChangedGraph(const char *path) {
+    AdjList *other = smallChain(0.25f);
+    checkRefused(other, path);
+    adjFree(other);
+}
+
+/* Every proper prefix of the file is refused */
+static void testTruncated(const AdjList *adj, const char *path) {
+    long size = fileSize(path);
+    CHECK(size > 0);
+    for (long cut = size - 1; cut >= 0; cut -= (cut > 40 ? 7 : 1)) {
+        CHECK(truncate(path, cut) == 0);
+        checkRefused(adj, path);
+    }
+}
+
+/* State 2 twice and state 1 never: the classes do not cover 1..n */
+static void testBadPartition(const AdjList *adj, const char *path) {
+    t_analysis_cache cache;
+    fillCache(adj, &cache);
+    int c1 = cache.part.v2c[1], c2 = cache.part.v2c[2];
+    Class *cl = &cache.part.classes[c1];
+    for (int i = 0; i < cl->size; i++) {
+        if (cl->vertices[i] == 1) cl->vertices[i] = 2;
+    }
+    CHECK(c1 == c2);
+    CHECK(analysisCacheSave(path, &cache) == 0);
+    checkRefused(adj, path);
+    analysisCacheFree(&cache);
+}
+
+/* A link to class count (one past the last) */
+static void testBadLink(const AdjList *adj, const char *path) {
+    t_analysis_cache cache;
+    fillCache(adj, &cache);
+    addLink(&cache.links, 0, cache.part.count);
+    CHECK(analysisCacheSave(path, &cache) == 0);
+    checkRefused(adj, path);
+    analysisCacheFree(&cache);
+}
+
+/* The compact form hashes like the lists it was built from, and like its own lists */
+static void testCsrHash(const AdjList *adj) {
+    AdjCsr g;
+    CHECK(adjToCsr(adj, &g) == 0);
+    AdjList *back = adjFromCsr(&g);
+    CHECK(back != NULL);
+    CHECK(analysisGraphHashCsr(&g) == analysisGraphHash(back));
+    CHECK(analysisGraphHashCsr(&g) == analysisGraphHash(adj));
+    adjFree(back);
+    adjCsrFree(&g);
+}
+
+int main(void) {
+    char path[] = "/tmp/test_analysis_cache_XXXXXX";
+    int fd = mkstemp(path);
+    CHECK(fd >= 0);
+    if (fd < 0) return TEST_RESULT();
+    close(fd);
+
+    AdjList *adj = smallChain(0.5f);
+    testRoundTrip(adj, path);
+    testChangedGraph(path);
+    testTruncated(adj, path);
+    testBadPartition(adj, path);
+    testBadLink(adj, path);
+    testCsrHash(adj);
+
+    adjFree(adj);
+    unlink(path);
+    return TEST_RESULT();
+}
@@ -0,0 +1,31 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+/* Minimal checks shared by the unit tests: each failure is reported and counted,
+   the test returns TEST_RESULT() so that CTest sees a non-zero exit code */
+
+static int test_failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define CHECK_NEAR(actual, expected, tol) do { \
+    double a_ = (actual), e_ = (expected); \
+    if (!(fabs(a_ - e_) <= (tol))) { \
+        fprintf(stderr, "%s:%d: %s = %.12g, expected %.12g (tol %g)\n", \
+                __FILE__, __LINE__, #actual, a_, e_, (double)(tol)); \
+        test_failures++; \
+    } \
+} while (0)
+
+#define TEST_RESULT() (test_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
+
+#endif // TEST_CHECK_H
@@ -0,0 +1,132 @@
+/* Batched forecasts against repeated vector-matrix products, dense and sparse */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "adj_list.h"
+#include "matrix.h"
+#include "forecast.h"
+#include "test_check.h"
+#include "test_graphs.h"
+
+#define N 150
+#define K 11          /* more than one slice of starts on sparse storage */
+#define HORIZON_MAX 20
+
+/* Unit vectors, a uniform one, one that does not sum to 1 and an empty one */
+static double *makeStarts(int n, int k) {
+    double *starts = calloc((size_t)n * k, sizeof(double));
+    for (int s = 0; s < k - 3; s++) starts[(size_t)s * n + (s * 37) % n] = 1.0;
+    for (int i = 0; i < n; i++) starts[(size_t)(k - 3) * n + i] = 1.0 / n;
+    starts[(size_t)(k - 2) * n + 4] = 0.5;
+    starts[(size_t)(k - 2) * n + n - 1] = 0.25;
+    return starts;
+}
+
+/* Every start at every requested horizon, one x * M product per step */
+static void checkAgainstProducts(t_matrix_ref ref, const double *starts, const int *horizons,
+                                 int count, const t_forecast *f) {
+    int n = f->n;
+    double *x = malloc(n * sizeof(double));
+    double *y = malloc(n * sizeof(double));
+    double worst = 0.0;
+
+    for (int s = 0; s < f->k; s++) {
+        memcpy(x, starts + (size_t)s * n, n * sizeof(double));
+        for (int t = 0; t <= HORIZON_MAX; t++) {
+            for (int h = 0; h < count; h++) {
+                if (horizons[h] != t) continue;
+                const double *row = forecastRow(f, h, s);
+                if (t == 0) CHECK(memcmp(row, x, n * sizeof(double)) == 0);
+                for (int i = 0; i < n; i++) {
+                    double d = fabs(row[i] - x[i]);
+                    if (d > worst) worst = d;
+                }
+            }
+            if (ref.dense != NULL) vectorMatrixMultiply(x, *ref.dense, y);
+            else sparseVectorMultiply(x, *ref.sparse, y);
+            memcpy(x, y, n * sizeof(double));
+        }
+    }
+    /* Same sums in the same order: equal, up to a contracted multiply-add */
+    CHECK(worst <= 1e-15);
+
+    free(x);
+    free(y);
+}
+
+/* Same values whatever the thread count */
+static void checkThreads(t_matrix_ref ref, const double *starts, const int *horizons,
+                         int count, const t_forecast *f) {
+#ifdef _OPENMP
+    int threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    t_forecast again;
+    CHECK(forecastRun(ref, starts, f->k, horizons, count, &again) == 0);
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+    CHECK(memcmp(again.data, f->data, (size_t)count * f->k * f->n * sizeof(double)) == 0);
+    forecastFree(&again);
+}
+
+static void testStorage(t_matrix_ref ref, const double *starts) {
+    /* Any order, repeats allowed */
+    int horizons[5] = {7, 0, 3, 7, HORIZON_MAX};
+    t_forecast f;
+    CHECK(forecastRun(ref, starts, K, horizons, 5, &f) == 0);
+    CHECK(f.k == K && f.n == N && f.count == 5);
+    CHECK(memcmp(forecastRow(&f, 0, 2), forecastRow(&f, 3, 2), N * sizeof(double)) == 0);
+    for (int i = 0; i < N; i++) CHECK(forecastRow(&f, 4, K - 1)[i] == 0.0);
+
+    checkAgainstProducts(ref, starts, horizons, 5, &f);
+    checkThreads(ref, starts, horizons, 5, &f);
+
+    /* Unit starts by state number give the same rows as the vectors themselves */
+    int states[K - 3];
+    for (int s = 0; s < K - 3; s++) states[s] = (s * 37) % N;
+    t_forecast g;
+    CHECK(forecastFromStates(ref, states, K - 3, horizons, 5, &g) == 0);
+    for (int h = 0; h < 5; h++) {
+        for (int s = 0; s < K - 3; s++) {
+            CHECK(memcmp(forecastRow(&g, h, s), forecastRow(&f, h, s), N * sizeof(double)) == 0);
+        }
+    }
+    forecastFree(&g);
+    forecastFree(&f);
+}
+
+static void testBadArguments(t_matrix_ref ref, const double *starts) {
+    t_forecast f;
+    int negative[2] = {1, -1};
+    int one[1] = {1};
+    int outside[1] = {N};
+    CHECK(forecastRun(ref, starts, K, negative, 2, &f) == 1);
+    CHECK(forecastRun(ref, starts, 0, one, 1, &f) == 1);
+    CHECK(forecastRun(ref, NULL, K, one, 1, &f) == 1);
+    CHECK(forecastFromStates(ref, outside, 1, one, 1, &f) == 1);
+}
+
+int main(void) {
+    AdjList *adj = randomChain(N, 2526u);
+    t_matrix M = adjToMatrix(adj);
+    t_sparse_matrix S = adjToSparse(adj);
+    double *starts = makeStarts(N, K);
+
+    t_matrix_ref dense = {&M, NULL};
+    t_matrix_ref sparse = {NULL, &S};
+    testStorage(dense, starts);
+    testStorage(sparse, starts);
+    testBadArguments(sparse, starts);
+
+    free(starts);
+    sparseFree(&S);
+    matrixFree(&M);
+    adjFree(adj);
+    return TEST_RESULT();
+}
@@ -0,0 +1,192 @@
+/* Graph store: published views against the source graph, damaged stores refused at attach */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include "adj_list.h"
+#include "partition.h"
+#include "tarjan.h"
+#include "matrix.h"
+#include "graph_store.h"
+#include "test_check.h"
+
+/* Classes {1, 2, 3} (closed), {4, 5}, {6}; lists in no particular order */
+static AdjList *sixStates(void) {
+    AdjList *adj = adjCreate(6);
+    adjAdd(adj, 0, 1, 0.5f);
+    adjAdd(adj, 0, 2, 0.5f);
+    adjAdd(adj, 1, 2, 1.0f);
+    adjAdd(adj, 2, 0, 0.75f);
+    adjAdd(adj, 2, 2, 0.25f);
+    adjAdd(adj, 3, 4, 0.625f);
+    adjAdd(adj, 3, 0, 0.375f);
+    adjAdd(adj, 4, 3, 0.5f);
+    adjAdd(adj, 4, 5, 0.5f);
+    adjAdd(adj, 5, 1, 1.0f);
+    return adj;
+}
+
+static unsigned char *readAll(const char *path, long *size) {
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) return NULL;
+    fseek(f, 0, SEEK_END);
+    *size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char *data = malloc(*size);
+    if (data != NULL && fread(data, 1, *size, f) != (size_t)*size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+static void writeAll(const char *path, const unsigned char *data, long size) {
+    FILE *f = fopen(path, "wb");
+    CHECK(f != NULL);
+    if (f == NULL) return;
+    CHECK(fwrite(data, 1, size, f) == (size_t)size);
+    fclose(f);
+}
+
+/* Every view of the attached store gives back the source graph exactly */
+static void testViews(const AdjList *adj, const Partition *part, const char *path) {
+    t_graph_store gs;
+    CHECK(graphStoreIsName(path));
+    CHECK(graphStoreAttach(path, &gs) == 0);
+    if (gs.base == NULL) return;
+    CHECK(gs.n == adj->n && gs.class_count == part->count);
+
+    AdjCsr src, view = graphStoreCsr(&gs);
+    CHECK(adjToCsr(adj, &src) == 0);
+    CHECK(view.n == src.n && view.nnz == src.nnz);
+    CHECK(memcmp(view.row_ptr, src.row_ptr, (src.n + 1) * sizeof(int)) == 0);
+    CHECK(memcmp(view.v, src.v, src.nnz * sizeof(int)) == 0);
+    CHECK(memcmp(view.p, src.p, src.nnz * sizeof(float)) == 0);
+
+    t_sparse_matrix S = adjToSparse(adj), M = graphStoreMatrix(&gs);
+    CHECK(M.rows == S.rows && M.nnz == S.nnz);
+    CHECK(memcmp(M.row_ptr, S.row_ptr, (S.rows + 1) * sizeof(int)) == 0);
+    CHECK(memcmp(M.col_idx, S.col_idx, S.nnz * sizeof(int)) == 0);
+    CHECK(memcmp(M.values, S.values, S.nnz * sizeof(double)) == 0);
+
+    Partition stored;
+    CHECK(graphStorePartition(&gs, &stored) == 0);
+    CHECK(stored.count == part->count);
+    CHECK(memcmp(stored.v2c, part->v2c, (adj->n + 1) * sizeof(int)) == 0);
+    for (int c = 0; c < part->count; c++) {
+        CHECK(stored.classes[c].size == part->classes[c].size);
+        CHECK(memcmp(stored.classes[c].vertices, part->classes[c].vertices,
+                     part->classes[c].size * sizeof(int)) == 0);
+    }
+    graphStorePartitionRelease(&stored);
+
+    /* Lists rebuilt from the store, and the compact graph opened by name */
+    AdjList *back = graphStoreToAdj(&gs);
+    AdjCsr again;
+    CHECK(back != NULL && adjToCsr(back, &again) == 0);
+    CHECK(again.nnz == src.nnz && memcmp(again.v, src.v, src.nnz * sizeof(int)) == 0);
+    adjCsrFree(&again);
+    adjFree(back);
+
+    t_graph_store opened;
+    AdjCsr g;
+    CHECK(graphOpenCsr(path, &opened, &g) == 0);
+    CHECK(opened.base != NULL && g.nnz == src.nnz);
+    graphStoreDetach(&opened);
+
+    sparseFree(&S);
+    adjCsrFree(&src);
+    graphStoreDetach(&gs);
+    CHECK(gs.base == NULL);
+}
+
+/* Copy of the store with 4 bytes replaced at off: attach must refuse it */
+static void checkPatched(const unsigned char *data, long size, const char *path,
+                         size_t off, int32_t value) {
+    unsigned char *copy = malloc(size);
+    memcpy(copy, data, size);
+    memcpy(copy + off, &value, sizeof(value));
+    writeAll(path, copy, size);
+    free(copy);
+
+    t_graph_store gs;
+    CHECK(graphStoreAttach(path, &gs) == 1);
+    CHECK(gs.base == NULL);
+}
+
+static void testDamaged(const char *store, const char *path) {
+    long size = 0;
+    unsigned char *data = readAll(store, &size);
+    CHECK(data != NULL && size > (long)sizeof(t_graph_store_header));
+    if (data == NULL) return;
+    t_graph_store_header h;
+    memcpy(&h, data, sizeof(h));
+
+    /* The unchanged copy attaches: every refusal below is due to its patch */
+    t_graph_store gs;
+    writeAll(path, data, size);
+    CHECK(graphStoreAttach(path, &gs) == 0);
+    graphStoreDetach(&gs);
+
+    /* Header */
+    checkPatched(data, size, path, offsetof(t_graph_store_header, magic), 0x31534B4E);
+    checkPatched(data, size, path, offsetof(t_graph_store_header, version), GRAPH_STORE_VERSION + 1);
+    checkPatched(data, size, path, offsetof(t_graph_store_header, size), (int32_t)size + 8);
+    checkPatched(data, size, path, offsetof(t_graph_store_header, n), h.n + 1);
+    checkPatched(data, size, path, offsetof(t_graph_store_header, nnz), h.nnz + 1);
+    checkPatched(data, size, path, offsetof(t_graph_store_header, class_count), h.n + 1);
+
+    /* Offsets: past the end, misaligned, inside the header */
+    checkPatched(data, size, path, offsetof(t_graph_store_header, row_ptr), (int32_t)size);
+    checkPatched(data, size, path, offsetof(t_graph_store_header, col_idx), (int32_t)h.col_idx + 4);
+    checkPatched(data, size, path, offsetof(t_graph_store_header, adj_v), 8);
+    checkPatched(data, size, path, offsetof(t_graph_store_header, members), (int32_t)size - 8);
+
+    /* Arrays: a row going backwards, a target out of range, a column out of order,
+       a state listed twice in its class (and another one never) */
+    checkPatched(data, size, path, h.row_ptr + 2 * sizeof(int32_t), h.nnz);
+    checkPatched(data, size, path, h.adj_v, h.n);
+    checkPatched(data, size, path, h.col_idx, h.n - 1);
+    int32_t member;
+    memcpy(&member, data + h.members, sizeof(member));
+    checkPatched(data, size, path, h.members + sizeof(int32_t), member);
+    checkPatched(data, size, path, h.class_start + sizeof(int32_t), h.n + 5);
+
+    /* Cut short */
+    writeAll(path, data, size - 8);
+    CHECK(graphStoreAttach(path, &gs) == 1);
+
+    free(data);
+}
+
+int main(void) {
+    char store[] = "/tmp/test_graph_store_XXXXXX";
+    char damaged[] = "/tmp/test_graph_store_bad_XXXXXX";
+    int fd1 = mkstemp(store), fd2 = mkstemp(damaged);
+    CHECK(fd1 >= 0 && fd2 >= 0);
+    if (fd1 < 0 || fd2 < 0) return TEST_RESULT();
+    close(fd1);
+    close(fd2);
+
+    AdjList *adj = sixStates();
+    Partition part = partitionCreate(adj->n);
+    CHECK(tarjanRun(adj, &part) == 0);
+    CHECK(part.count == 3);
+
+    CHECK(graphStorePublish(store, adj, &part) == 0);
+    testViews(adj, &part, store);
+    testDamaged(store, damaged);
+
+    /* A list with the same target twice cannot be stored in list order */
+    adjAdd(adj, 5, 1, 0.0f);
+    CHECK(graphStorePublish(damaged, adj, NULL) != 0);
+
+    partitionFree(&part);
+    adjFree(adj);
+    unlink(store);
+    unlink(damaged);
+    return TEST_RESULT();
+}
@@ -0,0 +1,22 @@
+#ifndef TEST_GRAPHS_H
+#define TEST_GRAPHS_H
+
+#include "adj_list.h"
+
+/* Graphs shared by the unit tests */
+
+/* Deterministic random chain: 1, 2 or 4 edges per state (exact float rows) */
+static AdjList *randomChain(int n, unsigned int seed) {
+    AdjList *adj = adjCreate(n);
+    for (int u = 0; u < n; u++) {
+        seed = seed * 1103515245u + 12345u;
+        int deg = 1 << ((seed >> 16) % 3);
+        for (int d = 0; d < deg; d++) {
+            seed = seed * 1103515245u + 12345u;
+            adjAdd(adj, u, (int)((seed >> 16) % n), 1.0f / deg);
+        }
+    }
+    return adj;
+}
+
+#endif // TEST_GRAPHS_H
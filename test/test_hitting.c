@@ -0,0 +1,121 @@
+/* Hitting and mean first passage times against values computed by hand */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "adj_list.h"
+#include "partition.h"
+#include "hitting.h"
+#include "test_check.h"
+
+/* 1 -> 2, 2 -> 1 or 3 (1/2 each), 3 absorbing, 4 -> 4 or 3 (1/2 each), 5 absorbing.
+   Target {3}: h2 = 1 + h1 / 2 and h1 = 1 + h2 give h1 = 4, h2 = 3; h4 = 2.
+   With 2 -> 5 added (and 2 -> 1 lowered) state 1 may miss 3: infinite. */
+static void testHittingTimes(void) {
+    AdjList *adj = adjCreate(5);
+    adjAdd(adj, 0, 1, 1.0f);
+    adjAdd(adj, 1, 0, 0.5f);
+    adjAdd(adj, 1, 2, 0.5f);
+    adjAdd(adj, 2, 2, 1.0f);
+    adjAdd(adj, 3, 3, 0.5f);
+    adjAdd(adj, 3, 2, 0.5f);
+    adjAdd(adj, 4, 4, 1.0f);
+
+    int target[5] = {0, 0, 1, 0, 0};
+    double h[5];
+    CHECK(hittingTimes(adj, target, h) == 0);
+    CHECK_NEAR(h[0], 4.0, 1e-12);
+    CHECK_NEAR(h[1], 3.0, 1e-12);
+    CHECK(h[2] == 0.0);
+    CHECK_NEAR(h[3], 2.0, 1e-12);
+    CHECK(isinf(h[4]));
+    adjFree(adj);
+
+    adj = adjCreate(3);
+    adjAdd(adj, 0, 1, 1.0f);
+    adjAdd(adj, 1, 0, 0.25f);
+    adjAdd(adj, 1, 2, 0.5f);
+    adjAdd(adj, 1, 1, 0.25f);
+    adjAdd(adj, 2, 2, 1.0f);
+    int none[3] = {1, 0, 0};
+    CHECK(hittingTimes(adj, none, h) == 0);
+    CHECK(h[0] == 0.0);
+    CHECK(isinf(h[1]));
+    CHECK(isinf(h[2]));
+    adjFree(adj);
+}
+
+/* Two states, 1 -> 2 with a = 1/4 and 2 -> 1 with b = 1/8:
+   m(1, 2) = 1 / a = 4, m(2, 1) = 1 / b = 8, pi = (1/3, 2/3), returns 3 and 3/2 */
+static void testTwoStatePassage(void) {
+    AdjList *adj = adjCreate(2);
+    adjAdd(adj, 0, 0, 0.75f);
+    adjAdd(adj, 0, 1, 0.25f);
+    adjAdd(adj, 1, 0, 0.125f);
+    adjAdd(adj, 1, 1, 0.875f);
+
+    int vertices[2] = {1, 2};
+    Class cls = {vertices, 2};
+    t_passage_solver s;
+    CHECK(passageSolverCreate(adj, &cls, &s) == 0);
+    CHECK_NEAR(s.pi[0], 1.0 / 3.0, 1e-12);
+    CHECK_NEAR(s.pi[1], 2.0 / 3.0, 1e-12);
+
+    double m[2];
+    CHECK(passageTimesTo(&s, 1, m) == 0);
+    CHECK_NEAR(m[0], 4.0, 1e-12);
+    CHECK_NEAR(m[1], 1.5, 1e-12);
+    CHECK(passageTimesTo(&s, 0, m) == 0);
+    CHECK_NEAR(m[1], 8.0, 1e-12);
+    CHECK_NEAR(m[0], 3.0, 1e-12);
+    passageSolverFree(&s);
+
+    /* {1} alone is not closed (1 -> 2 leaves it): no passage solver */
+    int single[1] = {1};
+    Class open = {single, 1};
+    CHECK(passageSolverCreate(adj, &open, &s) == 3);
+    adjFree(adj);
+}
+
+/* Weather chain of test_bench (one closed class of 5 states): every passage time
+   satisfies m(i, t) = 1 + sum over j != t of p(i, j) m(j, t), the return time is
+   1 / pi(t), and hittingTimes with target {t} gives the same values. The rows are
+   float and sum to 1 within about 1e-7, hence the tolerance. */
+static void testWeatherChain(void) {
+    AdjList *adj = adjReadFile("../test_bench/exemple_meteo.txt");
+    CHECK(adj != NULL && adj->n == 5);
+    if (adj == NULL) return;
+
+    int vertices[5] = {1, 2, 3, 4, 5};
+    Class cls = {vertices, 5};
+    t_passage_solver s;
+    CHECK(passageSolverCreate(adj, &cls, &s) == 0);
+
+    for (int t = 0; t < 5; t++) {
+        double m[5], h[5];
+        int target[5] = {0};
+        target[t] = 1;
+        CHECK(passageTimesTo(&s, t, m) == 0);
+        CHECK(hittingTimes(adj, target, h) == 0);
+        CHECK_NEAR(m[t], 1.0 / s.pi[t], 1e-9);
+
+        for (int i = 0; i < 5; i++) {
+            double rhs = 1.0;
+            for (EdgeCell *c = adj->L[i].head; c != NULL; c = c->next) {
+                if (c->v != t) rhs += c->p * m[c->v];
+            }
+            CHECK_NEAR(m[i], rhs, 1e-5);
+            if (i != t) CHECK_NEAR(h[i], m[i], 1e-5);
+        }
+    }
+
+    passageSolverFree(&s);
+    adjFree(adj);
+}
+
+int main(void) {
+    testHittingTimes();
+    testTwoStatePassage();
+    testWeatherChain();
+    return TEST_RESULT();
+}
@@ -0,0 +1,62 @@
+/* Duplicate-edge policies of the loader and the compact (CSR) form */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "adj_list.h"
+#include "test_check.h"
+
+/* 1 -> 2 appears twice (0.5 + 0.25), 3 -> 1 twice (0.5 + 0.5) */
+static const char *DUPLICATES =
+    "3\n1 2 0.5\n1 3 0.25\n1 2 0.25\n2 2 1\n3 1 0.5\n3 1 0.5\n";
+
+static int writeTemp(char *path, const char *text) {
+    int fd = mkstemp(path);
+    if (fd < 0) return 1;
+    FILE *f = fdopen(fd, "w");
+    if (f == NULL) return 1;
+    fputs(text, f);
+    return fclose(f) != 0;
+}
+
+int main(void) {
+    char path[] = "/tmp/test_ingest_XXXXXX";
+    CHECK(writeTemp(path, DUPLICATES) == 0);
+
+    /* Sum: one edge per target, placed where its first line was; rows in list
+       order (last line first), as adjAdd would have built them */
+    AdjCsr g;
+    double *sum = NULL;
+    int dups = -1;
+    CHECK(adjReadFileCsr(path, DUP_SUM, &g, &sum, &dups) == 0);
+    CHECK(dups == 2);
+    CHECK(g.n == 3 && g.nnz == 4);
+    CHECK(g.row_ptr[1] == 2 && g.row_ptr[2] == 3 && g.row_ptr[3] == 4);
+    CHECK(g.v[0] == 2 && g.p[0] == 0.25f);
+    CHECK(g.v[1] == 1 && g.p[1] == 0.75f);
+    CHECK(g.v[3] == 0 && g.p[3] == 1.0f);
+    CHECK_NEAR(sum[0], 1.0, 1e-12);
+    CHECK_NEAR(sum[2], 1.0, 1e-12);
+    CHECK(adjCsrBytes(&g) == 4 * (long)sizeof(int) + 4 * (long)(sizeof(int) + sizeof(float)));
+
+    /* Lists built from the compact form and back keep every edge in place */
+    AdjList *adj = adjFromCsr(&g);
+    AdjCsr back;
+    CHECK(adj != NULL && adjToCsr(adj, &back) == 0);
+    CHECK(back.nnz == g.nnz);
+    for (int e = 0; e < g.nnz; e++) CHECK(back.v[e] == g.v[e] && back.p[e] == g.p[e]);
+    CHECK(adj->L[0].head->v == 2 && adj->L[0].head->next->v == 1);
+    adjCsrFree(&back);
+    adjFree(adj);
+    adjCsrFree(&g);
+    free(sum);
+
+    /* Reject: the file is refused and the repeated lines are counted */
+    CHECK(adjReadFileCsr(path, DUP_REJECT, &g, NULL, &dups) == 3);
+    CHECK(dups == 2);
+    CHECK(g.row_ptr == NULL);
+    CHECK(adjReadFileMerged(path, DUP_REJECT, NULL, &dups) == NULL);
+
+    unlink(path);
+    return TEST_RESULT();
+}
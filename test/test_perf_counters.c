@@ -0,0 +1,52 @@
+/* Region counts of multiplexed counters: differences first, then scaling */
+
+#include <stdio.h>
+#include "perf_counters.h"
+#include "test_check.h"
+
+int main(void) {
+    t_perf_sample start, end, out;
+    for (int k = 0; k < PERF_COUNTER_COUNT; k++) {
+        start.value[k] = end.value[k] = -1;
+        start.enabled[k] = end.enabled[k] = 0;
+        start.running[k] = end.running[k] = 0;
+    }
+
+    /* Cycles counted all the time: the plain difference */
+    start.value[PERF_CYCLES] = 1000;
+    start.enabled[PERF_CYCLES] = start.running[PERF_CYCLES] = 100;
+    end.value[PERF_CYCLES] = 6000;
+    end.enabled[PERF_CYCLES] = end.running[PERF_CYCLES] = 200;
+
+    /* Instructions ran the whole first 100 ns (1000 counted), then only 25 of
+       the next 100 ns (500 counted): the region count is 500 * 100 / 25, not
+       the difference of the scaled totals (1500 * 200 / 125 - 1000 = 1400) */
+    start.value[PERF_INSTRUCTIONS] = 1000;
+    start.enabled[PERF_INSTRUCTIONS] = start.running[PERF_INSTRUCTIONS] = 100;
+    end.value[PERF_INSTRUCTIONS] = 1500;
+    end.enabled[PERF_INSTRUCTIONS] = 200;
+    end.running[PERF_INSTRUCTIONS] = 125;
+
+    /* LLC misses were never scheduled in the region: unavailable */
+    start.value[PERF_LLC_MISSES] = 7;
+    start.enabled[PERF_LLC_MISSES] = 100;
+    start.running[PERF_LLC_MISSES] = 50;
+    end.value[PERF_LLC_MISSES] = 7;
+    end.enabled[PERF_LLC_MISSES] = 200;
+    end.running[PERF_LLC_MISSES] = 50;
+
+    perfSampleDiff(&end, &start, &out);
+    CHECK(out.value[PERF_CYCLES] == 5000);
+    CHECK(out.value[PERF_INSTRUCTIONS] == 2000);
+    CHECK(out.enabled[PERF_INSTRUCTIONS] == 100 && out.running[PERF_INSTRUCTIONS] == 25);
+    CHECK(out.value[PERF_LLC_MISSES] == -1);
+    CHECK(out.value[PERF_BRANCH_MISSES] == -1);
+
+    /* Closed (or never opened) counters read as unavailable */
+    t_perf_counters pc;
+    for (int k = 0; k < PERF_COUNTER_COUNT; k++) pc.fd[k] = -1;
+    perfCountersRead(&pc, &start);
+    for (int k = 0; k < PERF_COUNTER_COUNT; k++) CHECK(start.value[k] == -1);
+
+    return TEST_RESULT();
+}
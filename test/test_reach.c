@@ -0,0 +1,105 @@
+/* Reachability index against a depth-first search from every state */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "adj_list.h"
+#include "partition.h"
+#include "tarjan.h"
+#include "reach.h"
+#include "test_check.h"
+
+#define N 300
+
+/* Deterministic random graph: short chains of states folded into cycles (classes
+   of a few states) plus sparse forward links, so the condensation has branches */
+static AdjList *randomGraph(int n, unsigned int seed) {
+    AdjList *adj = adjCreate(n);
+    for (int u = 0; u < n; u++) {
+        seed = seed * 1103515245u + 12345u;
+        int block = u - u % 4;
+        adjAdd(adj, u, (u + 1 < n && u + 1 < block + 4) ? u + 1 : block, 0.5f);
+        if ((seed >> 16) % 3 == 0) {
+            seed = seed * 1103515245u + 12345u;
+            adjAdd(adj, u, u + (int)((seed >> 16) % (n - u)), 0.5f);
+        }
+    }
+    return adj;
+}
+
+/* reach[u * n + v] = 1 if v is reachable from u (u reaches itself) */
+static char *allPairsDfs(const AdjList *adj) {
+    int n = adj->n;
+    char *reach = calloc((size_t)n * n, 1);
+    int *stack = malloc(n * sizeof(int));
+
+    for (int s = 0; s < n; s++) {
+        char *row = reach + (size_t)s * n;
+        int top = 0;
+        row[s] = 1;
+        stack[top++] = s;
+        while (top > 0) {
+            int u = stack[--top];
+            for (EdgeCell *c = adj->L[u].head; c != NULL; c = c->next) {
+                if (!row[c->v]) {
+                    row[c->v] = 1;
+                    stack[top++] = c->v;
+                }
+            }
+        }
+    }
+    free(stack);
+    return reach;
+}
+
+/* Every pair, one query at a time and in one batch */
+static void checkMode(const AdjList *adj, const Partition *part, const char *reach, int mode) {
+    int n = adj->n;
+    t_reach_index idx;
+    CHECK(reachIndexBuild(adj, part, mode, &idx) == 0);
+    CHECK(idx.mode == (t_reach_mode)mode);
+    CHECK(idx.count == part->count);
+    CHECK(reachIndexSize(&idx) > 0);
+
+    int wrong = 0;
+    for (int u = 0; u < n; u++) {
+        for (int v = 0; v < n; v++) {
+            wrong += reachQuery(&idx, u + 1, v + 1) != reach[(size_t)u * n + v];
+        }
+    }
+    CHECK(wrong == 0);
+
+    int *from = malloc((size_t)n * n * sizeof(int));
+    int *to = malloc((size_t)n * n * sizeof(int));
+    signed char *out = malloc((size_t)n * n);
+    for (int i = 0; i < n * n; i++) {
+        from[i] = i / n + 1;
+        to[i] = i % n + 1;
+    }
+    reachQueryBatch(&idx, from, to, n * n, out);
+    CHECK(memcmp(out, reach, (size_t)n * n) == 0);
+
+    CHECK(reachQuery(&idx, 0, 1) == -1);
+    CHECK(reachQuery(&idx, 1, n + 1) == -1);
+
+    free(from);
+    free(to);
+    free(out);
+    reachIndexFree(&idx);
+}
+
+int main(void) {
+    AdjList *adj = randomGraph(N, 2526u);
+    Partition part = partitionCreate(N);
+    CHECK(tarjanRun(adj, &part) == 0);
+    CHECK(part.count > 1 && part.count < N);
+
+    char *reach = allPairsDfs(adj);
+    checkMode(adj, &part, reach, REACH_BITSET);
+    checkMode(adj, &part, reach, REACH_INTERVAL);
+
+    free(reach);
+    partitionFree(&part);
+    adjFree(adj);
+    return TEST_RESULT();
+}
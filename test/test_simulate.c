@@ -0,0 +1,122 @@
+/* Alias tables and random walks: exact tables, reproducible counts, frequencies near pi */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "adj_list.h"
+#include "simulate.h"
+#include "test_check.h"
+
+/* Each entry k of a row of degree d is drawn with probability 1/d, then keeps
+   its target with probability prob[k] or moves to its alias: the tables must
+   give back the normalized row */
+static void testTables(void) {
+    AdjList *adj = adjCreate(4);
+    adjAdd(adj, 0, 0, 0.5f);
+    adjAdd(adj, 0, 1, 0.3f);
+    adjAdd(adj, 0, 2, 0.15f);
+    adjAdd(adj, 0, 3, 0.05f);
+    adjAdd(adj, 1, 2, 0.125f);   /* rows are normalized by their sum */
+    adjAdd(adj, 1, 3, 0.375f);
+    adjAdd(adj, 2, 0, 1.0f);
+
+    t_alias_chain ch;
+    CHECK(aliasChainBuild(adj, &ch) == 0);
+    CHECK(ch.row_ptr[4] == 7);
+    CHECK(ch.row_ptr[3] == ch.row_ptr[4]);   /* state 4 has no edges */
+
+    double expected[3][4] = {{0.5, 0.3, 0.15, 0.05}, {0, 0, 0.25, 0.75}, {1, 0, 0, 0}};
+    for (int u = 0; u < 3; u++) {
+        double got[4] = {0};
+        int d = ch.row_ptr[u + 1] - ch.row_ptr[u];
+        for (int e = ch.row_ptr[u]; e < ch.row_ptr[u + 1]; e++) {
+            CHECK(ch.prob[e] >= 0.0 && ch.prob[e] <= 1.0);
+            got[ch.target[e]] += ch.prob[e] / d;
+            got[ch.alias[e]] += (1.0 - ch.prob[e]) / d;
+        }
+        for (int v = 0; v < 4; v++) CHECK_NEAR(got[v], expected[u][v], 1e-7);
+    }
+
+    /* The walker stays on a state without edges */
+    t_simulation_options opt = {100, 5, 0, 4, 1};
+    t_simulation_result res;
+    CHECK(simulateWalks(&ch, &opt, &res) == 0);
+    CHECK(res.final[3] == 100 && res.visits[3] == 600 && res.total == 600);
+    simulationResultFree(&res);
+
+    aliasChainFree(&ch);
+    adjFree(adj);
+}
+
+/* 3-cycle from state 1: the walk is deterministic, every count is exact */
+static void testCycle(void) {
+    AdjList *adj = adjCreate(3);
+    for (int i = 0; i < 3; i++) adjAdd(adj, i, (i + 1) % 3, 1.0f);
+    t_alias_chain ch;
+    CHECK(aliasChainBuild(adj, &ch) == 0);
+
+    /* 31 steps end on state 2; burn-in 1 counts steps 1..31 (11 on 2, 10 on 3 and 1) */
+    t_simulation_options opt = {50, 31, 1, 1, 7};
+    t_simulation_result res;
+    CHECK(simulateWalks(&ch, &opt, &res) == 0);
+    CHECK(res.final[0] == 0 && res.final[1] == 50 && res.final[2] == 0);
+    CHECK(res.visits[0] == 500 && res.visits[1] == 550 && res.visits[2] == 500);
+    CHECK(res.total == 50 * 31);
+    simulationResultFree(&res);
+
+    opt.start = 5;
+    CHECK(simulateWalks(&ch, &opt, &res) == 1);
+
+    aliasChainFree(&ch);
+    adjFree(adj);
+}
+
+/* Two states, pi = (1/3, 2/3): visit frequencies and final states approach pi,
+   and the same seed gives the same counts whatever the thread count */
+static void testTwoState(void) {
+    AdjList *adj = adjCreate(2);
+    adjAdd(adj, 0, 0, 0.75f);
+    adjAdd(adj, 0, 1, 0.25f);
+    adjAdd(adj, 1, 0, 0.125f);
+    adjAdd(adj, 1, 1, 0.875f);
+    t_alias_chain ch;
+    CHECK(aliasChainBuild(adj, &ch) == 0);
+
+    t_simulation_options opt = {20000, 200, 50, 1, 2526};
+    t_simulation_result res, again;
+    CHECK(simulateWalks(&ch, &opt, &res) == 0);
+    CHECK(res.total == 20000ULL * 151);
+    CHECK_NEAR((double)res.visits[0] / res.total, 1.0 / 3.0, 5e-3);
+    CHECK_NEAR((double)res.final[0] / opt.walks, 1.0 / 3.0, 2e-2);
+
+#ifdef _OPENMP
+    int threads = omp_get_max_threads();
+    omp_set_num_threads(1);
+#endif
+    CHECK(simulateWalks(&ch, &opt, &again) == 0);
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+    CHECK(memcmp(res.visits, again.visits, 2 * sizeof(unsigned long long)) == 0);
+    CHECK(memcmp(res.final, again.final, 2 * sizeof(unsigned long long)) == 0);
+    simulationResultFree(&again);
+
+    opt.seed++;
+    CHECK(simulateWalks(&ch, &opt, &again) == 0);
+    CHECK(again.visits[0] != res.visits[0]);
+    simulationResultFree(&again);
+
+    simulationResultFree(&res);
+    aliasChainFree(&ch);
+    adjFree(adj);
+}
+
+int main(void) {
+    testTables();
+    testCycle();
+    testTwoState();
+    return TEST_RESULT();
+}
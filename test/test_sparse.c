@@ -0,0 +1,130 @@
+/* Sparse products against the dense ones, and the memory budget of sparseAdvance */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "adj_list.h"
+#include "matrix.h"
+#include "test_check.h"
+#include "test_graphs.h"
+
+#define N 80
+
+/* Dense matrix power M^k by repeated matrixMultiply */
+static t_matrix densePower(t_matrix M, int k) {
+    t_matrix P = matrixCreate(M.size), T = matrixCreate(M.size);
+    matrixCopy(P, M);
+    for (int s = 1; s < k; s++) {
+        matrixMultiply(P, M, T);
+        matrixCopy(P, T);
+    }
+    matrixFree(&T);
+    return P;
+}
+
+static double maxDiff(t_sparse_matrix S, t_matrix D) {
+    t_matrix C = sparseToDense(S);
+    double worst = 0.0;
+    for (int i = 0; i < D.size; i++) {
+        for (int j = 0; j < D.size; j++) {
+            double d = fabs(C.data[i][j] - D.data[i][j]);
+            if (d > worst) worst = d;
+        }
+    }
+    matrixFree(&C);
+    return worst;
+}
+
+/* Tolerance 0 and no budget: exactly the dense powers, sorted rows */
+static void testExactPowers(t_matrix M, t_sparse_matrix S) {
+    for (int k = 1; k <= 7; k += 3) {
+        t_sparse_power_info info;
+        t_sparse_matrix P = sparseAdvance(S, S, k - 1, 0.0, 0, &info);
+        t_matrix D = densePower(M, k);
+
+        CHECK(info.products == k - 1);
+        CHECK(info.dropped_mass == 0.0);
+        CHECK(info.capped_rows == 0);
+        CHECK(maxDiff(P, D) < 1e-12);
+        for (int i = 0; i < P.rows; i++) {
+            for (int e = P.row_ptr[i] + 1; e < P.row_ptr[i + 1]; e++) {
+                CHECK(P.col_idx[e - 1] < P.col_idx[e]);
+            }
+        }
+
+        matrixFree(&D);
+        sparseFree(&P);
+    }
+
+    double dropped = 0.0;
+    t_sparse_matrix P2 = sparseMultiply(S, S, 0.0, &dropped);
+    t_matrix D2 = densePower(M, 2);
+    CHECK(maxDiff(P2, D2) < 1e-12);
+    CHECK(dropped == 0.0);
+    matrixFree(&D2);
+    sparseFree(&P2);
+}
+
+/* A budget too small for M^7: every step fits, each row keeps its largest entries,
+   and the pruned mass is what the rows lost */
+static void testBudget(t_matrix M, t_sparse_matrix S) {
+    t_sparse_power_info full, info;
+    t_sparse_matrix P = sparseAdvance(S, S, 6, 0.0, 0, &full);
+    long budget = full.peak_bytes / 3;
+
+    t_sparse_matrix Q = sparseAdvance(S, S, 6, 0.0, budget, &info);
+    CHECK(info.row_cap > 0);
+    CHECK(info.capped_rows > 0);
+    CHECK(info.peak_bytes <= budget);
+    CHECK(sparseBytes(Q) <= budget);
+
+    double mass = 0.0;
+    for (int i = 0; i < Q.rows; i++) {
+        CHECK(Q.row_ptr[i + 1] - Q.row_ptr[i] <= info.row_cap);
+        for (int e = Q.row_ptr[i]; e < Q.row_ptr[i + 1]; e++) mass += Q.values[e];
+    }
+    double rows = 0.0;
+    for (int i = 0; i < P.rows; i++) {
+        for (int e = P.row_ptr[i]; e < P.row_ptr[i + 1]; e++) rows += P.values[e];
+    }
+    CHECK_NEAR(mass + info.dropped_mass, rows, 1e-9);
+
+    /* One capped product keeps exactly the row_cap largest entries of each row */
+    t_sparse_matrix R = sparseMultiplyCapped(S, S, 0.0, 3, NULL, NULL);
+    t_matrix D = densePower(M, 2);
+    for (int i = 0; i < R.rows; i++) {
+        double smallestKept = INFINITY;
+        int kept = R.row_ptr[i + 1] - R.row_ptr[i], nonzero = 0;
+        for (int e = R.row_ptr[i]; e < R.row_ptr[i + 1]; e++) {
+            CHECK(R.values[e] == D.data[i][R.col_idx[e]]);
+            if (R.values[e] < smallestKept) smallestKept = R.values[e];
+        }
+        for (int j = 0; j < D.size; j++) {
+            if (D.data[i][j] != 0.0) nonzero++;
+        }
+        CHECK(kept == (nonzero < 3 ? nonzero : 3));
+
+        int larger = 0;
+        for (int j = 0; j < D.size; j++) larger += D.data[i][j] > smallestKept;
+        CHECK(larger <= kept);
+    }
+
+    matrixFree(&D);
+    sparseFree(&R);
+    sparseFree(&Q);
+    sparseFree(&P);
+}
+
+int main(void) {
+    AdjList *adj = randomChain(N, 2526u);
+    t_matrix M = adjToMatrix(adj);
+    t_sparse_matrix S = adjToSparse(adj);
+
+    testExactPowers(M, S);
+    testBudget(M, S);
+
+    sparseFree(&S);
+    matrixFree(&M);
+    adjFree(adj);
+    return TEST_RESULT();
+}
@@ -0,0 +1,72 @@
+/* Spectral estimates of small matrices with known eigenvalues */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "adj_list.h"
+#include "matrix.h"
+#include "spectral.h"
+#include "test_check.h"
+
+/* Estimate on both storages and check rho and |lambda2| */
+static void checkSpectrum(const AdjList *adj, double rho, double lambda2, t_spectral_estimate *out) {
+    t_matrix M = adjToMatrix(adj);
+    t_sparse_matrix S = adjToSparse(adj);
+    t_spectral_estimate dense, sparse;
+
+    CHECK(spectralEstimate(M, 10000, 1e-12, &dense) == 0);
+    CHECK(spectralEstimateSparse(S, 10000, 1e-12, &sparse) == 0);
+    CHECK_NEAR(dense.rho, rho, 1e-6);
+    CHECK_NEAR(dense.lambda2, lambda2, 1e-4);
+    CHECK_NEAR(sparse.rho, dense.rho, 1e-12);
+    CHECK_NEAR(sparse.lambda2, dense.lambda2, 1e-12);
+
+    *out = dense;
+    sparseFree(&S);
+    matrixFree(&M);
+}
+
+int main(void) {
+    t_spectral_estimate est;
+
+    /* [[3/4, 1/4], [1/8, 7/8]]: eigenvalues 1 and 1 - 1/4 - 1/8 = 5/8 */
+    AdjList *two = adjCreate(2);
+    adjAdd(two, 0, 0, 0.75f);
+    adjAdd(two, 0, 1, 0.25f);
+    adjAdd(two, 1, 0, 0.125f);
+    adjAdd(two, 1, 1, 0.875f);
+    checkSpectrum(two, 1.0, 0.625, &est);
+    CHECK(est.converged);
+    CHECK_NEAR(est.relaxation, 1.0 / (1.0 - 0.625), 1e-3);
+    /* (5/8)^n <= 1e-3 first holds for n = ceil(ln 1e-3 / ln 0.625) = 15 */
+    CHECK(spectralStepsFor(&est, 1e-3) == 15);
+    adjFree(two);
+
+    /* 1/2 on the diagonal, 1/4 elsewhere: eigenvalues 1, 1/4, 1/4 */
+    AdjList *three = adjCreate(3);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) adjAdd(three, i, j, i == j ? 0.5f : 0.25f);
+    }
+    checkSpectrum(three, 1.0, 0.25, &est);
+    CHECK(spectralStepsFor(&est, 1e-6) == 10);
+    adjFree(three);
+
+    /* Transient block, all entries 1/4: rho = 1/2 and M^n decays like 2^-n */
+    AdjList *transient = adjCreate(2);
+    for (int i = 0; i < 2; i++) {
+        for (int j = 0; j < 2; j++) adjAdd(transient, i, j, 0.25f);
+    }
+    checkSpectrum(transient, 0.5, 0.0, &est);
+    CHECK(spectralStepsFor(&est, 1e-3) == 10);
+    adjFree(transient);
+
+    /* 3-cycle: |lambda2| = 1, M^n never settles */
+    AdjList *cycle = adjCreate(3);
+    for (int i = 0; i < 3; i++) adjAdd(cycle, i, (i + 1) % 3, 1.0f);
+    checkSpectrum(cycle, 1.0, 1.0, &est);
+    CHECK(isinf(est.relaxation));
+    CHECK(spectralStepsFor(&est, 1e-3) == -1);
+    adjFree(cycle);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,112 @@
+/* Stationary solvers on chains whose answer is known by hand */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "adj_list.h"
+#include "matrix.h"
+#include "stationary.h"
+#include "test_check.h"
+
+/* Two states, 1 -> 2 with probability a, 2 -> 1 with probability b:
+   pi = (b, a) / (a + b). With a = 1/4, b = 1/8: pi = (1/3, 2/3). */
+static AdjList *twoStateChain(void) {
+    AdjList *adj = adjCreate(2);
+    adjAdd(adj, 0, 0, 0.75f);
+    adjAdd(adj, 0, 1, 0.25f);
+    adjAdd(adj, 1, 0, 0.125f);
+    adjAdd(adj, 1, 1, 0.875f);
+    return adj;
+}
+
+/* Repeated squaring: every row of the limit matrix is pi */
+static void testLimitMatrix(t_matrix M) {
+    t_stationary_options opt = stationaryDefaultOptions();
+    opt.epsilon = 1e-10;
+
+    t_matrix limit = matrixCreate(2);
+    t_stationary_info info;
+    CHECK(stationaryLimitMatrix(M, opt, limit, &info) == 0);
+    CHECK(info.converged);
+    CHECK(info.exponent == 1L << info.iterations);
+    for (int i = 0; i < 2; i++) {
+        CHECK_NEAR(limit.data[i][0], 1.0 / 3.0, 1e-9);
+        CHECK_NEAR(limit.data[i][1], 2.0 / 3.0, 1e-9);
+    }
+
+    /* Plain powers reach the same limit, one product per step */
+    opt.method = STATIONARY_POWER;
+    CHECK(stationaryLimitMatrix(M, opt, limit, &info) == 0);
+    CHECK(info.converged);
+    CHECK(info.exponent == info.iterations + 1);
+    CHECK_NEAR(limit.data[1][0], 1.0 / 3.0, 1e-9);
+
+    matrixFree(&limit);
+}
+
+/* Every vector method, dense and sparse */
+static void testVectors(t_matrix M, t_sparse_matrix S) {
+    t_stationary_method methods[] = {STATIONARY_POWER, STATIONARY_SQUARING, STATIONARY_AITKEN};
+
+    for (int m = 0; m < 3; m++) {
+        t_stationary_options opt = stationaryDefaultOptions();
+        opt.method = methods[m];
+        opt.epsilon = 1e-10;
+        opt.max_iter = 10000;
+
+        double pi[2];
+        t_stationary_info info;
+        CHECK(stationaryVector(M, opt, pi, &info) == 0);
+        CHECK(info.converged);
+        CHECK_NEAR(pi[0], 1.0 / 3.0, 1e-8);
+        CHECK_NEAR(pi[1], 2.0 / 3.0, 1e-8);
+        CHECK(stationaryResidual(M, pi) < 1e-8);
+
+        CHECK(stationaryVectorSparse(S, opt, pi, &info) == 0);
+        CHECK(info.converged);
+        CHECK_NEAR(pi[0], 1.0 / 3.0, 1e-8);
+        CHECK(stationaryResidualSparse(S, pi) < 1e-8);
+    }
+}
+
+/* 1 <-> 2 has period 2: plain iteration from a point mass oscillates,
+   the lazy chain (I + M) / 2 converges to (1/2, 1/2) */
+static void testLazy(void) {
+    AdjList *adj = adjCreate(2);
+    adjAdd(adj, 0, 1, 1.0f);
+    adjAdd(adj, 1, 0, 1.0f);
+    t_sparse_matrix S = adjToSparse(adj);
+
+    t_stationary_options opt = stationaryDefaultOptions();
+    opt.method = STATIONARY_POWER;
+    opt.epsilon = 1e-10;
+    opt.max_iter = 100;
+
+    double start[2] = {1.0, 0.0}, pi[2];
+    t_stationary_info info;
+    CHECK(stationaryVectorSparseFrom(S, opt, start, pi, &info) == 0);
+    CHECK(!info.converged);
+
+    opt.lazy = 1;
+    CHECK(stationaryVectorSparseFrom(S, opt, start, pi, &info) == 0);
+    CHECK(info.converged);
+    CHECK_NEAR(pi[0], 0.5, 1e-10);
+    CHECK_NEAR(pi[1], 0.5, 1e-10);
+
+    sparseFree(&S);
+    adjFree(adj);
+}
+
+int main(void) {
+    AdjList *adj = twoStateChain();
+    t_matrix M = adjToMatrix(adj);
+    t_sparse_matrix S = adjToSparse(adj);
+
+    testLimitMatrix(M);
+    testVectors(M, S);
+    testLazy();
+
+    sparseFree(&S);
+    matrixFree(&M);
+    adjFree(adj);
+    return TEST_RESULT();
+}
@@ -0,0 +1,145 @@
+/* Incremental re-solve: edited classes against values computed by hand and a fresh solve */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "adj_list.h"
+#include "stationary_update.h"
+#include "test_check.h"
+
+/* 1 <-> 2 with a = 1/4, b = 1/8: pi = (1/3, 2/3). 3 <-> 4 by halves: pi = (1/2, 1/2).
+   5 is transient, half to 1, half to 3. */
+static AdjList *twoClassChain(void) {
+    AdjList *adj = adjCreate(5);
+    adjAdd(adj, 0, 0, 0.75f);
+    adjAdd(adj, 0, 1, 0.25f);
+    adjAdd(adj, 1, 0, 0.125f);
+    adjAdd(adj, 1, 1, 0.875f);
+    adjAdd(adj, 2, 2, 0.5f);
+    adjAdd(adj, 2, 3, 0.5f);
+    adjAdd(adj, 3, 2, 0.5f);
+    adjAdd(adj, 3, 3, 0.5f);
+    adjAdd(adj, 4, 0, 0.5f);
+    adjAdd(adj, 4, 2, 0.5f);
+    return adj;
+}
+
+static t_stationary_options tightOptions(void) {
+    t_stationary_options opt = stationaryDefaultOptions();
+    opt.method = STATIONARY_AITKEN;
+    opt.epsilon = 1e-13;
+    opt.max_iter = 10000;
+    return opt;
+}
+
+/* The updated state must agree with a solve from scratch of the edited lists */
+static void checkAgainstFresh(const t_stationary_state *st) {
+    t_stationary_state fresh;
+    CHECK(stationaryStateInit(st->adj, NULL, st->opt, &fresh, NULL) == 0);
+    CHECK(fresh.part.count == st->part.count);
+    for (int i = 0; i < st->adj->n; i++) CHECK_NEAR(st->pi[i], fresh.pi[i], 1e-9);
+    stationaryStateFree(&fresh);
+}
+
+/* New probabilities on existing edges: classes stay, only the edited one moves */
+static void testValueEdit(void) {
+    AdjList *adj = twoClassChain();
+    t_stationary_state st;
+    t_stationary_update_info info;
+    CHECK(stationaryStateInit(adj, NULL, tightOptions(), &st, &info) == 0);
+    CHECK(info.solved == 2 && info.converged == 2);
+    CHECK_NEAR(st.pi[0], 1.0 / 3.0, 1e-9);
+    CHECK_NEAR(st.pi[1], 2.0 / 3.0, 1e-9);
+    CHECK_NEAR(st.pi[2], 0.5, 1e-9);
+    CHECK(st.pi[4] == 0.0);
+    int coldIterations = info.iterations;
+
+    /* a = 1/2: pi = (b / (a + b), a / (a + b)) = (0.2, 0.8) */
+    double before[5];
+    memcpy(before, st.pi, sizeof(before));
+    t_prob_update edit[2] = {{1, 1, 0.5}, {1, 2, 0.5}};
+    CHECK(stationaryStateUpdate(&st, edit, 2, &info) == 0);
+    CHECK(info.structural == 0);
+    CHECK(info.solved == 1 && info.kept == 1 && info.converged == 1);
+    CHECK_NEAR(st.pi[0], 0.2, 1e-9);
+    CHECK_NEAR(st.pi[1], 0.8, 1e-9);
+    CHECK(memcmp(st.pi + 2, before + 2, 3 * sizeof(double)) == 0);
+    checkAgainstFresh(&st);
+
+    /* The same values again: the class restarts from its own vector and stops at once */
+    CHECK(stationaryStateUpdate(&st, edit, 2, &info) == 0);
+    CHECK(info.solved == 1 && info.converged == 1);
+    CHECK(info.iterations <= 2 && info.iterations < coldIterations);
+    CHECK_NEAR(st.pi[0], 0.2, 1e-9);
+
+    stationaryStateFree(&st);
+    adjFree(adj);
+}
+
+/* Edges that vanish or appear: classes are recomputed, untouched ones keep their vector */
+static void testStructuralEdit(void) {
+    AdjList *adj = twoClassChain();
+    t_stationary_state st;
+    t_stationary_update_info info;
+    CHECK(stationaryStateInit(adj, NULL, tightOptions(), &st, &info) == 0);
+    double before[5];
+    memcpy(before, st.pi, sizeof(before));
+
+    /* 5 -> 1 removed: 5 stays transient, both closed classes are kept as they were */
+    t_prob_update drop = {5, 1, 0.0};
+    CHECK(stationaryStateUpdate(&st, &drop, 1, &info) == 0);
+    CHECK(info.structural == 1);
+    CHECK(info.kept == 2 && info.solved == 0);
+    CHECK(memcmp(st.pi, before, sizeof(before)) == 0);
+
+    /* 4 -> 3 removed and 4 -> 4 raised to 1: {4} alone is closed, 3 is transient */
+    t_prob_update split[2] = {{4, 3, 0.0}, {4, 4, 1.0}};
+    CHECK(stationaryStateUpdate(&st, split, 2, &info) == 0);
+    CHECK(info.structural == 1);
+    CHECK(info.kept == 1 && info.solved == 1);
+    CHECK(st.pi[2] == 0.0);
+    CHECK_NEAR(st.pi[3], 1.0, 1e-9);
+    CHECK(memcmp(st.pi, before, 2 * sizeof(double)) == 0);
+    checkAgainstFresh(&st);
+
+    /* 4 -> 3 back: {3, 4} merge again */
+    t_prob_update join[2] = {{4, 3, 0.5}, {4, 4, 0.5}};
+    CHECK(stationaryStateUpdate(&st, join, 2, &info) == 0);
+    CHECK(info.structural == 1);
+    CHECK(info.kept == 1 && info.solved == 1);
+    CHECK_NEAR(st.pi[2], 0.5, 1e-9);
+    CHECK_NEAR(st.pi[3], 0.5, 1e-9);
+    checkAgainstFresh(&st);
+
+    stationaryStateFree(&st);
+    adjFree(adj);
+}
+
+/* One bad edit in a batch: nothing is applied */
+static void testBadEdit(void) {
+    AdjList *adj = twoClassChain();
+    t_stationary_state st;
+    CHECK(stationaryStateInit(adj, NULL, tightOptions(), &st, NULL) == 0);
+    double before[5];
+    memcpy(before, st.pi, sizeof(before));
+
+    t_prob_update outOfRange[2] = {{1, 1, 0.5}, {1, 6, 0.5}};
+    CHECK(stationaryStateUpdate(&st, outOfRange, 2, NULL) == 1);
+    t_prob_update tooLarge = {3, 4, 1.5};
+    CHECK(stationaryStateUpdate(&st, &tooLarge, 1, NULL) == 1);
+
+    CHECK(memcmp(st.pi, before, sizeof(before)) == 0);
+    for (const EdgeCell *e = adj->L[0].head; e != NULL; e = e->next) {
+        if (e->v == 0) CHECK(e->p == 0.75f);
+    }
+
+    stationaryStateFree(&st);
+    adjFree(adj);
+}
+
+int main(void) {
+    testValueEdit();
+    testStructuralEdit();
+    testBadEdit();
+    return TEST_RESULT();
+}